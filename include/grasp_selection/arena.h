@@ -0,0 +1,166 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+
+/** Arena class
+ *
+ * \brief Monotonic memory arena for temporary data
+ *
+ * This class hands out memory from large blocks by advancing an offset. Memory is never freed individually; instead,
+ * the whole arena is reset once the data in it is not needed anymore (e.g., at the start of each grasp selection
+ * request). Blocks are kept across resets, and if more than one block was needed, they are merged into a single
+ * block of the combined size, so that once the arena has grown to the size needed by a request, it does not allocate
+ * any more memory from the global heap.
+ *
+*/
+class Arena
+{
+	public:
+
+		/**
+		 * \brief Memory statistics since the last reset.
+		*/
+		struct Statistics
+		{
+			std::size_t num_allocations_; ///< the number of allocations served by the arena
+			std::size_t num_bytes_; ///< the number of bytes served by the arena
+			std::size_t num_heap_allocations_; ///< the number of blocks allocated from the global heap
+		};
+
+		/**
+		 * \brief Constructor.
+		 * \param block_size the size of the first block in bytes
+		*/
+		Arena(std::size_t block_size = 64 * 1024);
+
+		/**
+		 * \brief Destructor.
+		*/
+		~Arena();
+
+		/**
+		 * \brief Allocate memory.
+		 * \param num_bytes the number of bytes to allocate
+		 * \param alignment the alignment of the memory in bytes (a power of two)
+		 * \return a pointer to the allocated memory
+		*/
+		void* allocate(std::size_t num_bytes, std::size_t alignment);
+
+		/**
+		 * \brief Allocate an array.
+		 * \param size the number of elements in the array
+		 * \param alignment the alignment of the array in bytes (a power of two)
+		 * \return a pointer to the first element of the array
+		*/
+		template <class T>
+		T* allocateArray(std::size_t size, std::size_t alignment = alignof(T))
+		{
+			return static_cast<T*>(allocate(size * sizeof(T), alignment));
+		}
+
+		/**
+		 * \brief Release all memory handed out by the arena and reset the statistics.
+		*/
+		void reset();
+
+		/**
+		 * \brief Return the memory statistics since the last reset.
+		 * \return the statistics
+		*/
+		const Statistics& getStatistics() const { return stats_; }
+
+
+	private:
+
+		/**
+		 * \brief Memory block.
+		*/
+		struct Block
+		{
+			char* data_; ///< the memory
+			std::size_t size_; ///< the size of the memory in bytes
+		};
+
+		/**
+		 * \brief Allocate a new block from the global heap and make it the current block.
+		 * \param min_size the minimum size of the block in bytes
+		*/
+		void addBlock(std::size_t min_size);
+
+		/**
+		 * \brief Align an offset into the current block.
+		 * \param offset the offset in bytes
+		 * \param alignment the alignment in bytes (a power of two)
+		 * \return the smallest offset not less than <offset> whose address has the given alignment
+		*/
+		std::size_t alignOffset(std::size_t offset, std::size_t alignment) const;
+
+		Arena(const Arena&);
+		Arena& operator=(const Arena&);
+
+		std::vector<Block> blocks_; ///< the memory blocks
+		std::size_t offset_; ///< the offset of the free memory in the current (last) block
+		Statistics stats_; ///< the memory statistics since the last reset
+};
+
+
+/** ArenaAllocator class
+ *
+ * \brief Standard allocator that takes its memory from an arena
+ *
+ * This allocator lets standard containers use an arena. A default-constructed allocator is not bound to an arena and
+ * uses the global heap, so that the same container type can be used for both temporary and persistent data.
+ *
+*/
+template <class T>
+class ArenaAllocator
+{
+	public:
+
+		typedef T value_type;
+
+		ArenaAllocator(Arena* arena = NULL) : arena_(arena) { }
+
+		template <class U>
+		ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena_) { }
+
+		T* allocate(std::size_t n)
+		{
+			if (arena_ == NULL)
+				return static_cast<T*>(::operator new(n * sizeof(T)));
+
+			return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+		}
+
+		void deallocate(T* p, std::size_t n)
+		{
+			if (arena_ == NULL)
+				::operator delete(p);
+		}
+
+		Arena* arena_; ///< the arena, or NULL for the global heap
+};
+
+
+template <class T, class U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+	return a.arena_ == b.arena_;
+}
+
+template <class T, class U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+	return a.arena_ != b.arena_;
+}
+
+
+/** a std::vector whose memory can be taken from an arena */
+template <class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T> >;
+
+#endif /* ARENA_H */
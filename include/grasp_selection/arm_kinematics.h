@@ -0,0 +1,82 @@
+#ifndef ARM_KINEMATICS_H
+#define ARM_KINEMATICS_H
+
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+#include <Eigen/StdVector>
+
+#include <urdf/model.h>
+
+#include <string>
+#include <vector>
+
+
+/** ArmKinematics class
+ *
+ * \brief Forward kinematics for a robot arm
+ *
+ * This class calculates the forward kinematics of the kinematic chain between two links of a URDF model. It is used to
+ * check the robot arm for collisions along a path in joint space.
+ *
+*/
+class ArmKinematics
+{
+	public:
+
+		/**
+		 * \brief Constructor. Extract the kinematic chain from a URDF model.
+		 * \param urdf the URDF model
+		 * \param base_link the name of the first link of the chain (the planning frame)
+		 * \param tip_link the name of the last link of the chain (the robot hand)
+		 * \param joint_names the names of the arm joints, in the order in which joint positions are given
+		*/
+		ArmKinematics(const urdf::Model& urdf, const std::string& base_link, const std::string& tip_link,
+			const std::vector<std::string>& joint_names);
+
+		/**
+		 * \brief Calculate the origins of the joint frames along the chain.
+		 * \param joint_positions the joint positions of the arm
+		 * \param origins the origins, starting with the base link and ending with the tip link (<getNumFrames()> values)
+		*/
+		void calculateFrameOrigins(const double* joint_positions, Eigen::Vector3d* origins) const;
+
+		/**
+		 * \brief Return the number of frame origins calculated by the forward kinematics.
+		 * \return the number of joints in the chain plus one
+		*/
+		int getNumFrames() const { return chain_.size() + 1; }
+
+		/**
+		 * \brief Return the velocity limits of the arm joints (given by the URDF).
+		 * \return the velocity limits, in the order of the joint names
+		*/
+		const std::vector<double>& getVelocityLimits() const { return velocity_limits_; }
+
+		/**
+		 * \brief Check whether the chain could be extracted from the URDF model.
+		 * \return true if the chain connects the base link and the tip link, false otherwise
+		*/
+		bool isValid() const { return is_valid_; }
+
+
+	private:
+
+		/**
+		 * \brief Joint in the kinematic chain.
+		*/
+		struct Joint
+		{
+			Eigen::Affine3d origin_; ///< the transform from the parent link to the joint frame
+			Eigen::Vector3d axis_; ///< the joint axis in the joint frame
+			int type_; ///< the URDF joint type
+			int index_; ///< the index of the joint in the joint positions, or -1 if the joint does not move
+
+			EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+		};
+
+		std::vector<Joint, Eigen::aligned_allocator<Joint> > chain_; ///< the joints from the base link to the tip link
+		std::vector<double> velocity_limits_; ///< the velocity limits of the arm joints
+		bool is_valid_; ///< whether the chain connects the base link and the tip link
+};
+
+#endif /* ARM_KINEMATICS_H */
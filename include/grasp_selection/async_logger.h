@@ -0,0 +1,314 @@
+#ifndef ASYNC_LOGGER_H
+#define ASYNC_LOGGER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+/** Log a message if its level is enabled for its category. The format string has to be a string literal. */
+#define ASYNC_LOG(category, level, ...) \
+	do { \
+		AsyncLogger& async_logger = AsyncLogger::getInstance(); \
+		if (async_logger.isEnabled(category, level)) \
+			async_logger.log(category, level, __VA_ARGS__); \
+	} while (0)
+
+#define ASYNC_LOG_DEBUG(category, ...) ASYNC_LOG(category, AsyncLogger::LEVEL_DEBUG, __VA_ARGS__)
+#define ASYNC_LOG_INFO(category, ...) ASYNC_LOG(category, AsyncLogger::LEVEL_INFO, __VA_ARGS__)
+#define ASYNC_LOG_WARN(category, ...) ASYNC_LOG(category, AsyncLogger::LEVEL_WARN, __VA_ARGS__)
+#define ASYNC_LOG_ERROR(category, ...) ASYNC_LOG(category, AsyncLogger::LEVEL_ERROR, __VA_ARGS__)
+
+
+/** AsyncLogger class
+ *
+ * \brief Logs messages without formatting or writing them on the calling thread
+ *
+ * This class stores each log message as a binary record, i.e., the format string and the unformatted arguments, in a
+ * ring buffer of the calling thread. A background thread collects the records from all threads, formats them in the
+ * order in which they were logged, and writes them to stdout. Logging a message therefore only takes a few copies,
+ * and no lock or system call, so detailed messages can be logged in the loops that evaluate the grasps.
+ *
+ * The format string has to be a string literal, and string arguments (%s) have to outlive the background thread's
+ * next flush (e.g., string literals). Only the printf conversions for integers, floating point numbers, characters,
+ * strings and pointers are supported, without the '*' width and precision. If the ring buffer of a thread is full,
+ * its messages are dropped and counted.
+ *
+ * Each category has its own level; messages below the level of their category are discarded before they are stored.
+ *
+*/
+class AsyncLogger
+{
+	public:
+
+		/**
+		 * \brief The parts of the grasp selection that log messages.
+		*/
+		enum Category
+		{
+			REACHING, ///< the reachability test of the grasps
+			SCORING, ///< the scoring of the reachable grasps
+			SELECTION, ///< the grasp selection pipeline and the ROS node
+			NUM_CATEGORIES
+		};
+
+		/**
+		 * \brief The levels of the log messages.
+		*/
+		enum Level
+		{
+			LEVEL_DEBUG,
+			LEVEL_INFO,
+			LEVEL_WARN,
+			LEVEL_ERROR,
+			LEVEL_NONE ///< no messages are logged
+		};
+
+		static const int MAX_ARGS = 8; ///< the maximum number of arguments of a log message
+
+		/**
+		 * \brief Return the logger of the process. The background thread is started when this is called first.
+		 * \return the logger
+		*/
+		static AsyncLogger& getInstance();
+
+		/**
+		 * \brief Destructor. Write the remaining messages and stop the background thread.
+		*/
+		~AsyncLogger();
+
+		/**
+		 * \brief Check whether messages of a level are logged for a category.
+		 * \param category the category
+		 * \param level the level
+		 * \return true if the messages are logged, false otherwise
+		*/
+		bool isEnabled(Category category, Level level) const
+		{
+			return level >= levels_[category].load(std::memory_order_relaxed);
+		}
+
+		/**
+		 * \brief Set the level of a category.
+		 * \param category the category
+		 * \param level the lowest level of the messages that are logged for the category
+		*/
+		void setLevel(Category category, Level level) { levels_[category].store(level, std::memory_order_relaxed); }
+
+		/**
+		 * \brief Log a message. The arguments are stored as they are and formatted by the background thread.
+		 * \param category the category of the message
+		 * \param level the level of the message
+		 * \param format the printf format string (has to be a string literal)
+		 * \param args the arguments
+		*/
+		template <typename... Args>
+		void log(Category category, Level level, const char* format, const Args&... args)
+		{
+			static_assert(sizeof...(Args) <= MAX_ARGS, "too many arguments for a log message");
+			Record record;
+			record.time_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::system_clock::now().time_since_epoch()).count();
+			record.format_ = format;
+			record.category_ = category;
+			record.level_ = level;
+			record.num_args_ = sizeof...(Args);
+			packArgs(record.args_, args...);
+			getThreadBuffer()->push(record);
+		}
+
+		/**
+		 * \brief Write all messages that have been logged so far, and wait until they are written.
+		*/
+		void flush();
+
+		/**
+		 * \brief Return the name of a category.
+		 * \param category the category
+		 * \return the name
+		*/
+		static const char* getCategoryName(Category category);
+
+		/**
+		 * \brief Parse the name of a level (debug, info, warn, error, or none).
+		 * \param name the name
+		 * \param level the level (set if the name is valid)
+		 * \return true if the name is valid, false otherwise
+		*/
+		static bool parseLevel(const std::string& name, Level& level);
+
+
+	private:
+
+		/**
+		 * \brief An unformatted argument of a log message.
+		*/
+		struct Arg
+		{
+			enum Type {SIGNED, UNSIGNED, FLOATING, STRING, POINTER} type_;
+			union
+			{
+				long long i_;
+				unsigned long long u_;
+				double d_;
+				const char* s_;
+				const void* p_;
+			};
+		};
+
+		/**
+		 * \brief A log message as it is stored in the ring buffers.
+		*/
+		struct Record
+		{
+			int64_t time_; ///< the time at which the message was logged (nanoseconds since the epoch)
+			const char* format_; ///< the format string
+			uint8_t category_; ///< the category
+			uint8_t level_; ///< the level
+			uint8_t num_args_; ///< the number of arguments
+			Arg args_[MAX_ARGS]; ///< the arguments
+		};
+
+		/**
+		 * \brief A ring buffer with a single writer (the thread that logs) and a single reader (the background thread).
+		*/
+		class RingBuffer
+		{
+			public:
+
+				RingBuffer(size_t capacity) : records_(capacity), mask_(capacity - 1), head_(0), tail_(0), num_dropped_(0)
+				{ }
+
+				/**
+				 * \brief Add a record (called by the writer).
+				 * \param record the record
+				*/
+				void push(const Record& record)
+				{
+					const size_t head = head_.load(std::memory_order_relaxed);
+					if (head - tail_.load(std::memory_order_acquire) == records_.size())
+					{
+						num_dropped_.fetch_add(1, std::memory_order_relaxed);
+						return;
+					}
+					records_[head & mask_] = record;
+					head_.store(head + 1, std::memory_order_release);
+				}
+
+				/**
+				 * \brief Move all records to a list (called by the reader).
+				 * \param records the list that the records are appended to
+				 * \return the number of records that were dropped since the last call
+				*/
+				size_t pop(std::vector<Record>& records)
+				{
+					const size_t tail = tail_.load(std::memory_order_relaxed);
+					const size_t head = head_.load(std::memory_order_acquire);
+					for (size_t i = tail; i != head; i++)
+						records.push_back(records_[i & mask_]);
+					tail_.store(head, std::memory_order_release);
+					return num_dropped_.exchange(0, std::memory_order_relaxed);
+				}
+
+			private:
+
+				std::vector<Record> records_; ///< the records (the capacity is a power of two)
+				size_t mask_; ///< maps the positions to indices into the records
+				std::atomic<size_t> head_; ///< the number of records written
+				std::atomic<size_t> tail_; ///< the number of records read
+				std::atomic<size_t> num_dropped_; ///< the number of records dropped because the buffer was full
+		};
+
+		static const size_t BUFFER_CAPACITY = 4096; ///< the number of records per thread (a power of two)
+		static const int FLUSH_PERIOD = 20; ///< the period (in milliseconds) at which the background thread writes
+
+		/**
+		 * \brief Constructor. Start the background thread.
+		*/
+		AsyncLogger();
+
+		/**
+		 * \brief Return the ring buffer of the calling thread, and create it if the thread has not logged yet.
+		 * \return the ring buffer
+		*/
+		RingBuffer* getThreadBuffer()
+		{
+			static thread_local RingBuffer* buffer = NULL;
+			if (buffer == NULL)
+				buffer = createThreadBuffer();
+			return buffer;
+		}
+
+		/**
+		 * \brief Create the ring buffer of the calling thread.
+		 * \return the ring buffer
+		*/
+		RingBuffer* createThreadBuffer();
+
+		/**
+		 * \brief The loop of the background thread.
+		*/
+		void run();
+
+		/**
+		 * \brief Collect the records from ring buffers, and format and write them (called by the background thread).
+		 * \param buffers the ring buffers
+		*/
+		void writeRecords(const std::vector<RingBuffer*>& buffers);
+
+		/**
+		 * \brief Format a record as a line of text.
+		 * \param record the record
+		 * \param line the line that the text is appended to
+		*/
+		static void formatRecord(const Record& record, std::string& line);
+
+		static void packArgs(Arg* args) { }
+
+		template <typename T, typename... Args>
+		static void packArgs(Arg* args, const T& value, const Args&... rest)
+		{
+			packArg(args[0], value);
+			packArgs(args + 1, rest...);
+		}
+
+		template <typename T>
+		static typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+		packArg(Arg& arg, T value) { arg.type_ = Arg::SIGNED; arg.i_ = value; }
+
+		template <typename T>
+		static typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value>::type
+		packArg(Arg& arg, T value) { arg.type_ = Arg::UNSIGNED; arg.u_ = value; }
+
+		template <typename T>
+		static typename std::enable_if<std::is_floating_point<T>::value>::type
+		packArg(Arg& arg, T value) { arg.type_ = Arg::FLOATING; arg.d_ = value; }
+
+		template <typename T>
+		static typename std::enable_if<std::is_enum<T>::value>::type
+		packArg(Arg& arg, T value) { arg.type_ = Arg::SIGNED; arg.i_ = value; }
+
+		static void packArg(Arg& arg, const char* value) { arg.type_ = Arg::STRING; arg.s_ = value; }
+
+		static void packArg(Arg& arg, const void* value) { arg.type_ = Arg::POINTER; arg.p_ = value; }
+
+		std::atomic<int> levels_[NUM_CATEGORIES]; ///< the level of each category
+		std::mutex mutex_; ///< protects the list of ring buffers and the state of the background thread
+		std::condition_variable condition_; ///< wakes the background thread, and signals finished flushes
+		std::vector<RingBuffer*> buffers_; ///< the ring buffers of all threads that logged messages
+		std::vector<Record> records_; ///< the records collected by the background thread
+		std::string text_; ///< the text written by the background thread
+		uint64_t num_flush_requests_; ///< the number of flushes requested
+		uint64_t num_flushes_; ///< the number of flushes done by the background thread
+		bool is_stopping_; ///< whether the background thread should stop
+		std::thread thread_; ///< the background thread
+};
+
+#endif /* ASYNC_LOGGER_H */
@@ -0,0 +1,125 @@
+#ifndef CANDIDATE_STORE_H
+#define CANDIDATE_STORE_H
+
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+
+#include <cstddef>
+#include <vector>
+
+
+/** CandidateStore class
+ *
+ * \brief Structure-of-arrays storage for grasp candidates
+ *
+ * This class stores a set of grasp candidates column by column: positions, orientations, approach directions,
+ * apertures, Inverse Kinematics solutions, scores and ids each live in their own contiguous array. The joint positions
+ * of all candidates are stored in one array with a fixed stride (the number of arm joints). Clearing the store keeps
+ * its capacity, so filling it again for a new scene does not allocate memory. ROS messages are only created from the
+ * store when the selected grasps are sent back to the client. The store cannot be copied, only moved.
+ *
+*/
+class CandidateStore
+{
+	public:
+
+		/**
+		 * \brief Constructor.
+		 * \param num_joints the number of arm joints
+		*/
+		CandidateStore(int num_joints = 0) : num_joints_(num_joints), num_pregrasps_(0) { }
+
+		/** Candidate sets are only moved, never copied. */
+		CandidateStore(const CandidateStore&) = delete;
+		CandidateStore& operator=(const CandidateStore&) = delete;
+		CandidateStore(CandidateStore&&) = default;
+		CandidateStore& operator=(CandidateStore&&) = default;
+
+		/**
+		 * \brief Remove all candidates, keeping the allocated memory.
+		 * \param num_joints the number of arm joints
+		 * \param num_pregrasps the number of pre-grasp poses per candidate
+		*/
+		void reset(int num_joints, int num_pregrasps = 0);
+
+		/**
+		 * \brief Reserve memory for a given number of candidates.
+		 * \param size the number of candidates
+		*/
+		void reserve(int size);
+
+		/**
+		 * \brief Add a candidate to the store.
+		 * \param id the grasp's index in the agile_grasp message
+		 * \param position the grasp position
+		 * \param orientation the grasp orientation
+		 * \param approach the grasp approach direction
+		 * \param width the aperture required by the robot hand to execute the grasp
+		 * \param joint_positions the Inverse Kinematics solution for the grasp pose (<num_joints> values)
+		 * \param pregrasp_joint_positions the Inverse Kinematics solutions for the pre-grasp poses (<num_pregrasps> x 
+		 * <num_joints> values)
+		 * \return the index of the new candidate
+		*/
+		int add(int id, const Eigen::Vector3d& position, const Eigen::Quaterniond& orientation,
+			const Eigen::Vector3d& approach, double width, const double* joint_positions, 
+			const double* pregrasp_joint_positions = NULL);
+
+		int size() const { return ids_.size(); }
+
+		int getNumJoints() const { return num_joints_; }
+
+		/**
+		 * \brief Return the memory reserved by the store (which is kept across scenes).
+		 * \return the size of the reserved arrays in bytes
+		*/
+		std::size_t getMemorySize() const;
+
+		int getNumPregrasps() const { return num_pregrasps_; }
+
+		int getId(int i) const { return ids_[i]; }
+
+		Eigen::Map<const Eigen::Vector3d> getPosition(int i) const
+		{
+			return Eigen::Map<const Eigen::Vector3d>(&positions_[3 * i]);
+		}
+
+		Eigen::Map<const Eigen::Quaterniond> getOrientation(int i) const
+		{
+			return Eigen::Map<const Eigen::Quaterniond>(&orientations_[4 * i]);
+		}
+
+		Eigen::Map<const Eigen::Vector3d> getApproach(int i) const
+		{
+			return Eigen::Map<const Eigen::Vector3d>(&approaches_[3 * i]);
+		}
+
+		double getWidth(int i) const { return widths_[i]; }
+
+		const double* getJointPositions(int i) const { return joint_positions_.data() + num_joints_ * i; }
+
+		const double* getPregraspJointPositions(int i) const
+		{
+			return pregrasp_joint_positions_.data() + num_pregrasps_ * num_joints_ * i;
+		}
+
+		double getScore(int i) const { return scores_[i]; }
+
+		void setScore(int i, double score) { scores_[i] = score; }
+
+
+	private:
+
+		int num_joints_; ///< the number of arm joints (the stride of joint_positions_)
+		std::vector<int> ids_; ///< the grasps' indices in the agile_grasp message
+		std::vector<double> positions_; ///< the grasp positions (3 values per candidate)
+		std::vector<double> orientations_; ///< the grasp orientations (4 values per candidate: x, y, z, w)
+		std::vector<double> approaches_; ///< the grasp approach directions (3 values per candidate)
+		std::vector<double> widths_; ///< the apertures required by the robot hand
+		int num_pregrasps_; ///< the number of pre-grasp poses per candidate
+		std::vector<double> joint_positions_; ///< the Inverse Kinematics solutions (<num_joints_> values per candidate)
+		std::vector<double> pregrasp_joint_positions_; ///< the pre-grasp IK solutions (<num_pregrasps_> x <num_joints_> 
+			///< values per candidate, ordered by increasing offset)
+		std::vector<double> scores_; ///< the scores (the lower, the likelier the grasp is to succeed)
+};
+
+#endif /* CANDIDATE_STORE_H */
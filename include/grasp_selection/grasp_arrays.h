@@ -0,0 +1,120 @@
+#ifndef GRASP_ARRAYS_H
+#define GRASP_ARRAYS_H
+
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+
+#include <agile_grasp/Grasps.h>
+
+#include <grasp_selection/arena.h>
+
+
+/** the alignment of the arrays in bytes (large enough for AVX) */
+const std::size_t SIMD_ALIGNMENT = 32;
+
+
+/** GraspArrays class
+ *
+ * \brief Structure-of-arrays storage for the grasps received from agile_grasp
+ *
+ * This class stores the grasps received from agile_grasp in arrays that are taken from an arena. Each vector quantity
+ * is stored as an N x 3 column-major array, so that each coordinate of all grasps is contiguous in memory and
+ * operations over all grasps, such as filtering them by masks, can be vectorized. The message is decoded in a single
+ * pass before any of the grasps are evaluated.
+ *
+*/
+class GraspArrays
+{
+	public:
+
+		typedef Eigen::Map<Eigen::Array<double, Eigen::Dynamic, 3>, Eigen::Aligned> Array3;
+		typedef Eigen::Map<Eigen::ArrayXd, Eigen::Aligned> Array1;
+		typedef Eigen::Map<Eigen::Array<bool, Eigen::Dynamic, 1> > Mask;
+
+		/**
+		 * \brief Constructor. Take uninitialized arrays from an arena.
+		 * \param size the number of grasps
+		 * \param arena the arena from which the arrays are taken
+		*/
+		GraspArrays(int size, Arena& arena);
+
+		/**
+		 * \brief Constructor. Decode all grasps in an agile_grasp message.
+		 * \param grasps the agile_grasp message
+		 * \param arena the arena from which the arrays are taken
+		*/
+		GraspArrays(const agile_grasp::Grasps& grasps, Arena& arena);
+
+		/**
+		 * \brief Return the grasps for which a mask is true.
+		 * \param mask the mask, one entry per grasp
+		 * \param arena the arena from which the arrays are taken
+		 * \return the selected grasps
+		*/
+		GraspArrays select(const Mask& mask, Arena& arena) const;
+
+		int size() const { return size_; }
+
+		int size_; ///< the number of grasps
+		int* ids_; ///< the grasps' indices in the agile_grasp message
+		Array3 centers_; ///< the grasp positions
+		Array3 surface_centers_; ///< the grasp positions projected back onto the surface of the object
+		Array3 axes_; ///< the hand axes
+		Array3 approaches_; ///< the grasp approach directions (as in the agile_grasp message)
+		Array3 binormals_; ///< the vectors orthogonal to the hand axes and the grasp approach directions
+		Array1 widths_; ///< the apertures required by the robot hand
+};
+
+
+/** CandidatePoses class
+ *
+ * \brief Structure-of-arrays storage for the robot hand poses generated from a set of grasps
+ *
+ * This class stores the robot hand poses generated from a set of grasps and a set of approach angles. Each pair of a
+ * grasp and an approach angle has a position, an approach direction, and two hand orientations that differ by a
+ * rotation of 180deg about the approach direction. The poses for the same approach angle are contiguous in memory.
+ *
+*/
+class CandidatePoses
+{
+	public:
+
+		typedef Eigen::Map<Eigen::Array<double, Eigen::Dynamic, 4>, Eigen::Aligned> Array4;
+
+		/**
+		 * \brief Constructor.
+		 * \param num_grasps the number of grasps
+		 * \param num_angles the number of approach angles
+		 * \param arena the arena from which the arrays are taken
+		*/
+		CandidatePoses(int num_grasps, int num_angles, Arena& arena);
+
+		/**
+		 * \brief Return the index of the pose for a given grasp and approach angle.
+		 * \param grasp the index of the grasp
+		 * \param angle the index of the approach angle
+		 * \return the index of the pose
+		*/
+		int index(int grasp, int angle) const { return angle * num_grasps_ + grasp; }
+
+		/**
+		 * \brief Return a hand orientation.
+		 * \param i the index of the pose
+		 * \param k which of the two hand orientations
+		 * \return the hand orientation
+		*/
+		Eigen::Quaterniond getOrientation(int i, int k) const
+		{
+			const Array4& orientations = (k == 0) ? first_orientations_ : second_orientations_;
+			return Eigen::Quaterniond(orientations(i, 3), orientations(i, 0), orientations(i, 1), orientations(i, 2));
+		}
+
+		int num_grasps_; ///< the number of grasps
+		int num_angles_; ///< the number of approach angles
+		GraspArrays::Array3 positions_; ///< the hand positions
+		GraspArrays::Array3 approaches_; ///< the rotated grasp approach directions
+		Array4 first_orientations_; ///< the first hand orientations (x, y, z, w)
+		Array4 second_orientations_; ///< the second hand orientations (x, y, z, w)
+};
+
+#endif /* GRASP_ARRAYS_H */
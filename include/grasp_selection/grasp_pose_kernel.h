@@ -0,0 +1,68 @@
+#ifndef GRASP_POSE_KERNEL_H
+#define GRASP_POSE_KERNEL_H
+
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+
+#include <vector>
+
+#include <grasp_selection/arena.h>
+#include <grasp_selection/grasp_arrays.h>
+
+
+/** GraspPoseKernel class
+ *
+ * \brief Generate robot hand poses for a set of grasps
+ *
+ * This class generates the robot hand poses for all grasps and approach angles in one batch. The approach directions
+ * and hand axes are rotated by all approach angles, and the two hand orientations per rotated grasp are assembled as
+ * rotation matrices, in vectorized passes over the grasp arrays. The rotation matrices are then converted directly to
+ * quaternions using fixed-size math.
+ *
+*/
+class GraspPoseKernel
+{
+	public:
+
+		/**
+		 * \brief Constructor.
+		 * \param axis_order the ordering of the axes in the robot hand frame
+		 * \param hand_offset distance between grasp position (fingertips of robot hand) and origin of hand frame
+		*/
+		GraspPoseKernel(const std::vector<int>& axis_order, double hand_offset);
+
+		/**
+		 * \brief Calculate the robot hand poses for a set of grasps and a set of approach angles.
+		 * \param grasps the grasps
+		 * \param theta the approach angles in degrees
+		 * \param poses the robot hand poses, one for each pair of a grasp and an approach angle
+		 * \param arena the arena for temporary data
+		*/
+		void calculatePoses(const GraspArrays& grasps, const ArenaVector<double>& theta, CandidatePoses& poses,
+			Arena& arena) const;
+
+
+	private:
+
+		/** the hand orientations as rotation matrices, one column-major matrix entry per column */
+		typedef Eigen::Map<Eigen::Array<double, Eigen::Dynamic, 9>, Eigen::Aligned> RotationArray;
+
+		/**
+		 * \brief Set the hand binormals (the third rotation matrix columns) from the approach vectors and hand axes.
+		 * \param rotations the rotation matrices
+		*/
+		void completeRotations(RotationArray& rotations) const;
+
+		/**
+		 * \brief Convert rotation matrices to normalized quaternions.
+		 * \param rotations the rotation matrices
+		 * \param orientations the quaternions (x, y, z, w)
+		*/
+		template <class Block>
+		void convertToQuaternions(const RotationArray& rotations, Block orientations) const;
+
+		int axis_order_[3]; ///< the ordering of the axes in the robot hand frame
+		double hand_offset_; ///< distance between grasp position and origin of hand frame
+};
+
+#endif /* GRASP_POSE_KERNEL_H */
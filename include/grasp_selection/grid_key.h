@@ -0,0 +1,20 @@
+#ifndef GRID_KEY_H
+#define GRID_KEY_H
+
+#include <cstdint>
+
+
+/**
+ * \brief Calculate the hash table key of a grid cell, for the uniform grids of the scene index and the IK trace.
+ * \param x the x-coordinate of the cell
+ * \param y the y-coordinate of the cell
+ * \param z the z-coordinate of the cell
+ * \return the key (21 bits per coordinate)
+*/
+inline int64_t calculateGridKey(int x, int y, int z)
+{
+	const int64_t offset = 1 << 20;
+	return ((x + offset) << 42) | ((y + offset) << 21) | (z + offset);
+}
+
+#endif /* GRID_KEY_H */
@@ -0,0 +1,215 @@
+#ifndef IK_SOLVER_H
+#define IK_SOLVER_H
+
+#include <geometry_msgs/PoseStamped.h>
+#include <moveit_msgs/GetPositionIK.h>
+#include <ros/ros.h>
+#include <sensor_msgs/JointState.h>
+#include <urdf/model.h>
+
+#include <string>
+#include <vector>
+
+#include <grasp_selection/ik_trace.h>
+
+#include <grasp_selection/SolveIK.h>
+
+
+/** IKSolver class
+ *
+ * \brief Interface for Inverse Kinematics solvers
+ *
+ * This class is the interface through which the reachability test solves Inverse Kinematics problems. The solvers
+ * either call a ROS service (MoveIt or the OpenRAVE ikfast service) or solve the problem in the same process. The
+ * solvers that work on the kinematic chain of the arm (ikfast and OpenRAVE) can reorder their solutions and seeds into
+ * the order of the joint states, so that all solvers give the joint positions in the same order.
+ *
+*/
+class IKSolver
+{
+	public:
+
+		/**
+		 * \brief Destructor.
+		*/
+		virtual ~IKSolver() { }
+
+		/**
+		 * \brief Solve the Inverse Kinematics problem for a given pose.
+		 * \param pose the pose for which the Inverse Kinematics problem is solved
+		 * \param seed the joint positions that the solver starts from (NULL for the current robot state)
+		 * \param attempts the maximum number of attempts that the solver can use to find a solution (if supported)
+		 * \param timeout the maximum time that the solver can spend to find a solution (if supported)
+		 * \param joint_positions the joint positions found (<getNumJoints()> values)
+		 * \return true if the solver found a solution, false otherwise
+		*/
+		virtual bool solve(const geometry_msgs::PoseStamped& pose, const double* seed, int attempts, double timeout,
+			double* joint_positions) = 0;
+
+		/**
+		 * \brief Set the current joint state of the robot. Solvers that start from the current robot state use it when
+		 * no seed is given.
+		 * \param joint_state the joint state
+		*/
+		virtual void setJointState(const sensor_msgs::JointState& joint_state) { }
+
+		int getNumJoints() const { return num_joints_; }
+
+
+	protected:
+
+		/**
+		 * \brief Constructor.
+		 * \param num_joints the number of arm joints in the solutions
+		*/
+		IKSolver(int num_joints) : num_joints_(num_joints) { }
+
+		/**
+		 * \brief Set the order of the joint positions in the solutions and seeds.
+		 * \param chain_names the names of the joints in the order of the kinematic chain used by the solver
+		 * \param joint_names the names of the joints in the order of the solutions (empty for the order of the chain)
+		 * \return true if each joint of the chain is in the joint names, false otherwise
+		*/
+		bool setJointOrder(const std::vector<std::string>& chain_names, const std::vector<std::string>& joint_names);
+
+		/**
+		 * \brief Reorder joint positions from the order of the solutions into the order of the chain.
+		 * \param joint_positions the joint positions in the order of the solutions
+		 * \param chain_positions the joint positions in the order of the chain
+		*/
+		void toChainOrder(const double* joint_positions, double* chain_positions) const;
+
+		/**
+		 * \brief Reorder joint positions from the order of the chain into the order of the solutions.
+		 * \param chain_positions the joint positions in the order of the chain
+		 * \param joint_positions the joint positions in the order of the solutions
+		*/
+		void fromChainOrder(const double* chain_positions, double* joint_positions) const;
+
+		int num_joints_; ///< the number of arm joints in the solutions
+		std::vector<int> chain_indices_; ///< the index in the chain of each joint in the solutions (empty: chain order)
+};
+
+
+/** MoveItIKSolver class
+ *
+ * \brief Solve Inverse Kinematics problems with the MoveIt /compute_ik ROS service
+ *
+*/
+class MoveItIKSolver : public IKSolver
+{
+	public:
+
+		/**
+		 * \brief Constructor. Wait for the ROS service.
+		 * \param node the ROS node
+		 * \param move_group the name of the move group, e.g., right_arm
+		 * \param arm_link the name of the link for motion planning, e.g., right_gripper
+		 * \param first_joint_index the index of the first arm joint in the robot state returned by MoveIt
+		 * \param num_joints the number of arm joints
+		*/
+		MoveItIKSolver(ros::NodeHandle& node, const std::string& move_group, const std::string& arm_link,
+			int first_joint_index, int num_joints);
+
+		bool solve(const geometry_msgs::PoseStamped& pose, const double* seed, int attempts, double timeout,
+			double* joint_positions);
+
+
+	private:
+
+		ros::ServiceClient ik_service_; ///< ROS service for Inverse Kinematics
+		moveit_msgs::GetPositionIK ik_; ///< the IK request and response (reused for all requests)
+		int first_joint_index_; ///< the index of the first arm joint in the robot state returned by MoveIt
+};
+
+
+/** OpenRaveIKSolver class
+ *
+ * \brief Solve Inverse Kinematics problems with the /ikfast_solver ROS service (see scripts/ikfast_service.py)
+ *
+*/
+class OpenRaveIKSolver : public IKSolver
+{
+	public:
+
+		/**
+		 * \brief Constructor. Wait for the ROS service.
+		 * \param node the ROS node
+		 * \param num_joints the number of arm joints
+		 * \param urdf the URDF model
+		 * \param base_link the base link of the ikfast chain used by the service, e.g., right_arm_mount
+		 * \param tip_link the tip link of the ikfast chain used by the service, e.g., right_gripper
+		 * \param joint_names the names of the joints in the order of the solutions (empty for the order of the chain)
+		*/
+		OpenRaveIKSolver(ros::NodeHandle& node, int num_joints, const urdf::Model& urdf, const std::string& base_link,
+			const std::string& tip_link, const std::vector<std::string>& joint_names = std::vector<std::string>());
+
+		bool solve(const geometry_msgs::PoseStamped& pose, const double* seed, int attempts, double timeout,
+			double* joint_positions);
+
+
+	private:
+
+		ros::ServiceClient ik_service_; ///< ROS service for Inverse Kinematics
+		grasp_selection::SolveIK ik_; ///< the IK request and response (reused for all requests)
+};
+
+
+/** RecordingIKSolver class
+ *
+ * \brief Records the requests and responses of another Inverse Kinematics solver to an IK trace
+ *
+ * The trace can be served by the ik_replay_node in place of MoveIt or OpenRAVE. The recorded latency is the wall time
+ * of the wrapped solver.
+ *
+*/
+class RecordingIKSolver : public IKSolver
+{
+	public:
+
+		/**
+		 * \brief Constructor.
+		 * \param solver the solver whose requests are recorded (owned by this object)
+		 * \param filename the name of the trace file
+		*/
+		RecordingIKSolver(IKSolver* solver, const std::string& filename);
+
+		/**
+		 * \brief Destructor.
+		*/
+		~RecordingIKSolver()
+		{
+			delete solver_;
+		}
+
+		bool solve(const geometry_msgs::PoseStamped& pose, const double* seed, int attempts, double timeout,
+			double* joint_positions);
+
+		void setJointState(const sensor_msgs::JointState& joint_state) { solver_->setJointState(joint_state); }
+
+
+	private:
+
+		IKSolver* solver_; ///< the solver whose requests are recorded
+		IKTraceWriter writer_; ///< the trace
+};
+
+
+/**
+ * \brief Wait until a ROS service for Inverse Kinematics is available.
+ * \param service the ROS service client
+*/
+void waitForIKService(ros::ServiceClient& service);
+
+/**
+ * \brief Collect the joints on the path between two links of a URDF model.
+ * \param urdf the URDF model
+ * \param base_link the first link of the path
+ * \param tip_link the last link of the path
+ * \param joints the joints, from the base link to the tip link
+ * \return true if the path exists, false otherwise
+*/
+bool collectJoints(const urdf::Model& urdf, const std::string& base_link, const std::string& tip_link,
+	std::vector<boost::shared_ptr<const urdf::Joint> >& joints);
+
+#endif /* IK_SOLVER_H */
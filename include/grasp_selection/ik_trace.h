@@ -0,0 +1,140 @@
+#ifndef IK_TRACE_H
+#define IK_TRACE_H
+
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+
+#include <geometry_msgs/Pose.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <grasp_selection/grid_key.h>
+
+
+/** IKTraceRecord struct
+ *
+ * \brief An IK request and its response, as stored in an IK trace
+ *
+*/
+struct IKTraceRecord
+{
+	Eigen::Vector3d position_; ///< the position of the requested pose
+	Eigen::Quaterniond orientation_; ///< the orientation of the requested pose
+	bool has_seed_; ///< whether the request had a seed
+	bool success_; ///< whether the solver found a solution
+	int64_t latency_; ///< the time that the solver took (nanoseconds)
+	std::vector<double> seed_; ///< the seed (only if <has_seed_>)
+	std::vector<double> joint_positions_; ///< the solution (only if <success_>)
+
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+
+/** IKTraceWriter class
+ *
+ * \brief Writes IK requests and responses to a binary trace file
+ *
+ * The file starts with a header (the magic "GSIK", the format version and the number of joints, each as 32-bit
+ * integers). It is followed by one record per request: the position and the orientation (x, y, z, w) of the requested
+ * pose (7 doubles), the flags (bit 0: has seed, bit 1: success) and the latency in nanoseconds (int64), the seed if
+ * the request had one, and the solution if the solver found one (one double per joint each). All values are in the
+ * byte order of the machine that wrote the file.
+ *
+*/
+class IKTraceWriter
+{
+	public:
+
+		/**
+		 * \brief Constructor. Create the trace file.
+		 * \param filename the name of the trace file
+		 * \param num_joints the number of joints in the seeds and the solutions
+		*/
+		IKTraceWriter(const std::string& filename, int num_joints);
+
+		/**
+		 * \brief Destructor. Close the trace file.
+		*/
+		~IKTraceWriter();
+
+		/**
+		 * \brief Add a request and its response to the trace.
+		 * \param pose the requested pose
+		 * \param seed the seed (NULL if the request had none)
+		 * \param success whether the solver found a solution
+		 * \param joint_positions the solution (only read if <success> is true)
+		 * \param latency the time that the solver took (nanoseconds)
+		*/
+		void write(const geometry_msgs::Pose& pose, const double* seed, bool success, const double* joint_positions,
+			int64_t latency);
+
+		bool isOpen() const { return file_ != NULL; }
+
+
+	private:
+
+		FILE* file_; ///< the trace file
+		int num_joints_; ///< the number of joints in the seeds and the solutions
+};
+
+
+/** IKTrace class
+ *
+ * \brief The IK requests and responses read from a trace file, with a lookup by pose
+ *
+ * The records are sorted into a uniform grid by the positions of their poses, so that the record closest to a pose can
+ * be found without visiting all records.
+ *
+*/
+class IKTrace
+{
+	public:
+
+		/**
+		 * \brief Constructor.
+		 * \param cell_size the edge length of the grid cells used for the lookup
+		 * \param orientation_weight the weight of the orientation difference (1 - |<q1,q2>|) in the pose distance, in
+		 * meters
+		*/
+		IKTrace(double cell_size = 0.02, double orientation_weight = 0.1);
+
+		/**
+		 * \brief Read a trace file, replacing the current records.
+		 * \param filename the name of the trace file
+		 * \return true if the file could be read, false otherwise
+		*/
+		bool read(const std::string& filename);
+
+		/**
+		 * \brief Find the record whose pose is closest to a given pose.
+		 * \param pose the pose
+		 * \param max_distance the maximum distance between the poses (position distance plus weighted orientation
+		 * difference)
+		 * \param distance the distance to the found record
+		 * \return the index of the record, or -1 if there is no record within <max_distance>
+		*/
+		int findNearest(const geometry_msgs::Pose& pose, double max_distance, double& distance) const;
+
+		const IKTraceRecord& getRecord(int index) const { return records_[index]; }
+
+		int size() const { return records_.size(); }
+
+		int getNumJoints() const { return num_joints_; }
+
+
+	private:
+
+		typedef std::unordered_map<int64_t, std::vector<int> > CellMap;
+
+		double cell_size_; ///< the edge length of the grid cells
+		double orientation_weight_; ///< the weight of the orientation difference in the pose distance
+		int num_joints_; ///< the number of joints in the seeds and the solutions
+		std::vector<IKTraceRecord, Eigen::aligned_allocator<IKTraceRecord> > records_; ///< the records
+		CellMap cells_; ///< the indices of the records in each non-empty grid cell
+};
+
+#endif /* IK_TRACE_H */
@@ -0,0 +1,93 @@
+#ifndef IKFAST_SOLVER_H
+#define IKFAST_SOLVER_H
+
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+
+#include <urdf/model.h>
+
+#include <string>
+#include <vector>
+
+#include <grasp_selection/ik_solver.h>
+
+
+/** IKFastSolver class
+ *
+ * \brief Solve Inverse Kinematics problems in-process with the ikfast solver for the Baxter right arm
+ *
+ * This class calls the analytical ikfast solver in the openrave directory directly instead of the /ikfast_solver ROS
+ * service, so it does not need OpenRAVE, a ROS master or any other process. Like OpenRAVE, it samples the free joint
+ * of the solver at a fixed resolution within its limits, keeps the solutions within the joint limits, and returns the
+ * solution closest to the seed (or to the current joint positions if no seed is given). The solutions and seeds are in
+ * the order of the given joint names, or in the order of the ikfast chain (the same order as the /ikfast_solver
+ * service) if no joint names are given. The forward kinematics always use the order of the chain.
+ *
+*/
+class IKFastSolver : public IKSolver
+{
+	public:
+
+		/**
+		 * \brief Constructor. Extract the transform to the base of the ikfast chain and the joint limits from a URDF
+		 * model.
+		 * \param urdf the URDF model
+		 * \param planning_frame the frame in which the poses are given
+		 * \param base_link the base link of the ikfast chain, e.g., right_arm_mount
+		 * \param tip_link the tip link of the ikfast chain, e.g., right_gripper
+		 * \param joint_names the names of the joints in the order of the solutions (empty for the order of the chain)
+		 * \param free_joint_step the resolution at which the free joint is sampled (in radians)
+		*/
+		IKFastSolver(const urdf::Model& urdf, const std::string& planning_frame, const std::string& base_link,
+			const std::string& tip_link, const std::vector<std::string>& joint_names = std::vector<std::string>(),
+			double free_joint_step = 0.1);
+
+		bool solve(const geometry_msgs::PoseStamped& pose, const double* seed, int attempts, double timeout,
+			double* joint_positions);
+
+		void setJointState(const sensor_msgs::JointState& joint_state);
+
+		/**
+		 * \brief Calculate the pose of the tip link for given joint positions (forward kinematics).
+		 * \param joint_positions the joint positions, in the order of the ikfast chain
+		 * \return the pose of the tip link in the planning frame
+		*/
+		Eigen::Affine3d calculatePose(const double* joint_positions) const;
+
+		/**
+		 * \brief Check whether the solver could be set up from the URDF model.
+		 * \return true if the URDF model contains the chains to the base link and to the tip link, false otherwise
+		*/
+		bool isValid() const { return is_valid_; }
+
+		const std::vector<std::string>& getJointNames() const { return joint_names_; }
+
+		const Eigen::Matrix<double, 2, Eigen::Dynamic>& getJointLimits() const { return joint_limits_; }
+
+		EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+
+	private:
+
+		/**
+		 * \brief Solve the Inverse Kinematics problem for one value of the free joint.
+		 * \param translation the position of the tip link in the frame of the base link
+		 * \param rotation the orientation of the tip link in the frame of the base link (row-major 3 x 3 matrix)
+		 * \param free_value the value of the free joint
+		 * \param reference the joint positions that the solution should be close to
+		 * \param best_distance the squared distance of the best solution so far, updated if a closer solution is found
+		 * \param best the best solution so far, updated if a closer solution is found
+		*/
+		void solveForFreeValue(const double* translation, const double* rotation, double free_value,
+			const Eigen::VectorXd& reference, double& best_distance, Eigen::VectorXd& best) const;
+
+		Eigen::Affine3d base_transform_; ///< the pose of the base link of the ikfast chain in the planning frame
+		Eigen::Matrix<double, 2, Eigen::Dynamic> joint_limits_; ///< the lower (row 0) and upper (row 1) joint limits
+		std::vector<std::string> joint_names_; ///< the names of the joints in the ikfast chain
+		Eigen::VectorXd current_joint_positions_; ///< the current joint positions of the robot arm
+		int free_joint_; ///< the index of the free joint in the ikfast chain
+		double free_joint_step_; ///< the resolution at which the free joint is sampled
+		bool is_valid_; ///< whether the solver could be set up from the URDF model
+};
+
+#endif /* IKFAST_SOLVER_H */
@@ -0,0 +1,67 @@
+#ifndef JOINT_TRAITS_H
+#define JOINT_TRAITS_H
+
+#include <Eigen/Dense>
+
+
+/** the number of arm joints of the Baxter research robot */
+const int BAXTER_NUM_JOINTS = 7;
+
+
+/** JointTraits struct
+ *
+ * \brief Joint space types for a number of arm joints known at compile time
+ *
+ * This struct maps the number of arm joints (DOF) to fixed-size joint types. With a fixed DOF, joint computations
+ * are unrolled by the compiler and joint positions are stored on the stack. With DOF = Eigen::Dynamic, the types are
+ * the fallback for robot arms whose number of joints is only known at runtime. A JointVector constructed from the
+ * number of joints has the right size for both.
+ *
+*/
+template <int DOF>
+struct JointTraits
+{
+	typedef Eigen::Matrix<double, DOF, 1> JointVector; ///< the joint positions of the robot arm
+	typedef Eigen::Matrix<double, 2, DOF> JointLimits; ///< the lower (row 0) and upper (row 1) joint limits
+};
+
+
+/**
+ * \brief Calculate the joint limits distance for a set of joint positions.
+ * \param joint_positions the joint positions (<num_joints> contiguous values)
+ * \param joint_limits the joint limits (2 x <num_joints> matrix in column-major order)
+ * \param num_joints the number of arm joints (has to be equal to DOF if DOF is fixed)
+ * \param limits_distance the preferred distance from the joint limits
+ * \return the sum of squared violations of the preferred distance from the joint limits
+*/
+template <int DOF>
+inline double calculateJointLimitsDistance(const double* joint_positions, const double* joint_limits, int num_joints,
+	double limits_distance)
+{
+	typedef JointTraits<DOF> Traits;
+	Eigen::Map<const typename Traits::JointVector> q(joint_positions, num_joints);
+	Eigen::Map<const typename Traits::JointLimits> limits(joint_limits, 2, num_joints);
+
+	Eigen::Array<double, DOF, 1> min = (q - limits.row(0).transpose()).array().abs().min(
+		(q - limits.row(1).transpose()).array().abs());
+	return (limits_distance - min).max(0.0).square().sum();
+}
+
+
+/**
+ * \brief Calculate the largest change of a single joint between two sets of joint positions.
+ * \param from the first set of joint positions (<num_joints> contiguous values)
+ * \param to the second set of joint positions (<num_joints> contiguous values)
+ * \param num_joints the number of arm joints (has to be equal to DOF if DOF is fixed)
+ * \return the largest absolute difference between corresponding joint positions
+*/
+template <int DOF>
+inline double calculateMaxJointStep(const double* from, const double* to, int num_joints)
+{
+	typedef JointTraits<DOF> Traits;
+	Eigen::Map<const typename Traits::JointVector> q0(from, num_joints);
+	Eigen::Map<const typename Traits::JointVector> q1(to, num_joints);
+	return (q1 - q0).cwiseAbs().maxCoeff();
+}
+
+#endif /* JOINT_TRAITS_H */
@@ -0,0 +1,110 @@
+#ifndef MEMORY_USAGE_H
+#define MEMORY_USAGE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+
+/** AllocationCounter class
+ *
+ * \brief Counts the heap allocations of the process
+ *
+ * The counts are incremented by the replacements of the global operator new in counting_new.cpp, which an executable
+ * has to be built with (see CMakeLists.txt). Without them, the counts stay zero. Counting is two relaxed atomic
+ * additions per allocation, so it can stay enabled in production. The counts include the allocations of all threads,
+ * e.g., of the ROS connections.
+ *
+*/
+class AllocationCounter
+{
+	public:
+
+		/**
+		 * \brief Count an allocation.
+		 * \param num_bytes the size of the allocation
+		*/
+		static void count(std::size_t num_bytes)
+		{
+			num_allocations_.fetch_add(1, std::memory_order_relaxed);
+			num_bytes_.fetch_add(num_bytes, std::memory_order_relaxed);
+		}
+
+		/**
+		 * \brief Return the number of heap allocations since the process was started.
+		 * \return the number of allocations
+		*/
+		static uint64_t getNumAllocations() { return num_allocations_.load(std::memory_order_relaxed); }
+
+		/**
+		 * \brief Return the number of bytes allocated on the heap since the process was started (not counting the
+		 * released memory).
+		 * \return the number of bytes
+		*/
+		static uint64_t getNumBytes() { return num_bytes_.load(std::memory_order_relaxed); }
+
+
+	private:
+
+		static std::atomic<uint64_t> num_allocations_; ///< the number of heap allocations
+		static std::atomic<uint64_t> num_bytes_; ///< the number of bytes allocated on the heap
+};
+
+
+/**
+ * \brief The memory usage of a section of code, e.g., of a request.
+*/
+struct MemoryUsage
+{
+	uint64_t num_allocations_; ///< the number of heap allocations
+	uint64_t num_bytes_; ///< the number of bytes allocated on the heap
+	uint64_t rss_; ///< the resident set size of the process at the end (bytes)
+	int64_t peak_rss_increase_; ///< how far the peak resident set size rose above the one at the start (bytes)
+};
+
+
+/** MemoryProbe class
+ *
+ * \brief Measures the memory usage of a scope
+ *
+ * This class records the heap allocations (see AllocationCounter) and the increase of the peak resident set size from
+ * its construction to its destruction. The peak is read from /proc/self/status and reset at the start by writing to
+ * /proc/self/clear_refs, so the increase includes memory that was allocated and released again within the scope. If
+ * the peak cannot be reset (Linux before 4.0), only an increase of the peak since the process was started is seen.
+ * Reading and resetting the peak takes a few tens of microseconds.
+ *
+*/
+class MemoryProbe
+{
+	public:
+
+		/**
+		 * \brief Constructor. Start measuring.
+		 * \param usage the memory usage that is set when the probe goes out of scope
+		*/
+		MemoryProbe(MemoryUsage& usage);
+
+		/**
+		 * \brief Destructor. Set the memory usage since the construction.
+		*/
+		~MemoryProbe();
+
+		/**
+		 * \brief Read the resident set size of the process.
+		 * \param rss the current resident set size (bytes)
+		 * \param peak_rss the peak resident set size (bytes)
+		 * \return true if the sizes could be read, false otherwise
+		*/
+		static bool readRSS(uint64_t& rss, uint64_t& peak_rss);
+
+
+	private:
+
+		MemoryUsage& usage_; ///< the memory usage that is set when the probe goes out of scope
+		uint64_t num_allocations_; ///< the number of heap allocations at the start
+		uint64_t num_bytes_; ///< the number of allocated bytes at the start
+		uint64_t rss_; ///< the resident set size at the start
+		uint64_t peak_rss_; ///< the peak resident set size after the start
+};
+
+#endif /* MEMORY_USAGE_H */
@@ -0,0 +1,82 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <cstdint>
+
+
+/** PerfCounters class
+ *
+ * \brief Hardware performance counters of the calling thread
+ *
+ * This class opens a group of hardware performance counters (CPU cycles, retired instructions, last-level cache misses
+ * and mispredicted branches) with perf_event_open for the thread that creates it, counting in user space only. The
+ * counters are read together, and scaled up if the kernel had to multiplex them with other events. If the kernel
+ * denies access (see /proc/sys/kernel/perf_event_paranoid) or the CPU has no such counters, e.g., in a virtual
+ * machine, the counters are not available and always read as zero. A counter that the CPU does not support reads as
+ * zero while the others are counted.
+ *
+ * Each read is a system call of about a microsecond. The counters only count the thread that created them, not the
+ * threads of parallel regions that it starts.
+ *
+*/
+class PerfCounters
+{
+	public:
+
+		/**
+		 * \brief The hardware events that are counted.
+		*/
+		enum Counter
+		{
+			CYCLES, ///< CPU cycles
+			INSTRUCTIONS, ///< retired instructions
+			CACHE_MISSES, ///< last-level cache misses
+			BRANCH_MISSES, ///< mispredicted branches
+			NUM_COUNTERS
+		};
+
+		/**
+		 * \brief The values of all counters.
+		*/
+		struct Values
+		{
+			uint64_t counts_[NUM_COUNTERS]; ///< the value of each counter
+		};
+
+		/**
+		 * \brief Constructor. Open and start the counters for the calling thread.
+		*/
+		PerfCounters();
+
+		/**
+		 * \brief Destructor. Close the counters.
+		*/
+		~PerfCounters();
+
+		/**
+		 * \brief Read the counters.
+		 * \param values the values of the counters since they were started (all zero if they are not available)
+		*/
+		void read(Values& values) const;
+
+		/**
+		 * \brief Check whether the counters could be opened.
+		 * \return true if at least the cycle counter is counted, false otherwise
+		*/
+		bool isAvailable() const { return fds_[CYCLES] >= 0; }
+
+		/**
+		 * \brief Return the name of a counter.
+		 * \param counter the counter
+		 * \return the name
+		*/
+		static const char* getCounterName(Counter counter);
+
+
+	private:
+
+		int fds_[NUM_COUNTERS]; ///< the file descriptor of each counter (-1: not counted), the first leads the group
+		int num_open_; ///< the number of counters in the group
+};
+
+#endif /* PERF_COUNTERS_H */
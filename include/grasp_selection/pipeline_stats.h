@@ -0,0 +1,464 @@
+#ifndef PIPELINE_STATS_H
+#define PIPELINE_STATS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <grasp_selection/perf_counters.h>
+#include <grasp_selection/trace_recorder.h>
+
+
+/** LatencyHistogram class
+ *
+ * \brief Histogram of latencies with a bounded relative error
+ *
+ * This class counts latencies (in nanoseconds) in log-linear buckets, in the style of an HDR histogram: each power of
+ * two is split into 32 linear sub-buckets, so that the relative error of a percentile is below 1/32 for any latency.
+ * Recording a latency is a few integer operations and does not allocate memory.
+ *
+*/
+class LatencyHistogram
+{
+	public:
+
+		/**
+		 * \brief Constructor.
+		*/
+		LatencyHistogram();
+
+		/**
+		 * \brief Record a latency.
+		 * \param nanoseconds the latency in nanoseconds
+		*/
+		void record(uint64_t nanoseconds);
+
+		/**
+		 * \brief Add the latencies recorded by another histogram.
+		 * \param other the other histogram
+		*/
+		void add(const LatencyHistogram& other);
+
+		/**
+		 * \brief Remove all recorded latencies, keeping the allocated memory.
+		*/
+		void reset();
+
+		/**
+		 * \brief Calculate a percentile of the recorded latencies.
+		 * \param percentile the percentile (between 0 and 100)
+		 * \return the latency in seconds (0 if no latencies have been recorded)
+		*/
+		double calculatePercentile(double percentile) const;
+
+		/**
+		 * \brief Return the mean of the recorded latencies.
+		 * \return the mean latency in seconds (0 if no latencies have been recorded)
+		*/
+		double getMean() const { return (count_ > 0) ? 1e-9 * sum_ / count_ : 0.0; }
+
+		/**
+		 * \brief Return the largest recorded latency.
+		 * \return the largest latency in seconds
+		*/
+		double getMax() const { return 1e-9 * max_; }
+
+		uint64_t getCount() const { return count_; }
+
+
+	private:
+
+		/**
+		 * \brief Calculate the bucket that counts a latency.
+		 * \param nanoseconds the latency in nanoseconds
+		 * \return the index of the bucket
+		*/
+		static int calculateBucket(uint64_t nanoseconds);
+
+		/**
+		 * \brief Calculate the smallest latency counted by a bucket.
+		 * \param bucket the index of the bucket
+		 * \return the latency in nanoseconds
+		*/
+		static uint64_t calculateLowerBound(int bucket);
+
+		static const int SUB_BUCKET_BITS = 5; ///< log2 of the number of sub-buckets per power of two
+		static const int NUM_SUB_BUCKETS = 1 << SUB_BUCKET_BITS; ///< the number of sub-buckets per power of two
+
+		std::vector<uint64_t> counts_; ///< the number of latencies in each bucket
+		uint64_t count_; ///< the number of recorded latencies
+		uint64_t sum_; ///< the sum of the recorded latencies in nanoseconds
+		uint64_t max_; ///< the largest recorded latency in nanoseconds
+};
+
+
+/** RejectionCounts class
+ *
+ * \brief Counts of the grasps rejected by each check of the reachability test
+ *
+ * This class counts how many grasps each check of the reachability test rejected, so that it is possible to tell why 
+ * no reachable grasps were found and which check costs the most time. Each grasp is counted once, for the first check 
+ * that rejects it. The workspace and aperture checks count grasps; the later checks count candidates, i.e., robot hand 
+ * poses (one for each remaining grasp, approach angle and hand orientation). The time spent on a candidate before it 
+ * was rejected is added to the check that rejected it; the workspace and aperture checks run as one vectorized pass, 
+ * so no time is added to them.
+ *
+*/
+class RejectionCounts
+{
+	public:
+
+		/**
+		 * \brief The checks of the reachability test, in the order in which they are applied.
+		*/
+		enum Check
+		{
+			WORKSPACE, ///< the grasp lies outside the workspace
+			APERTURE, ///< the grasp is too small or too large for the robot hand
+			INVERSE_KINEMATICS, ///< no IK solution within the joint limits for the grasp pose
+			COLLISION, ///< the robot hand collides with the point cloud
+			APPROACH, ///< a pre-grasp pose is not reachable, or only with a large joint motion
+			NUM_CHECKS
+		};
+
+		/**
+		 * \brief Constructor.
+		*/
+		RejectionCounts() { reset(); }
+
+		/**
+		 * \brief Set all counts and times to zero.
+		*/
+		void reset();
+
+		/**
+		 * \brief Add the counts and times of another set of rejection counts.
+		 * \param other the other rejection counts
+		*/
+		void add(const RejectionCounts& other);
+
+		/**
+		 * \brief Record rejected grasps or candidates.
+		 * \param check the check that rejected them
+		 * \param count the number of rejected grasps or candidates
+		 * \param nanoseconds the time spent on them before they were rejected
+		*/
+		void reject(Check check, uint64_t count, uint64_t nanoseconds = 0)
+		{
+			rejected_[check] += count;
+			rejected_time_[check] += nanoseconds;
+		}
+
+		void addGrasps(uint64_t count) { num_grasps_ += count; }
+
+		void addCandidates(uint64_t count) { num_candidates_ += count; }
+
+		void addReachable(uint64_t count) { num_reachable_ += count; }
+
+		uint64_t getNumGrasps() const { return num_grasps_; }
+
+		uint64_t getNumCandidates() const { return num_candidates_; }
+
+		uint64_t getNumReachable() const { return num_reachable_; }
+
+		uint64_t getRejected(Check check) const { return rejected_[check]; }
+
+		/**
+		 * \brief Return the time spent on the grasps or candidates rejected by a check.
+		 * \param check the check
+		 * \return the time in seconds
+		*/
+		double getRejectedTime(Check check) const { return 1e-9 * rejected_time_[check]; }
+
+		/**
+		 * \brief Return the name of a check.
+		 * \param check the check
+		 * \return the name
+		*/
+		static const char* getCheckName(Check check);
+
+
+	private:
+
+		uint64_t num_grasps_; ///< the number of grasps received
+		uint64_t num_candidates_; ///< the number of candidates evaluated after the workspace and aperture checks
+		uint64_t num_reachable_; ///< the number of candidates that passed all checks
+		uint64_t rejected_[NUM_CHECKS]; ///< the number of grasps or candidates rejected by each check
+		uint64_t rejected_time_[NUM_CHECKS]; ///< the time spent on the rejected candidates of each check (nanoseconds)
+};
+
+
+/** PipelineStats class
+ *
+ * \brief Latency statistics for the stages of the grasp selection
+ *
+ * This class keeps a latency histogram for each stage of the grasp selection, from the point cloud conversion to the
+ * creation of the service response, and the rejection counts of the reachability test. Both count all executions 
+ * since the node was started. Each stage also has an interval histogram that only counts the executions since the last
+ * call of resetInterval(), so that the published statistics follow changes of the latencies. Recording is not 
+ * thread-safe; stages that run in parallel are timed as a whole. If a trace recorder is set, each recorded stage is 
+ * also added to the trace as an event. If the hardware performance counters are enabled, the counts of each stage are 
+ * summed as well.
+ *
+*/
+class PipelineStats
+{
+	public:
+
+		/**
+		 * \brief The stages of the grasp selection.
+		*/
+		enum Stage
+		{
+			CLOUD_CONVERSION, ///< conversion of the point cloud message
+			VOXELIZATION, ///< downsampling of the point cloud
+			SCENE_INDEXING, ///< creation of the spatial index of the point cloud
+			FILTERING, ///< decoding of the grasps message, and the workspace and aperture checks
+			POSE_GENERATION, ///< calculation of the robot hand poses
+			INVERSE_KINEMATICS, ///< a single IK request
+			COLLISION_CHECKING, ///< a single collision check of a robot hand pose
+			SCORING, ///< the ranking or the selection of the reachable grasps
+			TRAJECTORY_PLANNING, ///< trajectory planning for the top ranked grasps
+			VISUALIZATION, ///< creation and publication of the Rviz markers
+			RESPONSE, ///< creation of the service response
+			NUM_STAGES
+		};
+
+		typedef TraceRecorder::Clock Clock;
+
+		/**
+		 * \brief Constructor.
+		*/
+		PipelineStats() : num_collision_points_(0), num_ik_allocations_(0), trace_(NULL), counters_(NULL)
+		{
+			for (int i = 0; i < NUM_STAGES; i++)
+			{
+				std::fill(counts_[i].counts_, counts_[i].counts_ + PerfCounters::NUM_COUNTERS, 0);
+				std::fill(request_counts_[i].counts_, request_counts_[i].counts_ + PerfCounters::NUM_COUNTERS, 0);
+			}
+			std::fill(request_total_.counts_, request_total_.counts_ + PerfCounters::NUM_COUNTERS, 0);
+		}
+
+		/**
+		 * \brief Destructor.
+		*/
+		~PipelineStats()
+		{
+			delete counters_;
+		}
+
+		/**
+		 * \brief Record the latency of a stage that ends now.
+		 * \param stage the stage
+		 * \param start the time at which the stage started
+		*/
+		void record(Stage stage, const Clock::time_point& start)
+		{
+			const Clock::time_point end = Clock::now();
+			std::chrono::nanoseconds latency = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
+			histograms_[stage].record(latency.count());
+			interval_histograms_[stage].record(latency.count());
+			if (trace_ != NULL)
+				trace_->record(getStageName(stage), start, end);
+		}
+
+		/**
+		 * \brief Add the hardware performance counts of a stage that ends now.
+		 * \param stage the stage
+		 * \param start the values of the counters at which the stage started
+		*/
+		void recordCounts(Stage stage, const PerfCounters::Values& start)
+		{
+			PerfCounters::Values end;
+			counters_->read(end);
+			for (int i = 0; i < PerfCounters::NUM_COUNTERS; i++)
+			{
+				counts_[stage].counts_[i] += end.counts_[i] - start.counts_[i];
+				request_counts_[stage].counts_[i] += end.counts_[i] - start.counts_[i];
+			}
+		}
+
+		/**
+		 * \brief Start counting the hardware events of a request: read the counters and clear the counts of the stages
+		 * in the request. Does nothing if the counters are not enabled.
+		*/
+		void startRequest();
+
+		/**
+		 * \brief Finish counting the hardware events of a request: read the counters again and keep the difference.
+		 * Does nothing if the counters are not enabled.
+		*/
+		void endRequest();
+
+		/**
+		 * \brief Return the latency histogram of a stage.
+		 * \param stage the stage
+		 * \return the histogram
+		*/
+		const LatencyHistogram& getHistogram(Stage stage) const { return histograms_[stage]; }
+
+		/**
+		 * \brief Return the latency histogram of a stage since the last call of resetInterval().
+		 * \param stage the stage
+		 * \return the histogram
+		*/
+		const LatencyHistogram& getIntervalHistogram(Stage stage) const { return interval_histograms_[stage]; }
+
+		/**
+		 * \brief Start a new interval: clear the interval histograms of all stages.
+		*/
+		void resetInterval()
+		{
+			for (int i = 0; i < NUM_STAGES; i++)
+				interval_histograms_[i].reset();
+		}
+
+		/**
+		 * \brief Return the name of a stage.
+		 * \param stage the stage
+		 * \return the name
+		*/
+		static const char* getStageName(Stage stage);
+
+		/**
+		 * \brief Count the points tested by a collision check of a robot hand pose.
+		 * \param num_points the number of points
+		*/
+		void addCollisionPoints(uint64_t num_points) { num_collision_points_ += num_points; }
+
+		/**
+		 * \brief Return the number of points tested by the collision checks of the robot hand poses.
+		 * \return the number of points
+		*/
+		uint64_t getNumCollisionPoints() const { return num_collision_points_; }
+
+		/**
+		 * \brief Count the heap allocations of an IK request (see AllocationCounter). They are made by the IK backend,
+		 * e.g., by the ikfast solution list or a ROS service client, which the arena of the pipeline cannot serve.
+		 * \param num_allocations the number of allocations
+		*/
+		void addIKAllocations(uint64_t num_allocations) { num_ik_allocations_ += num_allocations; }
+
+		/**
+		 * \brief Return the number of heap allocations of the IK requests.
+		 * \return the number of allocations
+		*/
+		uint64_t getNumIKAllocations() const { return num_ik_allocations_; }
+
+		RejectionCounts& getRejections() { return rejections_; }
+
+		const RejectionCounts& getRejections() const { return rejections_; }
+
+		/**
+		 * \brief Set the trace recorder that the recorded stages are added to.
+		 * \param trace the trace recorder (NULL: no tracing)
+		*/
+		void setTraceRecorder(TraceRecorder* trace) { trace_ = trace; }
+
+		TraceRecorder* getTraceRecorder() const { return trace_; }
+
+		/**
+		 * \brief Count the hardware events of each stage. Only the stages that run on the calling thread are counted.
+		 * \return true if the counters are available, false if the kernel denied access or the CPU has no counters
+		*/
+		bool enablePerfCounters();
+
+		/**
+		 * \brief Return the hardware performance counters.
+		 * \return the counters (NULL if they are not enabled or not available)
+		*/
+		const PerfCounters* getPerfCounters() const { return counters_; }
+
+		/**
+		 * \brief Return the hardware performance counts of a stage, summed over all its executions.
+		 * \param stage the stage
+		 * \return the counts (all zero if the counters are not enabled or not available)
+		*/
+		const PerfCounters::Values& getPerfCounts(Stage stage) const { return counts_[stage]; }
+
+		/**
+		 * \brief Return the hardware performance counts of a stage in the last request (see startRequest()).
+		 * \param stage the stage
+		 * \return the counts, summed over the executions of the stage in the request
+		*/
+		const PerfCounters::Values& getRequestPerfCounts(Stage stage) const { return request_counts_[stage]; }
+
+		/**
+		 * \brief Return the hardware performance counts of the whole last request, from startRequest() to endRequest().
+		 * \return the counts
+		*/
+		const PerfCounters::Values& getRequestPerfTotal() const { return request_total_; }
+
+
+	private:
+
+		LatencyHistogram histograms_[NUM_STAGES]; ///< the latency histogram of each stage
+		LatencyHistogram interval_histograms_[NUM_STAGES]; ///< the latency histogram of each stage in this interval
+		TraceRecorder* trace_; ///< the trace recorder that the recorded stages are added to (NULL: no tracing)
+		RejectionCounts rejections_; ///< the rejection counts of all evaluated scenes
+		uint64_t num_collision_points_; ///< the number of points tested by the collision checks of the robot hand poses
+		uint64_t num_ik_allocations_; ///< the number of heap allocations of the IK requests
+		PerfCounters* counters_; ///< the hardware performance counters (NULL: not counted)
+		PerfCounters::Values counts_[NUM_STAGES]; ///< the hardware performance counts of each stage
+		PerfCounters::Values request_counts_[NUM_STAGES]; ///< the counts of each stage in the last request
+		PerfCounters::Values request_start_; ///< the values of the counters at the start of the request
+		PerfCounters::Values request_total_; ///< the hardware performance counts of the whole last request
+};
+
+
+/** StageTimer class
+ *
+ * \brief Records the latency of a stage when it goes out of scope
+ *
+*/
+class StageTimer
+{
+	public:
+
+		/**
+		 * \brief Constructor. Start timing a stage.
+		 * \param stats the statistics that the latency is recorded in (nothing is recorded if NULL)
+		 * \param stage the stage
+		*/
+		StageTimer(PipelineStats* stats, PipelineStats::Stage stage) : stats_(stats), stage_(stage)
+		{
+			if (stats_ == NULL)
+				return;
+			if (stats_->getPerfCounters() != NULL)
+				stats_->getPerfCounters()->read(start_counts_);
+			start_ = PipelineStats::Clock::now();
+		}
+
+		/**
+		 * \brief Destructor. Record the latency of the stage.
+		*/
+		~StageTimer()
+		{
+			stop();
+		}
+
+		/**
+		 * \brief Record the latency of the stage before the timer goes out of scope.
+		*/
+		void stop()
+		{
+			if (stats_ == NULL)
+				return;
+			stats_->record(stage_, start_);
+			if (stats_->getPerfCounters() != NULL)
+				stats_->recordCounts(stage_, start_counts_);
+			stats_ = NULL;
+		}
+
+
+	private:
+
+		PipelineStats* stats_; ///< the statistics that the latency is recorded in
+		PipelineStats::Stage stage_; ///< the stage
+		PipelineStats::Clock::time_point start_; ///< the time at which the stage started
+		PerfCounters::Values start_counts_; ///< the hardware performance counts at which the stage started
+};
+
+#endif /* PIPELINE_STATS_H */
@@ -0,0 +1,134 @@
+#ifndef PROFILING_H
+#define PROFILING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+
+/** ProfileSite class
+ *
+ * \brief Timing statistics of a profiled scope
+ *
+ * A profile site is a named scope in the code (see PROFILE_SCOPE) whose executions are counted and timed. Each site is
+ * a static object that adds itself to a global list when it is first executed. The statistics are updated with relaxed
+ * atomic operations, so sites can be executed from several threads without locks.
+ *
+ * The sites only exist in builds with the GRASP_SELECTION_PROFILING CMake option; otherwise, PROFILE_SCOPE expands to
+ * nothing and printReport() prints nothing.
+ *
+*/
+class ProfileSite
+{
+	public:
+
+		typedef std::chrono::steady_clock Clock;
+
+		/**
+		 * \brief Constructor. Add the site to the list of all sites.
+		 * \param name the name of the site (has to be a string literal)
+		*/
+		ProfileSite(const char* name);
+
+		/**
+		 * \brief Record an execution of the site.
+		 * \param nanoseconds the duration of the execution
+		*/
+		void record(uint64_t nanoseconds)
+		{
+			count_.fetch_add(1, std::memory_order_relaxed);
+			total_.fetch_add(nanoseconds, std::memory_order_relaxed);
+			uint64_t max = max_.load(std::memory_order_relaxed);
+			while (nanoseconds > max && !max_.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed))
+				;
+		}
+
+		const char* getName() const { return name_; }
+
+		uint64_t getCount() const { return count_.load(std::memory_order_relaxed); }
+
+		/**
+		 * \brief Return the total time of all executions.
+		 * \return the time in seconds
+		*/
+		double getTotal() const { return 1e-9 * total_.load(std::memory_order_relaxed); }
+
+		/**
+		 * \brief Return the longest execution.
+		 * \return the time in seconds
+		*/
+		double getMax() const { return 1e-9 * max_.load(std::memory_order_relaxed); }
+
+		/**
+		 * \brief Return the first site of the list of all sites.
+		 * \return the site (NULL if no site has been executed)
+		*/
+		static const ProfileSite* getFirst() { return first_.load(std::memory_order_acquire); }
+
+		const ProfileSite* getNext() const { return next_; }
+
+		/**
+		 * \brief Print the statistics of all sites that have been executed, sorted by their total time.
+		*/
+		static void printReport();
+
+
+	private:
+
+		const char* name_; ///< the name of the site
+		std::atomic<uint64_t> count_; ///< the number of executions
+		std::atomic<uint64_t> total_; ///< the total time of all executions (nanoseconds)
+		std::atomic<uint64_t> max_; ///< the longest execution (nanoseconds)
+		ProfileSite* next_; ///< the next site in the list of all sites
+		static std::atomic<ProfileSite*> first_; ///< the first site in the list of all sites
+};
+
+
+/** ProfileTimer class
+ *
+ * \brief Records the duration of a scope at a profile site when it goes out of scope
+ *
+*/
+class ProfileTimer
+{
+	public:
+
+		/**
+		 * \brief Constructor. Start timing the scope.
+		 * \param site the profile site
+		*/
+		ProfileTimer(ProfileSite& site) : site_(site), start_(ProfileSite::Clock::now()) { }
+
+		/**
+		 * \brief Destructor. Record the duration of the scope.
+		*/
+		~ProfileTimer()
+		{
+			const ProfileSite::Clock::duration duration = ProfileSite::Clock::now() - start_;
+			site_.record(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+		}
+
+
+	private:
+
+		ProfileSite& site_; ///< the profile site
+		ProfileSite::Clock::time_point start_; ///< the time at which the scope was entered
+};
+
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+
+/**
+ * \brief Time the rest of the enclosing scope at a profile site with the given name (a string literal). Compiles to
+ * nothing unless GRASP_SELECTION_PROFILING is defined.
+*/
+#ifdef GRASP_SELECTION_PROFILING
+#define PROFILE_SCOPE(name) \
+	static ProfileSite PROFILE_CONCAT(profile_site_, __LINE__)(name); \
+	ProfileTimer PROFILE_CONCAT(profile_timer_, __LINE__)(PROFILE_CONCAT(profile_site_, __LINE__))
+#else
+#define PROFILE_SCOPE(name) do { } while (false)
+#endif
+
+#endif /* PROFILING_H */
@@ -7,7 +7,6 @@
 #include <pcl/point_types.h>
 
 #include <eigen_conversions/eigen_msg.h>
-#include <moveit_msgs/GetPositionIK.h>
 #include <pcl_conversions/pcl_conversions.h>
 #include <ros/console.h>
 #include <ros/ros.h>
@@ -16,6 +15,7 @@
 #include <tf_conversions/tf_eigen.h>
 #include <tf/transform_broadcaster.h>
 
+#include <algorithm>
 #include <omp.h>
 #include <string>
 #include <vector>
@@ -23,10 +23,17 @@
 #include <agile_grasp/Grasp.h>
 #include <agile_grasp/Grasps.h>
 
-#include <grasp_selection/grasp_scored.h>
-#include <grasp_selection/SolveIK.h>
-#include <grasp_selection/SolveIKRequest.h>
-#include <grasp_selection/SolveIKResponse.h>
+#include <grasp_selection/arena.h>
+#include <grasp_selection/async_logger.h>
+#include <grasp_selection/candidate_store.h>
+#include <grasp_selection/grasp_arrays.h>
+#include <grasp_selection/grasp_pose_kernel.h>
+#include <grasp_selection/ik_solver.h>
+#include <grasp_selection/joint_traits.h>
+#include <grasp_selection/memory_usage.h>
+#include <grasp_selection/pipeline_stats.h>
+#include <grasp_selection/profiling.h>
+#include <grasp_selection/scene_index.h>
 
 
 typedef pcl::PointCloud<pcl::PointXYZ> PointCloud;
@@ -63,174 +70,164 @@ class Reaching
 			int ik_last_joint_index_; ///< the last index of the arm joints when using the Inverse Kinematics solver
       int js_first_joint_index_; ///< the first index of the arm joints on the joint_states ROS topic
 			int js_last_joint_index_; ///< the last index of the arm joints on the joint_states ROS topic
-      int planning_lib_; ///< which motion planning library is used (0: MoveIt, 1: OpenRAVE)
-      bool is_printing_; ///< whether additional information is printed while evaluating grasps for reachability
+      int planning_lib_; ///< which motion planning library is used (0: MoveIt, 1: OpenRAVE, 2: in-process ikfast)
+      std::string ik_base_link_; ///< the base link of the in-process ikfast solver, e.g., right_arm_mount
+      std::vector<double> pregrasp_offsets_; ///< the distances of the pre-grasp poses from the grasp pose
+      double max_joint_step_; ///< the maximum change of a joint between neighboring IK solutions along the approach
+      std::string ik_trace_file_; ///< the file to which the IK requests are recorded (empty: no recording)
 		};
 		
 		/**
 		* \brief Constructor.
 		* \param params the parameters
-		* \param node a reference to the ROS node
+		* \param ik_solver the Inverse Kinematics solver (owned by this object)
 		*/
-		Reaching(const Parameters& params, ros::NodeHandle& node);
+		Reaching(const Parameters& params, IKSolver* ik_solver);
+		
+		/**
+		* \brief Destructor.
+		*/
+		~Reaching()
+		{
+			delete ik_solver_;
+		}
 		
 		/**
 		* \brief Select all reachable grasps from the set of available grasps.
 		* \param grasp_in the set of available grasps
-		* \return the set of reachable grasps
+		* \param grasps_out the set of reachable grasps
+		* \param arena the arena for temporary data
 		*/
-		std::vector<GraspScored> selectFeasibleGrasps(const agile_grasp::Grasps& grasps_in);
+		void selectFeasibleGrasps(const agile_grasp::Grasps& grasps_in, CandidateStore& grasps_out, Arena& arena);
 		
 		/**
-		* \brief Set the point cloud.
-		* \param cloud the new point cloud
+		* \brief Return the distances of the pre-grasp poses from the grasp pose.
+		* \return the distances in increasing order
 		*/
-    void setPointCloud(const PointCloud::Ptr& cloud)
+		const std::vector<double>& getPregraspOffsets() const
+		{
+			return params_.pregrasp_offsets_;
+		}
+		
+		/**
+		* \brief Set the spatial index of the point cloud used for collision checking.
+		* \param scene_index the scene index (not owned by this object)
+		*/
+    void setSceneIndex(const SceneIndex* scene_index)
     {
-      cloud_ = cloud;
+      scene_index_ = scene_index;
     }
     
-		
-	private:
-		
 		/**
-		* \brief Grasp data structure.
+		* \brief Set the statistics that the latencies of the reachability stages are recorded in.
+		* \param stats the statistics (not owned by this object, nothing is recorded if NULL)
 		*/
-		struct GraspEigen
-		{
-			/**
-			* \brief Default constructor.
-			*/
-			GraspEigen() { }
-			
-			/**
-			* \brief Constructor. Convert an agile_grasp::Grasp message to a GraspEigen struct.
-			* \param the agile_grasp message
-			*/
-			GraspEigen(const agile_grasp::Grasp& grasp) 
-			{
-				tf::vectorMsgToEigen(grasp.axis, axis_);
-				tf::vectorMsgToEigen(grasp.approach, approach_);
-				tf::vectorMsgToEigen(grasp.center, center_);
-				tf::vectorMsgToEigen(grasp.surface_center, surface_center_);				
-				
-				approach_ = -1.0 * approach_; // make approach vector point away from handle centroid
-				binormal_ = axis_.cross(approach_); // binormal (used as rotation axis to generate additional approach vectors)
-			}
-			
-			Eigen::Vector3d center_; ///< the grasp position
-			Eigen::Vector3d surface_center_; ///< the grasp position projected back onto the surface of the object
-			Eigen::Vector3d axis_; ///< the hand axis
-			Eigen::Vector3d approach_; ///< the grasp approach direction
-			Eigen::Vector3d binormal_; ///< the vector orthogonal to the hand axis and the grasp approach direction
-		};
-    
-    /**
-     * \brief Inverse Kinematics data structure.
-    */
-    struct IKSolution
+    void setPipelineStats(PipelineStats* stats)
     {
-      IKSolution() { }
-      
-      bool success_; ///< whether an Inverse Kinematics solution was found
-      std::vector<double> joint_positions_; ///< the joint positions found
-    };
-	
+      stats_ = stats;
+    }
+    
 		/**
-			* \brief Check whether a given position lies within the robot's workspace.
-			* \param x the x-coordinate of the position
-			* \param y the y-coordinate of the position
-			* \param z the z-coordinate of the position
+		* \brief Set the counts that the grasps rejected by the reachability checks are recorded in.
+		* \param rejections the rejection counts (not owned by this object, nothing is recorded if NULL)
 		*/
-		bool isInWorkspace(double x, double y, double z);
-		
+    void setRejectionCounts(RejectionCounts* rejections)
+    {
+      rejections_ = rejections;
+    }
+    
 		/**
-			* \brief Generate an additional grasp with a different approach direction from a given grasp.
-			* \param grasp_in the original grasp
-			* \param theta the angle by which the new grasp deviates from the original grasp
-			* \return the new grasp
+			* \brief Check whether a given grasp pose is collision-free.
+			* \param position the position of the grasp pose that is checked for collisions
+			* \param approach the grasp approach direction
+			* \return true if the grasp pose is not in collision, false otherwise
 		*/
-		GraspEigen rotateGrasp(const GraspEigen& grasp_in, double theta);
+		bool isCollisionFree(const Eigen::Vector3d& position, const Eigen::Vector3d& approach);
 		
-		/**
-			* \brief Calculate the robot hand orientations for a given grasp.
-			* \param grasp the grasp for which the robot hand orientation is calculated
-			* \return the two orientations, the second one is the first one rotated by 180deg
-		*/
-		std::vector<tf::Quaternion> calculateHandOrientations(const GraspEigen& grasp);
+    IKSolver& getIKSolver() { return *ik_solver_; }
+    
+    ///< constants for switching the motion planning library
+    static const int MOVE_IT = 0;
+    static const int OPEN_RAVE = 1;
+    static const int IKFAST = 2;
+    
 		
-		/**
-			* \brief Reorder the columns of a given matrix.
-			* \param Q the matrix whose columns are to be reordered
-			* \return the new matrix with the column ordering changed
-		*/
-		Eigen::Matrix3d reorderHandAxes(const Eigen::Matrix3d& Q);
+	private:
 		
 		/**
-			* \brief Create a grasp pose ROS message from a given grasp, a robot hand orientation, and an approach angle.
-			* \param grasp the given grasp
-			* \param quat the robot hand orientation in quaternion form
-			* \param theta the approach angle
-			* \return the grasp pose ROS message
+		* \brief Select all reachable grasps from the set of available grasps for a robot arm with <DOF> joints.
+		* \param grasp_in the set of available grasps
+		* \param grasps_out the set of reachable grasps
+		* \param arena the arena for temporary data
 		*/
-		geometry_msgs::PoseStamped createGraspPose(const GraspEigen& grasp, const tf::Quaternion& quat, double theta);
-    
-    /**
-			* \brief Solve the Inverse Kinematics problem for a given pose using OpenRAVE or MoveIt.
-			* \param pose the pose for which the Inverse Kinematics problem is solved
-			* \param attempts (only for MoveIt) the maximum number of attempts that MoveIt can use to find a solution
-			* \param timeout (only for MoveIt) the maximum time that the MoveIt can spend to find a solution
-			* \return a bool indicating whether the solver succeeded and the joint angles that the IK solver found (if any)
+		template <int DOF>
+		void selectFeasibleGrasps(const agile_grasp::Grasps& grasps_in, CandidateStore& grasps_out, Arena& arena);
+	
+		/**
+			* \brief Check which grasps lie within the robot's workspace and fit into the robot hand.
+			* \param grasps the grasps
+			* \param mask the result, true for each grasp that passes both checks
 		*/
-    IKSolution solveIK(const geometry_msgs::PoseStamped& pose, int attempts = 1, double timeout = 0.01);
+		void filterGrasps(const GraspArrays& grasps, GraspArrays::Mask& mask);
 		
 		/**
-			* \brief Solve the Inverse Kinematics problem for a given pose using OpenRave.
-			* \param pose the pose for which the Inverse Kinematics problem is solved
-			* \param attempts the maximum number of attempts that the Inverse Kinematics solver can use to find a solution
-			* \param timeout the maximum time that the Inverse Kinematics can spend to find a solution
-			* \return the joint angles that the Inverse Kinematics solver found
+			* \brief Create a grasp pose ROS message from a given robot hand position and orientation.
+			* \param position the robot hand position
+			* \param orientation the robot hand orientation
+			* \param pose_st the grasp pose ROS message
 		*/
-		grasp_selection::SolveIK::Response solveIKOpenRave(const geometry_msgs::PoseStamped& pose);
+		void createGraspPose(const Eigen::Vector3d& position, const Eigen::Quaterniond& orientation, 
+			geometry_msgs::PoseStamped& pose_st);
     
     /**
-			* \brief Solve the Inverse Kinematics problem for a given pose using MoveIt.
+			* \brief Solve the Inverse Kinematics problem for a given pose with the Inverse Kinematics solver.
 			* \param pose the pose for which the Inverse Kinematics problem is solved
-			* \param attempts the maximum number of attempts that the Inverse Kinematics solver can use to find a solution
-			* \param timeout the maximum time that the Inverse Kinematics can spend to find a solution
-			* \return the joint angles that the Inverse Kinematics solver found
+			* \param joint_positions the joint angles that the IK solver found (<num_joints_> values, caller-owned so that 
+			* no solve allocates)
+			* \param seed the joint positions that the solver starts from (NULL for the current robot state)
+			* \param attempts the maximum number of attempts that the solver can use to find a solution (if supported)
+			* \param timeout the maximum time that the solver can spend to find a solution (if supported)
+			* \return true if the solver succeeded, false otherwise
 		*/
-    moveit_msgs::GetPositionIK::Response solveIKMoveIt(const geometry_msgs::PoseStamped& pose, int attempts = 1, 
-			double timeout = 0.01);
+    bool solveIK(const geometry_msgs::PoseStamped& pose, double* joint_positions, const double* seed = NULL, 
+      int attempts = 1, double timeout = 0.01);
 		
 		/**
-			* \brief Check whether a given grasp pose is collision-free.
-			* \param pose_st the grasp pose that is checked for collisions
+			* \brief Solve the Inverse Kinematics problem for the pre-grasp poses of a grasp, and check that the solutions 
+			* along the approach are continuous in joint space.
+			* \param position the grasp position
+			* \param orientation the grasp orientation
 			* \param approach the grasp approach direction
-			* \return true if the grasp pose is not in collision, false otherwise
+			* \param grasp_joint_positions the Inverse Kinematics solution for the grasp pose
+			* \param pregrasp_joint_positions the Inverse Kinematics solutions for the pre-grasp poses (one set of joint 
+			* positions per pre-grasp offset)
+			* \return true if all pre-grasp poses are reachable without a large joint motion, false otherwise
 		*/
-		bool isCollisionFree(const geometry_msgs::PoseStamped& pose_st, const Eigen::Vector3d& approach);
+		template <int DOF>
+		bool solvePregraspIK(const Eigen::Vector3d& position, const Eigen::Quaterniond& orientation, 
+			const Eigen::Vector3d& approach, const double* grasp_joint_positions, double* pregrasp_joint_positions);
 		
 		/**
-			* \brief Extract the joint angles of the robot arm from the response of the Inverse Kinematics solver.
-			* \param ik_response the response of the Inverse Kinematics solver
-			* \return the set of joint angles of the robot arm
+			* \brief Record that a candidate was rejected by a check.
+			* \param check the check that rejected the candidate
+			* \param start the time at which the evaluation of the candidate started
 		*/
-		std::vector<double> extractJointPositions(const moveit_msgs::GetPositionIK::Response& ik_response);
-    
-    void logPrint(const std::string& s) 
-    {
-      if (params_.is_printing_)
-        std::cout << s;
-    }
+		void recordRejection(RejectionCounts::Check check, const PipelineStats::Clock::time_point& start)
+		{
+			if (rejections_ != NULL)
+				rejections_->reject(check, 1, std::chrono::duration_cast<std::chrono::nanoseconds>(
+					PipelineStats::Clock::now() - start).count());
+		}
 		
-		ros::ServiceClient ik_service_; ///< ROS service for Inverse Kinematics
-		PointCloud::Ptr cloud_; ///< the point cloud used for collision checking			
+		IKSolver* ik_solver_; ///< the Inverse Kinematics solver
+		const SceneIndex* scene_index_; ///< the spatial index of the point cloud used for collision checking
+		PipelineStats* stats_; ///< the latency statistics of the grasp selection stages
+		RejectionCounts* rejections_; ///< the counts of the grasps rejected by the reachability checks
 		Parameters params_; ///< Parameters
-    
-    ///< constants for switching the motion planning library
-    static const int MOVE_IT = 0;
-    static const int OPEN_RAVE = 1;
+		int num_joints_; ///< the number of arm joints in the Inverse Kinematics solution
+		GraspPoseKernel pose_kernel_; ///< generates the robot hand poses for the grasps
+		geometry_msgs::PoseStamped grasp_pose_; ///< the grasp pose that is currently evaluated
+		std::vector<double> ik_joint_positions_; ///< the IK solution for the grasp pose that is currently evaluated
 };
 
 #endif /* REACHING_H */ 
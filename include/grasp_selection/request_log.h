@@ -0,0 +1,211 @@
+#ifndef REQUEST_LOG_H
+#define REQUEST_LOG_H
+
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+#include <ros/ros.h>
+#include <sensor_msgs/JointState.h>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <agile_grasp/Grasps.h>
+
+#include <grasp_selection/candidate_store.h>
+
+#include <grasp_selection/ParametersRecord.h>
+#include <grasp_selection/RejectionStatistics.h>
+#include <grasp_selection/RequestRecord.h>
+#include <grasp_selection/SceneRecord.h>
+#include <grasp_selection/SelectGrasps.h>
+
+
+/** RequestLogWriter class
+ *
+ * \brief Writes the requests of the selection node to a rotating set of memory-mapped log files
+ *
+ * The log consists of the files <directory>/requests_<n>.log. Each file starts with a header (the magic "GSRL" and
+ * the format version, as 32-bit integers), followed by entries: the type of the entry and the size of its data (as
+ * 32-bit integers), and the parameters of the node (see msg/ParametersRecord.msg), a scene (see msg/SceneRecord.msg)
+ * or a request (see msg/RequestRecord.msg) in the ROS serialization format. Each file starts with the parameters. A
+ * scene is written when the grasps or the point cloud of a request changed, and again at the start of each file after
+ * the parameters, so that each file can be replayed on its own. The point cloud is stored after the downsampling,
+ * which is much smaller than the received cloud and gives the same collision checks.
+ *
+ * A file is created with its full size and mapped into memory, and the entries are serialized directly into the
+ * mapping, field by field, without copying the messages. An entry therefore costs no system call and no allocation
+ * (apart from the copy of each new scene that is kept for the next file). When an entry does not fit into the current
+ * file, the file is truncated to its used size and the next one is created; the oldest files are removed, so the log
+ * takes at most <num_files> times <file_size> bytes on disk. The file numbers continue after the files that are
+ * already in the directory. The data reaches the disk with the normal page cache writeback, so a crash of the node
+ * does not lose it (the rest of the file is zero, which ends the entries), but a crash of the machine can. If a file
+ * cannot be created, e.g., because the disk is full, the entries are dropped, and the file is created again on a later
+ * entry, after a delay that doubles with each failure (up to a minute).
+ *
+ * The writer is not thread-safe.
+ *
+*/
+class RequestLogWriter
+{
+	public:
+
+		/**
+		 * \brief The parameters of the request log.
+		*/
+		struct Parameters
+		{
+			std::string directory_; ///< the directory that the log files are written to (empty: no log)
+			uint64_t file_size_; ///< the maximum size of a log file in bytes
+			int num_files_; ///< the maximum number of log files
+		};
+
+		/** The types of the entries. */
+		enum EntryType
+		{
+			ENTRY_NONE, ///< the end of the entries
+			ENTRY_SCENE, ///< a SceneRecord
+			ENTRY_REQUEST, ///< a RequestRecord
+			ENTRY_PARAMETERS ///< a ParametersRecord
+		};
+
+		/**
+		 * \brief Constructor. Create the first log file.
+		 * \param params the parameters of the request log
+		 * \param node_params the parameters of the node, which are written at the start of each file
+		*/
+		RequestLogWriter(const Parameters& params, const grasp_selection::ParametersRecord& node_params);
+
+		/**
+		 * \brief Destructor. Truncate the current log file to its used size and close it.
+		*/
+		~RequestLogWriter()
+		{
+			closeFile();
+		}
+
+		/**
+		 * \brief Write a new scene. The following requests refer to it.
+		 * \param grasps the grasps message
+		 * \param cloud the downsampled point cloud
+		*/
+		void writeScene(const agile_grasp::Grasps& grasps, const pcl::PointCloud<pcl::PointXYZ>& cloud);
+
+		/**
+		 * \brief Write a request and its outcome.
+		 * \param stamp the time at which the request arrived
+		 * \param latency the time taken to answer the request (nanoseconds)
+		 * \param request the request
+		 * \param joint_state the latest joint state received
+		 * \param reachable the reachable grasps
+		 * \param rejections the rejection counts of the reachability test
+		 * \param success whether the service succeeded
+		 * \param grasps the selected grasps
+		*/
+		void writeRequest(const ros::Time& stamp, int64_t latency, const grasp_selection::SelectGrasps::Request& request,
+			const sensor_msgs::JointState& joint_state, const CandidateStore& reachable,
+			const grasp_selection::RejectionStatistics& rejections, bool success, const grasp_selection::GraspList& grasps);
+
+		bool isOpen() const { return data_ != NULL; }
+
+		/**
+		 * \brief Return the number of entries that were dropped, because they did not fit into a file or a file could
+		 * not be created.
+		 * \return the number of dropped entries
+		*/
+		uint64_t getNumDropped() const { return num_dropped_; }
+
+
+	private:
+
+		/**
+		 * \brief Reserve space for an entry, starting a new file if the entry does not fit into the current one.
+		 * \param type the type of the entry
+		 * \param size the size of the data of the entry
+		 * \return the start of the data of the entry (NULL if the entry cannot be written)
+		*/
+		uint8_t* reserve(EntryType type, uint32_t size);
+
+		/**
+		 * \brief Create and map the next log file, remove the oldest files, and write the parameters of the node and the
+		 * current scene into it. If the file cannot be created, the next attempt is delayed.
+		 * \return true if the file could be created, false otherwise
+		*/
+		bool openFile();
+
+		/**
+		 * \brief Truncate the current log file to its used size, and unmap and close it.
+		*/
+		void closeFile();
+
+		Parameters params_; ///< the parameters of the request log
+		std::deque<int> file_numbers_; ///< the numbers of the log files in the directory, oldest first
+		int fd_; ///< the file descriptor of the current log file
+		uint8_t* data_; ///< the mapping of the current log file (NULL: no file)
+		uint64_t size_; ///< the number of bytes used in the current log file
+		std::vector<uint8_t> parameters_; ///< the parameters entry (for the start of each file)
+		std::vector<uint8_t> scene_; ///< the data of the current scene entry (for the start of the next file)
+		std::chrono::steady_clock::time_point retry_time_; ///< the earliest time to create a file after a failure
+		double retry_delay_; ///< the delay (in seconds) after the next failure to create a file
+		uint64_t scene_id_; ///< the number of the current scene
+		uint64_t request_id_; ///< the number of the next request
+		uint64_t num_dropped_; ///< the number of dropped entries
+};
+
+
+/** RequestLogReader class
+ *
+ * \brief Reads the entries of a log file written by RequestLogWriter
+ *
+*/
+class RequestLogReader
+{
+	public:
+
+		/**
+		 * \brief Constructor.
+		*/
+		RequestLogReader() : data_(NULL), size_(0), position_(0) { }
+
+		/**
+		 * \brief Destructor. Close the log file.
+		*/
+		~RequestLogReader()
+		{
+			close();
+		}
+
+		/**
+		 * \brief Open a log file.
+		 * \param filename the name of the log file
+		 * \return true if the file could be opened and has a valid header, false otherwise
+		*/
+		bool open(const std::string& filename);
+
+		/**
+		 * \brief Read the next entry.
+		 * \param parameters receives the entry if it is the parameters of the node
+		 * \param scene receives the entry if it is a scene
+		 * \param request receives the entry if it is a request
+		 * \return the type of the entry (ENTRY_NONE at the end of the file)
+		*/
+		RequestLogWriter::EntryType read(grasp_selection::ParametersRecord& parameters, grasp_selection::SceneRecord& scene,
+			grasp_selection::RequestRecord& request);
+
+		/**
+		 * \brief Close the log file.
+		*/
+		void close();
+
+
+	private:
+
+		uint8_t* data_; ///< the mapping of the log file
+		uint64_t size_; ///< the size of the log file
+		uint64_t position_; ///< the position of the next entry
+};
+
+#endif /* REQUEST_LOG_H */
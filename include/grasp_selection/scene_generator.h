@@ -0,0 +1,200 @@
+#ifndef SCENE_GENERATOR_H
+#define SCENE_GENERATOR_H
+
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+#include <sensor_msgs/JointState.h>
+#include <sensor_msgs/PointCloud2.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include <agile_grasp/Grasps.h>
+
+#include <grasp_selection/ikfast_solver.h>
+#include <grasp_selection/reaching.h>
+
+
+/** SceneGenerator class
+ *
+ * \brief Generates synthetic tabletop scenes and grasps with a known reachability
+ *
+ * This class generates point clouds of primitive objects (boxes, cylinders and spheres) standing on a table, together
+ * with grasps whose outcome of the workspace, aperture and IK checks of the reachability test is known in advance:
+ * reachable grasps are derived from the forward kinematics of random joint positions, and the grasps labelled as
+ * unreachable are verified with the same IK solver that the reachability test uses. The collision and approach checks
+ * depend on the generated point cloud and are not part of the ground truth. The grasps are generated in parallel, each
+ * from its own random number generator seeded with the scene seed and its index, so a seed always produces the same
+ * scene regardless of the number of threads.
+ *
+*/
+class SceneGenerator
+{
+	public:
+
+		/**
+		 * \brief The ground truth of a generated grasp.
+		*/
+		enum Label
+		{
+			REACHABLE, ///< in the workspace, fits into the hand, and has an IK solution
+			UNREACHABLE, ///< in the workspace and fits into the hand, but neither hand orientation has an IK solution
+			OUTSIDE_WORKSPACE, ///< outside the workspace
+			INVALID_APERTURE, ///< in the workspace, but smaller or larger than the hand aperture
+			NUM_LABELS
+		};
+
+		/**
+		 * \brief The parameters of the generated scenes.
+		*/
+		struct Parameters
+		{
+			int seed_; ///< the seed of the random number generator
+			std::vector<double> table_; ///< the extent of the table (x_min, x_max, y_min, y_max) and its height
+			int num_objects_; ///< the number of objects on the table (the clutter)
+			double min_object_size_; ///< the minimum edge length or diameter of an object
+			double max_object_size_; ///< the maximum edge length or diameter of an object
+			int num_points_; ///< the number of points of the cloud, spread over the table and the objects by area
+			double noise_; ///< the standard deviation of the Gaussian noise added to the points
+			int num_grasps_; ///< the number of grasps
+			double label_fractions_[NUM_LABELS]; ///< the fraction of the grasps with each label
+			int max_attempts_; ///< the maximum number of samples drawn for a single grasp
+		};
+
+		/**
+		 * \brief A generated scene.
+		*/
+		struct Scene
+		{
+			sensor_msgs::PointCloud2 cloud_; ///< the point cloud
+			agile_grasp::Grasps grasps_; ///< the grasps
+			std::vector<Label> labels_; ///< the ground truth of each grasp
+			sensor_msgs::JointState joint_state_; ///< the joint state of the robot
+		};
+
+		/**
+		 * \brief Constructor.
+		 * \param reaching_params the parameters of the reachability test (workspace, aperture, hand frame)
+		 * \param solver the IK solver of the arm, used for the forward kinematics and to verify the labels
+		 * \param joint_state_names the names of all joints in the generated joint states; the joints of the ikfast
+		 * chain are found by name
+		*/
+		SceneGenerator(const Reaching::Parameters& reaching_params, IKFastSolver& solver,
+			const std::vector<std::string>& joint_state_names);
+
+		/**
+		 * \brief Return the default parameters: a table under the Baxter workspace with 10 objects, 20000 points, and
+		 * 1000 grasps, 40% of them reachable, and 20% with each other label.
+		 * \return the default parameters
+		*/
+		static Parameters getDefaultParameters();
+
+		/**
+		 * \brief Generate a scene.
+		 * \param params the parameters of the scene
+		 * \param frame_id the frame of the point cloud and the grasps
+		 * \param scene the generated scene
+		 * \return true if the scene could be generated, false if no grasp with a required label was found within the
+		 * maximum number of attempts
+		*/
+		bool generate(const Parameters& params, const std::string& frame_id, Scene& scene);
+
+		static const char* getLabelName(Label label);
+
+
+	private:
+
+		typedef pcl::PointCloud<pcl::PointXYZ> PointCloud;
+
+		/**
+		 * \brief Generate the point cloud of the table and the objects.
+		 * \param params the parameters of the scene
+		 * \param random the random number generator of the scene
+		 * \param cloud the point cloud
+		*/
+		void generateCloud(const Parameters& params, std::mt19937& random, PointCloud& cloud) const;
+
+		/**
+		 * \brief Generate a grasp with a given label.
+		 * \param params the parameters of the scene
+		 * \param label the label
+		 * \param random the random number generator of the grasp
+		 * \param grasp the grasp
+		 * \return true if a grasp was found within the maximum number of attempts, false otherwise
+		*/
+		bool generateGrasp(const Parameters& params, Label label, std::mt19937& random, agile_grasp::Grasp& grasp) const;
+
+		/**
+		 * \brief Derive a grasp from the hand pose at random joint positions.
+		 * \param random the random number generator
+		 * \param center the grasp position
+		 * \param approach the grasp approach vector
+		 * \param axis the hand axis
+		*/
+		void sampleReachableGrasp(std::mt19937& random, Eigen::Vector3d& center, Eigen::Vector3d& approach,
+			Eigen::Vector3d& axis) const;
+
+		/**
+		 * \brief Draw a random grasp orientation.
+		 * \param random the random number generator
+		 * \param approach the grasp approach vector
+		 * \param axis the hand axis, orthogonal to the approach vector
+		*/
+		static void sampleOrientation(std::mt19937& random, Eigen::Vector3d& approach, Eigen::Vector3d& axis);
+
+		/**
+		 * \brief Check whether one of the two hand orientations of a grasp has an IK solution, in the same way as the
+		 * reachability test.
+		 * \param center the grasp position
+		 * \param approach the grasp approach vector
+		 * \param axis the hand axis
+		 * \return true if an IK solution was found, false otherwise
+		*/
+		bool hasIKSolution(const Eigen::Vector3d& center, const Eigen::Vector3d& approach, const Eigen::Vector3d& axis)
+			const;
+
+		/**
+		 * \brief Check whether a position lies within the workspace.
+		 * \param p the position
+		 * \return true if the position lies within the workspace, false otherwise
+		*/
+		bool isInWorkspace(const Eigen::Vector3d& p) const;
+
+		/**
+		 * \brief Draw a random position within the workspace.
+		 * \param random the random number generator
+		 * \return the position
+		*/
+		Eigen::Vector3d sampleWorkspacePosition(std::mt19937& random) const;
+
+		/**
+		 * \brief Draw a uniform random number. Unlike the distributions of the standard library, whose algorithms are
+		 * implementation-defined, it only depends on the output of the generator, so the scenes are the same with any
+		 * standard library.
+		 * \param random the random number generator
+		 * \param min the lower bound
+		 * \param max the upper bound
+		 * \return the random number
+		*/
+		static double uniform(std::mt19937& random, double min, double max);
+
+		/**
+		 * \brief Draw a normally distributed random number (Box-Muller transform, see uniform()).
+		 * \param random the random number generator
+		 * \param stddev the standard deviation (the mean is 0)
+		 * \return the random number
+		*/
+		static double normal(std::mt19937& random, double stddev);
+
+		Reaching::Parameters reaching_params_; ///< the parameters of the reachability test
+		IKFastSolver& solver_; ///< the IK solver of the arm
+		std::vector<std::string> joint_state_names_; ///< the names of all joints in the generated joint states
+		std::vector<int> chain_indices_; ///< the index of each joint of the ikfast chain in the joint states
+};
+
+#endif /* SCENE_GENERATOR_H */
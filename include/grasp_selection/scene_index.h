@@ -0,0 +1,114 @@
+#ifndef SCENE_INDEX_H
+#define SCENE_INDEX_H
+
+#include <Eigen/Dense>
+
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <grasp_selection/grid_key.h>
+
+
+/** SceneIndex class
+ *
+ * \brief Spatial index for the point cloud used for collision checking
+ *
+ * This class sorts the points of a point cloud into a uniform grid of cubic cells, and stores the points of each cell
+ * contiguously. A hash table maps each non-empty cell to its range of points. Collision checks only visit the points in
+ * the cells that overlap the bounding box of the checked shape instead of all points in the cloud. The index is only
+ * read during queries, so it can be queried from several threads at the same time.
+ *
+*/
+class SceneIndex
+{
+	public:
+
+		/**
+		 * \brief Constructor.
+		 * \param cell_size the edge length of the grid cells
+		*/
+		SceneIndex(double cell_size = 0.03) : cell_size_(cell_size) { }
+
+		/**
+		 * \brief Build the index for a point cloud, replacing the previous one.
+		 * \param cloud the point cloud
+		*/
+		void setPointCloud(const pcl::PointCloud<pcl::PointXYZ>& cloud);
+
+		/**
+		 * \brief Visit all points that lie in the grid cells overlapping a bounding box.
+		 * \param min the minimum corner of the bounding box
+		 * \param max the maximum corner of the bounding box
+		 * \param visitor called with each point, returns false to stop the traversal
+		 * \return false if the visitor stopped the traversal, true otherwise
+		*/
+		template <class Visitor>
+		bool visitPoints(const Eigen::Vector3d& min, const Eigen::Vector3d& max, Visitor visitor) const
+		{
+			if (cells_.empty())
+				return true;
+
+			Eigen::Vector3i lower = calculateCell(min);
+			Eigen::Vector3i upper = calculateCell(max);
+			for (int x = lower(0); x <= upper(0); x++)
+			{
+				for (int y = lower(1); y <= upper(1); y++)
+				{
+					for (int z = lower(2); z <= upper(2); z++)
+					{
+						CellMap::const_iterator cell = cells_.find(calculateGridKey(x, y, z));
+						if (cell == cells_.end())
+							continue;
+
+						for (int i = cell->second.first; i < cell->second.second; i++)
+						{
+							if (!visitor(points_.col(i)))
+								return false;
+						}
+					}
+				}
+			}
+
+			return true;
+		}
+
+		int size() const { return points_.cols(); }
+
+		/**
+		 * \brief Estimate the memory used by the index.
+		 * \return the size of the points and of the hash table (its buckets and nodes) in bytes
+		*/
+		std::size_t getMemorySize() const
+		{
+			return points_.size() * sizeof(double) + cells_.bucket_count() * sizeof(void*)
+				+ cells_.size() * (sizeof(CellMap::value_type) + sizeof(void*));
+		}
+
+
+	private:
+
+		typedef std::unordered_map<int64_t, std::pair<int, int> > CellMap;
+
+		/**
+		 * \brief Calculate the grid cell that contains a point.
+		 * \param p the point
+		 * \return the integer coordinates of the cell
+		*/
+		Eigen::Vector3i calculateCell(const Eigen::Vector3d& p) const
+		{
+			return Eigen::Vector3i(floor(p(0) / cell_size_), floor(p(1) / cell_size_), floor(p(2) / cell_size_));
+		}
+
+		double cell_size_; ///< the edge length of the grid cells
+		Eigen::Matrix3Xd points_; ///< the points, sorted by grid cell
+		CellMap cells_; ///< the range of points in <points_> for each non-empty grid cell
+};
+
+#endif /* SCENE_INDEX_H */
@@ -0,0 +1,133 @@
+#ifndef SCENE_REPLAY_H
+#define SCENE_REPLAY_H
+
+#include <geometry_msgs/Pose.h>
+#include <sensor_msgs/JointState.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <urdf/model.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <agile_grasp/Grasps.h>
+
+#include <grasp_selection/ikfast_solver.h>
+#include <grasp_selection/reaching.h>
+#include <grasp_selection/selection_pipeline.h>
+#include <grasp_selection/trajectory_planner.h>
+
+#include <grasp_selection/GraspList.h>
+#include <grasp_selection/ParametersRecord.h>
+
+
+/** SceneReplay class
+ *
+ * \brief Runs the grasp selection offline on scenes recorded in a bag file
+ *
+ * This class reads the grasps, point clouds and joint states recorded in a bag file, and runs the same
+ * SelectionPipeline as the selection node on them, with the in-process ikfast solver and the Baxter defaults from
+ * select_grasps.launch. No ROS master, MoveIt or OpenRAVE is needed. Each grasps message forms a scene together with the
+ * latest point cloud and joint state recorded before it. The hand pose of a scene is calculated from its joint state
+ * with the forward kinematics of the ikfast chain.
+ *
+*/
+class SceneReplay
+{
+	public:
+
+		/**
+		 * \brief A recorded scene: the grasps and the latest point cloud and joint state.
+		*/
+		struct Scene
+		{
+			agile_grasp::Grasps::ConstPtr grasps_;
+			sensor_msgs::PointCloud2::ConstPtr cloud_;
+			sensor_msgs::JointState::ConstPtr joint_state_;
+			geometry_msgs::Pose hand_pose_; ///< the hand pose at the joint state
+		};
+
+		/**
+		 * \brief Constructor.
+		*/
+		SceneReplay();
+
+		/**
+		 * \brief Destructor.
+		*/
+		~SceneReplay()
+		{
+			delete pipeline_;
+		}
+
+		/**
+		 * \brief Read the scenes from a bag file, and create the grasp selection for them.
+		 * \param bag_filename the name of the bag file
+		 * \param urdf the URDF model of the robot
+		 * \param grasps_topic the topic of the grasps messages
+		 * \param cloud_topic the topic of the point cloud messages
+		 * \param joint_states_topic the topic of the joint states messages
+		 * \return true if at least one scene was read and the grasp selection could be created, false otherwise
+		*/
+		bool load(const std::string& bag_filename, const urdf::Model& urdf, const std::string& grasps_topic,
+			const std::string& cloud_topic, const std::string& joint_states_topic);
+
+		/**
+		 * \brief Create the grasp selection without reading scenes, e.g., to replay a request log.
+		 * \param urdf the URDF model of the robot
+		 * \param joint_names the names of the arm joints
+		 * \return true if the grasp selection could be created, false otherwise
+		*/
+		bool create(const urdf::Model& urdf, const std::vector<std::string>& joint_names);
+
+		/**
+		 * \brief Create the grasp selection with the parameters logged by a selection node, replacing the Baxter
+		 * defaults. The in-process ikfast solver is used whichever planning library the node used.
+		 * \param urdf the URDF model of the robot
+		 * \param parameters the parameters of the node
+		 * \return true if the grasp selection could be created, false otherwise
+		*/
+		bool create(const urdf::Model& urdf, const grasp_selection::ParametersRecord& parameters);
+
+		/**
+		 * \brief Run the complete grasp selection on a scene, including the point cloud preparation.
+		 * \param index the index of the scene
+		 * \param msg the selected grasps
+		 * \return true if grasps were selected, false otherwise
+		*/
+		bool selectGrasps(int index, grasp_selection::GraspList& msg);
+
+		/**
+		 * \brief Calculate a digest (FNV-1a) of the selected grasps, ignoring the time stamps.
+		 * \param msg the selected grasps
+		 * \return the digest
+		*/
+		static uint64_t calculateDigest(const grasp_selection::GraspList& msg);
+
+		const std::vector<Scene>& getScenes() const { return scenes_; }
+
+		SelectionPipeline& getPipeline() { return *pipeline_; }
+
+		const Reaching::Parameters& getParameters() const { return params_; }
+
+
+	private:
+
+		/**
+		 * \brief Calculate the hand pose for a joint state with the forward kinematics of the ikfast chain.
+		 * \param joint_state the joint state
+		 * \return the hand pose
+		*/
+		geometry_msgs::Pose calculateHandPose(const sensor_msgs::JointState& joint_state) const;
+
+		Reaching::Parameters params_; ///< the parameters of the reachability test
+		TrajectoryPlanner::Parameters planner_params_; ///< the parameters of the trajectory planner
+		int num_selected_; ///< the maximum number of selected grasps
+		int scoring_mode_; ///< the scoring mode
+		double scene_cell_size_; ///< the edge length of the grid cells of the point cloud index
+		std::vector<Scene> scenes_; ///< the recorded scenes
+		IKFastSolver* solver_; ///< the IK solver (owned by the pipeline)
+		SelectionPipeline* pipeline_; ///< the grasp selection
+};
+
+#endif /* SCENE_REPLAY_H */
@@ -5,12 +5,17 @@
 
 #include <eigen_conversions/eigen_msg.h>
 #include <geometry_msgs/Pose.h>
+#include <ros/console.h>
 #include <urdf/model.h>
 
 #include <string>
 #include <vector>
 
-#include <grasp_selection/grasp_scored.h>
+#include <grasp_selection/arena.h>
+#include <grasp_selection/async_logger.h>
+#include <grasp_selection/candidate_store.h>
+#include <grasp_selection/joint_traits.h>
+#include <grasp_selection/profiling.h>
 
 
 /** Scoring class
@@ -39,71 +44,117 @@ class Scoring
 		Scoring(const urdf::Model& urdf, const std::vector<std::string>& joint_names, double min_aperture, 
 			double max_aperture, int num_selected, int scoring_mode);
 		
+		/**
+		 * \brief Grasps ranked by score. The grasps are referred to by their index in the candidate store.
+		*/
+		struct Ranking
+		{
+			ArenaVector<int> indices_; ///< the indices of the ranked grasps, sorted by score (ascending)
+			ArenaVector<double> scores_; ///< the scores of the ranked grasps
+			int num_distance_candidates_; ///< the number of leading grasps that are ranked by workspace distance
+		};
+		
 		/**
 		 * \brief Assign scores to a given set of grasps.
-		 * \param grasps_in the grasps to which scores are assigned
+		 * \param grasps the grasps to which scores are assigned
+		 * \param current_pose the current pose of the robot hand
+		 * \param arena the arena for temporary data and the selected grasps
+		 * \return the selected grasps with scores assigned
+		*/
+		Ranking scoreGrasps(const CandidateStore& grasps, const geometry_msgs::Pose& current_pose, Arena& arena);
+		
+		/**
+		 * \brief Rank a given set of grasps by the joint limits distance and the aperture limits distance. Neither 
+		 * depends on the current hand pose, so the ranking can be reused as long as the set of grasps does not change.
+		 * \param grasps the grasps to be ranked
+		 * \param arena the arena for temporary data
+		 * \param ranking the ranking (its memory is reused, so a ranking that is kept across requests does not allocate 
+		 * once it has grown to the number of grasps)
+		*/
+		void rankGrasps(const CandidateStore& grasps, Arena& arena, Ranking& ranking);
+		
+		/**
+		 * \brief Select the top K grasps from a ranking, using the workspace distance to the current hand pose.
+		 * \param grasps the grasps that have been ranked
+		 * \param ranking the ranking calculated by rankGrasps
 		 * \param current_pose the current pose of the robot hand
-		 * \return the set of grasps with scores assigned
+		 * \param arena the arena for temporary data and the selected grasps
+		 * \return the selected grasps with scores assigned
 		*/
-		std::vector<GraspScored> scoreGrasps(const std::vector<GraspScored>& grasps_in, 
-			const geometry_msgs::Pose& current_pose);
+		Ranking selectGrasps(const CandidateStore& grasps, const Ranking& ranking, const geometry_msgs::Pose& current_pose, 
+			Arena& arena);
 		
     /** Constants for which scoring functions are used. */ 
     static const int SCORING_MODE_NONE = 0; ///< no scoring
     static const int SCORING_MODE_JOINTS = 1; ///< only use joint limits distance
     static const int SCORING_MODE_APERTURE = 2; ///< use joint limits distance and aperture limits distance
     static const int SCORING_MODE_WORKSPACE = 3; ///< use all three scoring functions
-			
-	private:
 		
 		/**
 		 * \brief Calculate the joint limits distance.
 		 * \param joint_positions the set of joint angles for which the limits distance is calculated
 		 * \return the joint limits distance
 		*/
-		double calculateJointScore(const std::vector<double>& joint_positions);
+		double calculateJointScore(const double* joint_positions) const;
 		
 		/**
 		 * \brief Calculate the aperture limits distance.
-		 * \param grasps the set of grasps for which the limits distance is calculated
+		 * \param width the aperture required by the robot hand to execute the grasp
 		 * \return the aperture limits distance
 		*/
-		std::vector<std::vector<double> > calculateApertureScore(const std::vector<GraspScored>& grasps);
+		double calculateApertureScore(double width) const;
+		
+		/**
+		 * \brief Calculate the workspace distance for a single grasp.
+		 * \param position the grasp position
+		 * \param current_pose the current pose of the robot hand
+		 * \return the squared distance between the grasp position and the current hand position
+		*/
+		double calculateWorkspaceDistance(const Eigen::Vector3d& position, const geometry_msgs::Pose& current_pose) const;
+			
+	private:
+		
+		/**
+		 * \brief Calculate the joint limits distance for a robot arm with <DOF> joints.
+		 * \param joint_positions the set of joint angles for which the limits distance is calculated
+		 * \return the joint limits distance
+		*/
+		template <int DOF>
+		double calculateJointScore(const double* joint_positions) const;
 		
 		/**
 		 * \brief Calculate the workspace distance
 		 * \param current_pose the current pose of the robot hand
-		 * \param grasps the set of grasps for which the distance is calculated
-		 * \param widths the scores assigned by the calculateApertureScore function
-		 * \return the distance between the grasp pose and the current hand pose of the robot
+		 * \param grasps the grasps that have been ranked
+		 * \param ranking the ranking whose leading <num_distance_candidates_> grasps are considered
+		 * \param distances the distance between the grasp pose and the current hand pose of the robot
 		*/
-		std::vector<std::vector<double> > calculateWorkspaceDistance(const geometry_msgs::Pose& current_pose, 
-			const std::vector<GraspScored>& grasps, const std::vector<std::vector<double> >& widths);
+		void calculateWorkspaceDistance(const geometry_msgs::Pose& current_pose, const CandidateStore& grasps, 
+			const Ranking& ranking, ArenaVector<double>& distances) const;
 		
 		/**
-		 * \brief Compare the joint scores of two grasps.
-		 * \param g1 the first grasp
-		 * \param g2 the second grasp
-		 * \return true if the first grasp's score is lower than the second, false otherwise
+		 * \brief Sort a list of scores.
+		 * \param scores the list of scores
+		 * \param order the indices into the list of scores, sorted by score (ascending)
 		*/
-		static bool compareJointScore(const GraspScored& g1, const GraspScored& g2);
+		static void sortByScore(const ArenaVector<double>& scores, ArenaVector<int>& order);
 		
 		/**
-		 * \brief Compare the second element of a two-element list for two lists of numbers.
-		 * \param v1 the first list
-		 * \param v2 the second list
-		 * \return true if the first list's second element is lower than the second list's second element, false otherwise
+		 * \brief Count how many leading scores in a sorted list of scores are equal to the first score.
+		 * \param scores the sorted list of scores
+		 * \return the number of leading scores equal to the first score
 		*/
-		static bool compareSecondElement(const std::vector<double>& v1, const std::vector<double>& v2);
+		static int countTies(const ArenaVector<double>& scores);
 	
-		Eigen::MatrixXd joint_limits_; ///< the joint limits of the robot arm (read out from the URDF)
+		JointTraits<Eigen::Dynamic>::JointLimits joint_limits_; ///< the joint limits of the robot arm (read out from the URDF)
+		double (Scoring::*joint_score_)(const double*) const; ///< calculateJointScore for the number of arm joints
 		double min_aperture_; ///< the minimum aperture of the robot hand
 		double max_aperture_; ///< the maximum aperture of the robot hand
 		int num_selected_; ///< the number of selected grasps (= the top K grasps)
     int scoring_mode_; ///< the scoring mode: which scoring functions are used
 		
-		static const double ARM_JOINT_LIMITS_DISTANCE = 20.0 * (M_PI / 180.0); ///< distance from joint limits
-		static const double HAND_APERTURE_LIMITS_DISTANCE = 0.015; ///< prefered distance from min and max gripper width   
+		static constexpr double ARM_JOINT_LIMITS_DISTANCE = 20.0 * (M_PI / 180.0); ///< distance from joint limits
+		static constexpr double HAND_APERTURE_LIMITS_DISTANCE = 0.015; ///< prefered distance from min and max gripper width   
 };
 
 #endif /* SCORING_H */ 
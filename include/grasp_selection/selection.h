@@ -3,39 +3,40 @@
 
 #include <Eigen/Dense>
 
-#include <pcl/point_cloud.h>
-#include <pcl/point_types.h>
-#include <pcl/filters/voxel_grid.h>
+#include <boost/lexical_cast.hpp>
 
-#include <eigen_conversions/eigen_msg.h>
-#include <moveit_msgs/GetPositionIK.h>
-#include <pcl_conversions/pcl_conversions.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
 #include <ros/ros.h>
 #include <sensor_msgs/PointCloud2.h>
 #include <sensor_msgs/JointState.h>
-#include <tf/transform_datatypes.h>
-#include <tf_conversions/tf_eigen.h>
+#include <urdf/model.h>
 #include <visualization_msgs/Marker.h>
 #include <visualization_msgs/MarkerArray.h>
 
 #include <string>
 #include <vector>
 
-#include <agile_grasp/Grasp.h>
 #include <agile_grasp/Grasps.h>
 
-#include <grasp_selection/grasp_scored.h>
+#include <grasp_selection/async_logger.h>
+#include <grasp_selection/ik_solver.h>
+#include <grasp_selection/ikfast_solver.h>
+#include <grasp_selection/pipeline_stats.h>
+#include <grasp_selection/profiling.h>
 #include <grasp_selection/reaching.h>
-#include <grasp_selection/scoring.h>
+#include <grasp_selection/request_log.h>
+#include <grasp_selection/selection_pipeline.h>
+#include <grasp_selection/trajectory_planner.h>
 
-#include <grasp_selection/Grasp.h>
 #include <grasp_selection/GraspList.h>
+#include <grasp_selection/MemoryStatistics.h>
+#include <grasp_selection/ParametersRecord.h>
+#include <grasp_selection/PerfStatistics.h>
+#include <grasp_selection/PipelineStatistics.h>
+#include <grasp_selection/RejectionStatistics.h>
 #include <grasp_selection/SelectGrasps.h>
 
 
-typedef pcl::PointCloud<pcl::PointXYZ> PointCloud;
-
-
 /** Selection class
  *
  * \brief Select grasps by first filtering out unreachable grasps and then scoring each remaining grasp
@@ -43,7 +44,8 @@ typedef pcl::PointCloud<pcl::PointXYZ> PointCloud;
  * This class selects grasps by first filtering out all grasps that cannot be reached by the robot arm/hand. The 
  * remaining grasps are then scored based on three scoring functions. From those grasps, the grasps with the K highest 
  * scores are chosen. The grasp selection can be accessed with a ROS service. Also visualizes the selected grasps 
- * so that they can be viewed in Rviz.
+ * so that they can be viewed in Rviz. The selection itself is done by a SelectionPipeline; this class connects it to 
+ * the ROS topics and the ROS service.
  * 
 */
 class Selection
@@ -56,22 +58,34 @@ class Selection
 		 * \param grasps_topic the ROS topic where the agile_grasp package publishes the detected grasps
 		 * \param cloud_topic the ROS topic where the point cloud is published
 		 * \param reaching_params the parameters for the reaching class
+		 * \param planner_params the parameters for the trajectory planner class
 		 * \param urdf the URDF model
 		 * \param joint_states_topic the ROS topic where the joint states of the robot are published
 		 * \param num_selected the maximum number of selected grasps
 		 * \param marker_lifetime the lifetime of visual markers in the Rviz visualization
+		 * \param scene_cell_size the edge length of the grid cells of the point cloud index
+		 * \param stats_period the period (in seconds) at which the latency statistics are published
+		 * \param trace_directory the directory that a Chrome trace of each request is written to (empty: no tracing)
+		 * \param perf_counters whether the hardware performance counters of each stage are counted
+		 * \param request_log_params the parameters of the request log (empty directory: no log)
 		*/
 		Selection(ros::NodeHandle& node, const std::string& grasps_topic, const std::string& cloud_topic, 
-      const Reaching::Parameters& reaching_params, const urdf::Model& urdf, const std::string& joint_states_topic, 
-      int num_selected, double marker_lifetime, int scoring_mode);
+      const Reaching::Parameters& reaching_params, const TrajectoryPlanner::Parameters& planner_params, 
+      const urdf::Model& urdf, const std::string& joint_states_topic, int num_selected, double marker_lifetime, 
+      int scoring_mode, double scene_cell_size, double stats_period, const std::string& trace_directory, 
+      bool perf_counters, const RequestLogWriter::Parameters& request_log_params);
 			
 		/**
 		 * \brief Destructor.
 		*/
 		~Selection()
 		{
-			delete reaching_;
-			delete scoring_;
+			delete pipeline_;
+			delete trace_;
+			delete request_log_;
+			
+			// the statistics of the profile sites (only in profiling builds)
+			ProfileSite::printReport();
 		}
 		
 		/**
@@ -86,26 +100,89 @@ class Selection
 		 * \brief The callback function for the ROS topic that contains the detected grasps.
 		 * \param msg the ROS message containing the detected grasps
 		*/	
-		void graspsCallback(const agile_grasp::Grasps& msg);
+		void graspsCallback(const agile_grasp::Grasps::ConstPtr& msg);
 		
 		/**
 		 * \brief The callback function for the ROS topic that contains the point cloud.
 		 * \param msg the ROS message containing the point cloud
 		*/	
-		void cloudCallback(const sensor_msgs::PointCloud2& msg);
+		void cloudCallback(const sensor_msgs::PointCloud2::ConstPtr& msg);
     
     /**
 		 * \brief The callback function for the ROS topic that contains the joint states of the robot.
 		 * \param msg the ROS message containing the robot's joint states
 		*/	
-    void jointStatesCallback(const sensor_msgs::JointState& msg);
+    void jointStatesCallback(const sensor_msgs::JointState::ConstPtr& msg);
     
     /**
-		 * \brief Create a ROS message that contains the selected grasps.
-		 * \param list the list of scored grasps
-		 * \return the ROS message containing the selected grasps
-		*/	
-    grasp_selection::GraspList createGraspListMsg(const std::vector<GraspScored>& list);
+     * \brief Create the Inverse Kinematics solver selected by the <planning_lib_> parameter.
+     * \param params the parameters for the reaching class
+     * \param urdf the URDF model
+     * \param joint_names the names of the arm joints in the order of the joint states
+     * \param node the ROS node
+     * \return the solver, which gives the joint positions in the order of the joint names
+    */
+    static IKSolver* createIKSolver(const Reaching::Parameters& params, const urdf::Model& urdf, 
+      const std::vector<std::string>& joint_names, ros::NodeHandle& node);
+    
+    /**
+     * \brief Create a ROS message that contains the rejection counts of the reachability test.
+     * \param rejections the rejection counts
+     * \param msg the ROS message
+    */
+    static void createRejectionsMsg(const RejectionCounts& rejections, grasp_selection::RejectionStatistics& msg);
+    
+    /**
+     * \brief Create a ROS message that contains the parameters of the node, for the request log.
+     * \param reaching_params the parameters for the reaching class
+     * \param planner_params the parameters for the trajectory planner class
+     * \param joint_names the names of the arm joints in the order of the joint states
+     * \param num_selected the maximum number of selected grasps
+     * \param scoring_mode the scoring mode
+     * \param scene_cell_size the edge length of the grid cells of the point cloud index
+     * \param msg the ROS message
+    */
+    static void createParametersMsg(const Reaching::Parameters& reaching_params, 
+      const TrajectoryPlanner::Parameters& planner_params, const std::vector<std::string>& joint_names, 
+      int num_selected, int scoring_mode, double scene_cell_size, grasp_selection::ParametersRecord& msg);
+    
+    /**
+     * \brief Publish the latency statistics of the grasp selection stages on the stats topic and as ROS diagnostics.
+     * \param event the timer event
+    */
+    void statsTimerCallback(const ros::TimerEvent& event);
+    
+    /**
+     * \brief Write the events recorded since the last request to a Chrome trace file in the trace directory.
+     * \param request_start the time at which the current request started
+    */
+    void writeTrace(const TraceRecorder::Clock::time_point& request_start);
+    
+    /**
+     * \brief Hand the latest grasps, and the point cloud paired with them, over to the pipeline.
+    */
+    void updateScene();
+    
+    /**
+     * \brief Write a request to the request log, preceded by its scene if the scene changed since the last request.
+     * \param stamp the time at which the request arrived
+     * \param latency the time taken to answer the request (nanoseconds)
+     * \param request the request
+     * \param response the response
+     * \param success whether the service succeeded
+    */
+    void logRequest(const ros::Time& stamp, int64_t latency, const grasp_selection::SelectGrasps::Request& request, 
+      const grasp_selection::SelectGrasps::Response& response, bool success);
+    
+    /**
+     * \brief Publish the memory usage of the last request and the sizes of its data on the memory stats topic.
+    */
+    void publishMemoryStats();
+    
+    /**
+     * \brief Publish the hardware performance counts of the last request on the perf stats topic.
+    */
+    void publishPerfStats();
     
     /**
      * \brief Callback for the ROS service.
@@ -118,9 +195,9 @@ class Selection
 		
 		/**
 		 * \brief Visualize the selected grasps so that they can be viewed in Rviz.
-		 * \param the list of grasps to be visualized
+		 * \param grasps the ROS message containing the selected grasps
 		*/
-    void drawGrasps(const std::vector<GraspScored>& list);
+    void drawGrasps(const grasp_selection::GraspList& grasps);
     
     /**
 		 * \brief Create a list of visual grasp approach direction markers.
@@ -147,20 +224,32 @@ class Selection
 		ros::Subscriber cloud_sub_;
     ros::Subscriber joint_states_sub_;
     ros::Publisher visuals_pub_;
+    ros::Publisher stats_pub_;
+    ros::Publisher diagnostics_pub_;
+    ros::Publisher memory_pub_;
+    ros::Publisher perf_pub_;
+    ros::Timer stats_timer_;
     ros::ServiceServer service_;
-		agile_grasp::Grasps grasps_;
-		PointCloud::Ptr cloud_;
+		agile_grasp::Grasps::ConstPtr grasps_; ///< the latest grasps message (shared with roscpp, never copied)
+		sensor_msgs::PointCloud2::ConstPtr cloud_; ///< the latest point cloud message
+		sensor_msgs::PointCloud2::ConstPtr grasps_cloud_; ///< the point cloud message paired with the latest grasps
+		sensor_msgs::PointCloud2::ConstPtr scene_cloud_; ///< the point cloud message used by the pipeline
+    sensor_msgs::JointState::ConstPtr joint_state_; ///< the latest joint states message
     std::vector<std::string> joint_names_;
     int num_joints_;
     int joint_states_start_index_;
     std::string planning_frame_;
 		bool has_grasps_;
 		bool has_cloud_;    
-		Reaching* reaching_;
-		Scoring* scoring_;    
+		bool is_scene_changed_; ///< whether the pipeline has to be given new grasps or a new point cloud
+		SelectionPipeline* pipeline_; ///< the grasp selection (created once the joint names are known)
+		TraceRecorder* trace_; ///< the recorder for the Chrome traces of the requests (NULL: no tracing)
+		std::string trace_directory_; ///< the directory that the Chrome traces are written to
+		int num_traces_; ///< the number of written Chrome traces
+		RequestLogWriter* request_log_; ///< the log of the requests (NULL: no log)
+		bool is_scene_logged_; ///< whether the current grasps and point cloud have been written to the request log
     double marker_lifetime_;
     double hand_offset_;
-    int scoring_mode_;
 };
 
 #endif /* SELECTION_H */ 
@@ -0,0 +1,212 @@
+#ifndef SELECTION_PIPELINE_H
+#define SELECTION_PIPELINE_H
+
+#include <Eigen/Dense>
+
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include <pcl/filters/voxel_grid.h>
+
+#include <eigen_conversions/eigen_msg.h>
+#include <geometry_msgs/Pose.h>
+#include <pcl_conversions/pcl_conversions.h>
+#include <sensor_msgs/JointState.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <urdf/model.h>
+
+#include <string>
+#include <vector>
+
+#include <agile_grasp/Grasps.h>
+
+#include <grasp_selection/arena.h>
+#include <grasp_selection/async_logger.h>
+#include <grasp_selection/candidate_store.h>
+#include <grasp_selection/ik_solver.h>
+#include <grasp_selection/memory_usage.h>
+#include <grasp_selection/pipeline_stats.h>
+#include <grasp_selection/profiling.h>
+#include <grasp_selection/reaching.h>
+#include <grasp_selection/scene_index.h>
+#include <grasp_selection/scoring.h>
+#include <grasp_selection/trajectory_planner.h>
+
+#include <grasp_selection/Grasp.h>
+#include <grasp_selection/GraspList.h>
+
+
+/** SelectionPipeline class
+ *
+ * \brief The grasp selection, from the input messages to the list of selected grasps
+ *
+ * This class runs the grasp selection on the grasps, point cloud and joint state messages that it is given: it
+ * prepares the point cloud for collision checking, filters out the unreachable grasps, scores the remaining grasps,
+ * and plans trajectories for the best ones. It does not communicate with ROS itself (apart from the Inverse Kinematics
+ * solver, which may call a ROS service), so the same selection can run in the ROS node and in offline tools.
+ *
+*/
+class SelectionPipeline
+{
+	public:
+
+		/**
+		 * \brief The sizes of the data of the current scene.
+		*/
+		struct DataSizes
+		{
+			uint64_t num_cloud_points_; ///< the number of points in the received point cloud
+			uint64_t num_voxels_; ///< the number of points left after the downsampling
+			uint64_t cloud_bytes_; ///< the memory of the downsampled point cloud
+			uint64_t scene_index_bytes_; ///< the memory of the spatial index of the point cloud
+			uint64_t num_grasps_; ///< the number of grasps
+			uint64_t num_candidates_; ///< the number of candidates evaluated by the reachability test
+			uint64_t num_reachable_; ///< the number of reachable grasps
+			uint64_t candidate_bytes_; ///< the memory reserved for the reachable grasps
+			uint64_t arena_bytes_; ///< the temporary memory of the last request (grasp and candidate arrays)
+		};
+
+		/**
+		 * \brief Constructor.
+		 * \param reaching_params the parameters for the reaching class
+		 * \param planner_params the parameters for the trajectory planner class
+		 * \param urdf the URDF model
+		 * \param joint_names the names of the arm joints
+		 * \param num_selected the maximum number of selected grasps
+		 * \param scoring_mode the scoring mode (see Scoring)
+		 * \param scene_cell_size the edge length of the grid cells of the point cloud index
+		 * \param ik_solver the Inverse Kinematics solver (owned by this object)
+		*/
+		SelectionPipeline(const Reaching::Parameters& reaching_params, const TrajectoryPlanner::Parameters& planner_params,
+			const urdf::Model& urdf, const std::vector<std::string>& joint_names, int num_selected, int scoring_mode,
+			double scene_cell_size, IKSolver* ik_solver);
+
+		/**
+		 * \brief Destructor.
+		*/
+		~SelectionPipeline()
+		{
+			delete reaching_;
+			delete scoring_;
+			delete planner_;
+		}
+
+		/**
+		 * \brief Set the point cloud used for collision checking. The point cloud is downsampled and indexed.
+		 * \param msg the ROS message containing the point cloud
+		*/
+		void setPointCloud(const sensor_msgs::PointCloud2& msg);
+
+		/**
+		 * \brief Set the grasps that are selected from.
+		 * \param msg the ROS message containing the grasps (shared, never copied)
+		*/
+		void setGrasps(const agile_grasp::Grasps::ConstPtr& msg);
+
+		/**
+		 * \brief Set the current joint state of the robot.
+		 * \param msg the ROS message containing the joint state
+		*/
+		void setJointState(const sensor_msgs::JointState& msg);
+
+		/**
+		 * \brief Select grasps for the current grasps, point cloud and joint state.
+		 * \param hand_pose the current pose of the robot hand
+		 * \param msg the ROS message containing the selected grasps
+		 * \return true if at least one grasp was selected, false otherwise
+		*/
+		bool selectGrasps(const geometry_msgs::Pose& hand_pose, grasp_selection::GraspList& msg);
+
+		PipelineStats& getStats() { return stats_; }
+
+		/**
+		 * \brief Return the rejection counts of the reachability test for the current scene (the scene that the last
+		 * selection was done for).
+		 * \return the rejection counts
+		*/
+		const RejectionCounts& getRejections() const { return rejections_; }
+
+		const PointCloud& getPointCloud() const { return *cloud_; }
+
+		/**
+		 * \brief Return the reachable grasps of the current scene.
+		 * \return the reachable grasps
+		*/
+		const CandidateStore& getReachableGrasps() const { return feasible_grasps_; }
+
+		/**
+		 * \brief Return the memory usage of the preparation (conversion, downsampling and indexing) of the current
+		 * point cloud.
+		 * \return the memory usage
+		*/
+		const MemoryUsage& getCloudMemory() const { return cloud_memory_; }
+
+		/**
+		 * \brief Return the memory usage of the last selection.
+		 * \return the memory usage
+		*/
+		const MemoryUsage& getRequestMemory() const { return request_memory_; }
+
+		/**
+		 * \brief Return the number of heap allocations of the evaluation of the last selection: the reachability test
+		 * (without the IK backend), the scoring and the selection, but not the response message. The temporary data of
+		 * the evaluation is taken from the arena, so once the arena and the buffers of the pipeline have grown to the
+		 * size of the scenes, this is zero.
+		 * \return the number of allocations (zero if the executable was built without counting_new.cpp)
+		*/
+		uint64_t getNumEvaluationAllocations() const { return num_evaluation_allocations_; }
+
+		/**
+		 * \brief Return the sizes of the data of the current scene.
+		 * \return the data sizes
+		*/
+		DataSizes getDataSizes() const;
+
+		bool hasGrasps() const { return grasps_ && grasps_->grasps.size() > 0; }
+
+
+	private:
+
+		/**
+		 * \brief Create a ROS message that contains the selected grasps.
+		 * \param grasps the reachable grasps
+		 * \param selected the selected grasps
+		 * \param hand_pose the current pose of the robot hand (used for the workspace distance)
+		 * \param msg the ROS message containing the selected grasps
+		*/
+		void createGraspListMsg(const CandidateStore& grasps, const Scoring::Ranking& selected,
+			const geometry_msgs::Pose& hand_pose, grasp_selection::GraspList& msg);
+
+		/**
+		 * \brief Plan joint-space trajectories to the top ranked grasps in parallel.
+		 * \param grasps the reachable grasps
+		 * \param selected the selected grasps, best first
+		 * \param msg the ROS message containing the selected grasps, receives the trajectories
+		*/
+		void preplanTrajectories(const CandidateStore& grasps, const Scoring::Ranking& selected,
+			grasp_selection::GraspList& msg);
+
+		agile_grasp::Grasps::ConstPtr grasps_; ///< the grasps message (shared with the caller, never copied)
+		PointCloud::Ptr cloud_; ///< the downsampled point cloud
+		SceneIndex scene_index_; ///< the spatial index of the point cloud used for collision checking
+		CandidateStore feasible_grasps_; ///< the reachable grasps for the current scene
+		Scoring::Ranking ranking_; ///< the hand pose independent ranking of the reachable grasps
+		bool is_scene_evaluated_; ///< whether the reachable grasps and their ranking are up to date
+		Arena arena_; ///< the memory arena for temporary data, reset at the start of each request
+		PipelineStats stats_; ///< the latency statistics of the grasp selection stages
+		MemoryUsage cloud_memory_; ///< the memory usage of the preparation of the current point cloud
+		MemoryUsage request_memory_; ///< the memory usage of the last selection
+		uint64_t num_cloud_points_; ///< the number of points in the received point cloud
+		uint64_t num_evaluation_allocations_; ///< the number of heap allocations of the evaluation of the last selection
+		RejectionCounts rejections_; ///< the rejection counts of the reachability test for the current scene
+		std::vector<std::string> joint_names_; ///< the names of the arm joints
+		std::vector<double> joint_positions_; ///< the current joint positions of the robot arm
+		bool has_joint_positions_; ///< whether the current joint positions are known
+		int joint_states_start_index_; ///< the index of the first arm joint in the joint state messages
+		std::string planning_frame_; ///< the planning frame
+		int scoring_mode_; ///< the scoring mode
+		Reaching* reaching_;
+		Scoring* scoring_;
+		TrajectoryPlanner* planner_;
+};
+
+#endif /* SELECTION_PIPELINE_H */
@@ -0,0 +1,174 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/** TraceRecorder class
+ *
+ * \brief Records timed events and writes them as a Chrome trace
+ *
+ * This class records the start and the duration of named events, e.g., the stages of the grasp selection and each IK
+ * request, together with the thread that they ran on. The events can be written to a JSON file in the Chrome trace
+ * event format, which can be viewed in chrome://tracing or in Perfetto (https://ui.perfetto.dev).
+ *
+ * Each thread records into its own buffer, so recording does not take a lock (only the first event of a thread does,
+ * to create the buffer). The buffers are bounded; events that do not fit are dropped and counted. Writing and clearing
+ * the events is not thread-safe: no other thread may record events at the same time.
+ *
+*/
+class TraceRecorder
+{
+	public:
+
+		typedef std::chrono::steady_clock Clock;
+
+		/**
+		 * \brief Constructor.
+		 * \param capacity the maximum number of events per thread between two calls of write() or clear()
+		*/
+		TraceRecorder(int capacity = 1 << 16);
+
+		/**
+		 * \brief Destructor.
+		*/
+		~TraceRecorder();
+
+		/**
+		 * \brief Record an event.
+		 * \param name the name of the event (has to be a string literal or outlive this object)
+		 * \param start the time at which the event started
+		 * \param end the time at which the event ended
+		 * \param id an identifier shown with the event, e.g., the grasp id (-1: none)
+		*/
+		void record(const char* name, const Clock::time_point& start, const Clock::time_point& end, int id = -1)
+		{
+			ThreadBuffer* buffer = getThreadBuffer();
+			if (buffer->events_.size() == capacity_)
+			{
+				buffer->num_dropped_++;
+				return;
+			}
+
+			Event event = {name, std::chrono::duration_cast<std::chrono::nanoseconds>(start - origin_).count(),
+				std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(), id};
+			buffer->events_.push_back(event);
+		}
+
+		/**
+		 * \brief Write all recorded events to a file in the Chrome trace event format, and clear them.
+		 * \param filename the name of the file
+		 * \return true if the file could be written, false otherwise
+		*/
+		bool write(const std::string& filename);
+
+		/**
+		 * \brief Clear all recorded events.
+		*/
+		void clear();
+
+
+	private:
+
+		/**
+		 * \brief A recorded event.
+		*/
+		struct Event
+		{
+			const char* name_; ///< the name of the event
+			int64_t start_; ///< the start of the event in nanoseconds since the creation of the recorder
+			int64_t duration_; ///< the duration of the event in nanoseconds
+			int id_; ///< the identifier shown with the event (-1: none)
+		};
+
+		/**
+		 * \brief The events recorded by one thread.
+		*/
+		struct ThreadBuffer
+		{
+			std::thread::id thread_; ///< the thread that records into this buffer
+			int index_; ///< the index of the thread (used as the thread id in the trace)
+			std::vector<Event> events_; ///< the recorded events
+			size_t num_dropped_; ///< the number of events that did not fit into the buffer
+		};
+
+		/**
+		 * \brief Return the buffer of the calling thread, and create it if the thread has not recorded events yet.
+		 * \return the buffer
+		*/
+		ThreadBuffer* getThreadBuffer()
+		{
+			// the buffer of the last recorder used by this thread is cached, so that recording does not take a lock
+			static thread_local uint64_t cached_recorder = 0;
+			static thread_local ThreadBuffer* cached_buffer = NULL;
+			if (cached_recorder != id_)
+			{
+				cached_buffer = findThreadBuffer();
+				cached_recorder = id_;
+			}
+			return cached_buffer;
+		}
+
+		/**
+		 * \brief Find or create the buffer of the calling thread.
+		 * \return the buffer
+		*/
+		ThreadBuffer* findThreadBuffer();
+
+		static std::atomic<uint64_t> next_id_; ///< the identifier of the next recorder (0 is not used)
+
+		uint64_t id_; ///< the identifier of this recorder (distinguishes the recorders in the thread-local cache)
+		size_t capacity_; ///< the maximum number of events per thread
+		Clock::time_point origin_; ///< the time at which the recorder was created
+		std::mutex mutex_; ///< protects the list of buffers
+		std::vector<ThreadBuffer*> buffers_; ///< the buffers of all threads that recorded events
+};
+
+
+/** TraceScope class
+ *
+ * \brief Records an event that lasts until the object goes out of scope
+ *
+*/
+class TraceScope
+{
+	public:
+
+		/**
+		 * \brief Constructor. Start the event.
+		 * \param trace the recorder that the event is recorded in (nothing is recorded if NULL)
+		 * \param name the name of the event (has to be a string literal)
+		 * \param id an identifier shown with the event (-1: none)
+		*/
+		TraceScope(TraceRecorder* trace, const char* name, int id = -1) : trace_(trace), name_(name), id_(id)
+		{
+			if (trace_ != NULL)
+				start_ = TraceRecorder::Clock::now();
+		}
+
+		/**
+		 * \brief Destructor. Record the event.
+		*/
+		~TraceScope()
+		{
+			if (trace_ != NULL)
+				trace_->record(name_, start_, TraceRecorder::Clock::now(), id_);
+		}
+
+
+	private:
+
+		TraceRecorder* trace_; ///< the recorder that the event is recorded in
+		const char* name_; ///< the name of the event
+		int id_; ///< the identifier shown with the event
+		TraceRecorder::Clock::time_point start_; ///< the time at which the event started
+};
+
+#endif /* TRACE_RECORDER_H */
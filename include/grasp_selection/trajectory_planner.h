@@ -0,0 +1,97 @@
+#ifndef TRAJECTORY_PLANNER_H
+#define TRAJECTORY_PLANNER_H
+
+#include <Eigen/Dense>
+
+#include <trajectory_msgs/JointTrajectory.h>
+#include <urdf/model.h>
+
+#include <string>
+#include <vector>
+
+#include <grasp_selection/arm_kinematics.h>
+#include <grasp_selection/scene_index.h>
+
+
+/** TrajectoryPlanner class
+ *
+ * \brief Joint-space trajectories to selected grasps
+ *
+ * This class creates time-parameterized trajectories that interpolate linearly in joint space from the current joint
+ * positions of the robot arm to the pre-grasp poses and the grasp pose of a grasp. Each segment is time-parameterized
+ * with a minimum jerk profile that respects the joint velocity limits. All segments are checked for collisions of the
+ * arm links with the point cloud at a given resolution, including the waypoints at their ends. All joint positions are
+ * in the order of the given joint names. Planning only reads from the planner and the scene index, so several
+ * trajectories can be planned in parallel.
+ *
+*/
+class TrajectoryPlanner
+{
+	public:
+
+		/**
+		* \brief Data structure containing trajectory planning parameters.
+		*/
+		struct Parameters
+		{
+			int num_preplanned_; ///< the number of top ranked grasps for which trajectories are planned (0: none)
+			double resolution_; ///< the maximum joint motion (in radians) between two collision-checked samples
+			double velocity_scaling_; ///< the fraction of the joint velocity limits used by the trajectories
+			double link_radius_; ///< the radius of the capsules that approximate the arm links
+			int max_colliding_points_; ///< the maximum number of points that are allowed to be in collision
+		};
+
+		/**
+		 * \brief Constructor.
+		 * \param params the parameters
+		 * \param urdf the URDF model of the robot
+		 * \param base_link the name of the planning frame
+		 * \param tip_link the name of the link of the robot hand
+		 * \param joint_names the names of the arm joints, in the order in which joint positions are given
+		*/
+		TrajectoryPlanner(const Parameters& params, const urdf::Model& urdf, const std::string& base_link,
+			const std::string& tip_link, const std::vector<std::string>& joint_names);
+
+		/**
+		 * \brief Plan a trajectory through a sequence of joint-space waypoints.
+		 * \param start the current joint positions of the robot arm
+		 * \param waypoints the joint positions to pass through (<num_waypoints> sets of joint positions), the first is the
+		 * end of the transit segment, the last is the grasp
+		 * \param num_waypoints the number of waypoints
+		 * \param index the scene index for collision checking
+		 * \param trajectory the trajectory
+		 * \return true if the trajectory is collision-free, false otherwise
+		*/
+		bool planTrajectory(const double* start, const double* waypoints, int num_waypoints, const SceneIndex& index,
+			trajectory_msgs::JointTrajectory& trajectory) const;
+
+		const Parameters& getParameters() const { return params_; }
+
+
+	private:
+
+		/**
+		 * \brief Append a linear joint-space segment to a trajectory.
+		 * \param from the joint positions at the start of the segment
+		 * \param to the joint positions at the end of the segment
+		 * \param index the scene index for collision checking, or NULL if the segment is not checked
+		 * \param trajectory the trajectory (its last point is the start of the segment)
+		 * \return true if the segment is collision-free, false otherwise
+		*/
+		bool appendSegment(const double* from, const double* to, const SceneIndex* index,
+			trajectory_msgs::JointTrajectory& trajectory) const;
+
+		/**
+		 * \brief Check whether the arm links are collision-free for a set of joint positions.
+		 * \param joint_positions the joint positions
+		 * \param index the scene index
+		 * \return true if the arm is not in collision, false otherwise
+		*/
+		bool isCollisionFree(const double* joint_positions, const SceneIndex& index) const;
+
+		Parameters params_; ///< the parameters
+		ArmKinematics kinematics_; ///< the forward kinematics of the arm
+		std::vector<std::string> joint_names_; ///< the names of the arm joints
+};
+
+#endif /* TRAJECTORY_PLANNER_H */
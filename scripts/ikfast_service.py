@@ -92,12 +92,19 @@ class IKService():
   def handleSolveIKFast(self, req):    
     self.robot.SetDOFValues(self.joint_values, self.manip.GetArmIndices()) # set the current solution    
     sols = self.manip.FindIKSolutions(self.geometryMsgToTransform(req.target_pose), 18) # solve IK (ignore collisions)
+    
+    # use the given joint positions as reference (e.g., the solution for a neighboring pose), or the current ones
+    if len(req.current_joint_positions) > 0:
+      reference = numpy.array(req.current_joint_positions)
+    else:
+      reference = self.joint_values
+    
     resp = SolveIKResponse()
     if len(sols) == 0:
       resp.solution = []    
       resp.success = False
     else:
-      resp.solution = self.findClosestIK(self.joint_values, sols) # find closest IK solution
+      resp.solution = self.findClosestIK(reference, sols) # find closest IK solution
       resp.success = True
     rospy.loginfo( "---- Response send ----")
     return resp
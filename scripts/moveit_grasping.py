@@ -346,7 +346,7 @@ def grasping():
     while not has_grasps:
       quittableInput("Hit Enter to request grasps ")
       try:
-        resp = select_grasps(group.get_current_pose().pose)
+        resp = select_grasps(hand_pose=group.get_current_pose().pose)
         has_grasps = True          
       except rospy.ServiceException, e:
         print "Service call failed: %s"%e
@@ -218,11 +218,12 @@ class Grasping():
       s = raw_input("Hit Enter to request grasps ")
       try:
         pose_msg = self.transformToGeometryMsg(manip.GetEndEffectorTransform())
-        self.resp = select_grasps(pose_msg)
+        self.resp = select_grasps(hand_pose=pose_msg)
         
         # select grasp at random
         idx = random.randint(0, len(self.resp.grasps.grasps) - 1)
-        print "Randomly selected grasp #", idx
+        print "Randomly selected grasp #", idx, "(agile_grasp id:", self.resp.grasps.grasps[idx].grasp_id, ", score:", \
+          self.resp.grasps.grasps[idx].score, ")"
                             
         # move arm to selected grasp
         num_waypoints = 3
@@ -244,8 +245,12 @@ class Grasping():
         for i in range(0,num_waypoints):
           robot.SetDOFValues(self.joint_values, manip.GetArmIndices())
           goal = self.geometryMsgToTransform(waypoints[i])
-          sol = manip.FindIKSolution(goal, openravepy.IkFilterOptions.CheckEnvCollisions) # get collision-free solution
-          if sol == None:
+          if dist[i] == 0.0 and len(self.resp.grasps.grasps[idx].joint_positions) > 0:
+            # the grasp selection node has already solved IK for the grasp pose
+            sol = numpy.array(self.resp.grasps.grasps[idx].joint_positions)
+          else:
+            sol = manip.FindIKSolution(goal, openravepy.IkFilterOptions.CheckEnvCollisions) # get collision-free solution
+          if sol is None:
             print "IK solver failed!"
             ik_failed = True
             break
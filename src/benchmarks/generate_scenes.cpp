@@ -0,0 +1,160 @@
+#include <ros/ros.h>
+#include <rosbag/bag.h>
+#include <urdf/model.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <grasp_selection/ikfast_solver.h>
+#include <grasp_selection/scene_generator.h>
+#include <grasp_selection/scene_replay.h>
+
+
+// Generator of synthetic scenes for the scaling benchmarks: writes tabletop scenes (see SceneGenerator) with every
+// combination of the given grasp counts and point counts to a bag file, on the topics that replay_benchmark and
+// perf_regression read by default. The scenes use the Baxter defaults of SceneReplay, so replaying the bag reports how
+// the reachability test and the scoring scale with the number of grasps and the size of the point cloud. The ground
+// truth of each grasp is written to <bag>.labels.csv.
+//
+// Usage: generate_scenes urdf bag [grasp_counts] [point_counts] [seed] [num_objects] [label_fractions]
+//
+// The counts and the fractions (reachable, unreachable, outside_workspace, invalid_aperture) are comma-separated,
+// e.g.:
+//   generate_scenes baxter.urdf scaling.bag 10,100,1000,10000,100000 5000,50000 1 10 0.4,0.2,0.2,0.2
+
+
+/** The joints on the /robot/joint_states topic of the Baxter robot, with the right arm at indices 9 to 15. */
+const char* BAXTER_JOINT_STATE_NAMES[] = {"head_nod", "head_pan", "left_e0", "left_e1", "left_s0", "left_s1",
+  "left_w0", "left_w1", "left_w2", "right_e0", "right_e1", "right_s0", "right_s1", "right_w0", "right_w1", "right_w2",
+  "torso_t0"};
+
+
+/** Parse a comma-separated list of numbers. */
+template <typename T>
+bool parseList(const std::string& text, std::vector<T>& values)
+{
+  values.clear();
+  std::istringstream stream(text);
+  std::string item;
+  while (std::getline(stream, item, ','))
+  {
+    std::istringstream item_stream(item);
+    T value;
+    if (!(item_stream >> value))
+      return false;
+    values.push_back(value);
+  }
+  return !values.empty();
+}
+
+
+int main(int argc, char** argv)
+{
+  if (argc < 3)
+  {
+    std::cout << "Usage: generate_scenes urdf bag [grasp_counts] [point_counts] [seed] [num_objects] "
+      << "[label_fractions]\n";
+    return 2;
+  }
+
+  const std::string urdf_filename = argv[1];
+  const std::string bag_filename = argv[2];
+  SceneGenerator::Parameters params = SceneGenerator::getDefaultParameters();
+  std::vector<int> grasp_counts(1, params.num_grasps_), point_counts(1, params.num_points_);
+  std::vector<double> fractions(params.label_fractions_, params.label_fractions_ + SceneGenerator::NUM_LABELS);
+  if ((argc > 3 && !parseList(argv[3], grasp_counts)) || (argc > 4 && !parseList(argv[4], point_counts))
+    || (argc > 7 && (!parseList(argv[7], fractions) || fractions.size() != SceneGenerator::NUM_LABELS)))
+  {
+    ROS_ERROR("Invalid grasp counts, point counts or label fractions");
+    return 2;
+  }
+  params.seed_ = (argc > 5) ? atoi(argv[5]) : params.seed_;
+  params.num_objects_ = (argc > 6) ? atoi(argv[6]) : params.num_objects_;
+  std::copy(fractions.begin(), fractions.end(), params.label_fractions_);
+
+  // the bag messages are stamped with the time at which they are written
+  ros::Time::init();
+
+  urdf::Model urdf;
+  if (!urdf.initFile(urdf_filename))
+  {
+    ROS_ERROR("Failed to parse urdf file");
+    return 2;
+  }
+
+  // the scenes are generated for the parameters with which SceneReplay replays them
+  SceneReplay replay;
+  const Reaching::Parameters& reaching_params = replay.getParameters();
+  IKFastSolver solver(urdf, reaching_params.planning_frame_, reaching_params.ik_base_link_, reaching_params.arm_link_);
+  if (!solver.isValid())
+    return 2;
+  std::vector<std::string> joint_state_names(BAXTER_JOINT_STATE_NAMES, BAXTER_JOINT_STATE_NAMES
+    + sizeof(BAXTER_JOINT_STATE_NAMES) / sizeof(BAXTER_JOINT_STATE_NAMES[0]));
+  SceneGenerator generator(reaching_params, solver, joint_state_names);
+
+  const std::string labels_filename = bag_filename + ".labels.csv";
+  FILE* labels_file = fopen(labels_filename.c_str(), "w");
+  if (labels_file == NULL)
+  {
+    ROS_ERROR("Could not write %s", labels_filename.c_str());
+    return 2;
+  }
+  fprintf(labels_file, "scene,grasp,label\n");
+
+  rosbag::Bag bag;
+  bag.open(bag_filename, rosbag::bagmode::Write);
+
+  // each scene has its own seed, so that a scene does not change when the counts of the other scenes change
+  int scene_index = 0;
+  for (int i = 0; i < grasp_counts.size(); i++)
+  {
+    for (int j = 0; j < point_counts.size(); j++, scene_index++)
+    {
+      SceneGenerator::Parameters scene_params = params;
+      scene_params.seed_ = params.seed_ + scene_index;
+      scene_params.num_grasps_ = grasp_counts[i];
+      scene_params.num_points_ = point_counts[j];
+
+      SceneGenerator::Scene scene;
+      if (!generator.generate(scene_params, reaching_params.planning_frame_, scene))
+      {
+        bag.close();
+        fclose(labels_file);
+        return 1;
+      }
+
+      // the cloud and the joint state precede the grasps, which form a scene with them (see SceneReplay)
+      const ros::Time stamp = ros::Time::now();
+      scene.cloud_.header.stamp = stamp;
+      scene.joint_state_.header.stamp = stamp;
+      scene.grasps_.header.stamp = stamp;
+      bag.write("/register_clouds/point_cloud", stamp, scene.cloud_);
+      bag.write("/robot/joint_states", stamp, scene.joint_state_);
+      bag.write("/find_grasps/handle_grasps", stamp, scene.grasps_);
+
+      int counts[SceneGenerator::NUM_LABELS] = {0};
+      for (int g = 0; g < scene.labels_.size(); g++)
+      {
+        counts[scene.labels_[g]]++;
+        fprintf(labels_file, "%i,%i,%s\n", scene_index, g, SceneGenerator::getLabelName(scene.labels_[g]));
+      }
+
+      printf("scene %i: %i grasps, %i points, seed %i,", scene_index, scene_params.num_grasps_,
+        scene_params.num_points_, scene_params.seed_);
+      for (int l = 0; l < SceneGenerator::NUM_LABELS; l++)
+        printf(" %s %i", SceneGenerator::getLabelName((SceneGenerator::Label) l), counts[l]);
+      printf("\n");
+    }
+  }
+
+  bag.close();
+  fclose(labels_file);
+  printf("\nWrote %i scenes to %s and their labels to %s\n", scene_index, bag_filename.c_str(),
+    labels_filename.c_str());
+  return 0;
+}
@@ -0,0 +1,207 @@
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+
+#include <eigen_conversions/eigen_msg.h>
+#include <geometry_msgs/PoseStamped.h>
+#include <tf/transform_datatypes.h>
+#include <tf_conversions/tf_eigen.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <agile_grasp/Grasps.h>
+
+#include <grasp_selection/arena.h>
+#include <grasp_selection/grasp_arrays.h>
+#include <grasp_selection/grasp_pose_kernel.h>
+
+
+// Benchmark for the generation of robot hand poses: compares the per-grasp path that the Reaching class used before
+// (Eigen transforms, dynamically sized temporaries, TF conversions and ROS messages) against the batch kernel, and
+// checks that both produce the same poses.
+//
+// Usage: grasp_pose_benchmark [num_grasps] [num_additional_grasps] [num_repetitions]
+
+
+const double HAND_OFFSET = 0.08;
+
+
+/** The pose generation of the previous implementation, one grasp at a time. */
+struct LegacyGrasp
+{
+  Eigen::Vector3d center_;
+  Eigen::Vector3d axis_;
+  Eigen::Vector3d approach_;
+  Eigen::Vector3d binormal_;
+};
+
+
+LegacyGrasp rotateGrasp(const LegacyGrasp& grasp_in, double theta)
+{
+  LegacyGrasp grasp_out;
+  Eigen::Transform<double, 3, Eigen::Affine> R(Eigen::AngleAxis<double>(theta * (M_PI / 180.0), grasp_in.binormal_));
+  grasp_out.axis_ = R * grasp_in.axis_;
+  grasp_out.approach_ = R * (-1.0 * grasp_in.approach_);
+  grasp_out.binormal_ = grasp_out.axis_.cross(grasp_out.approach_);
+  grasp_out.center_ = grasp_in.center_;
+  return grasp_out;
+}
+
+
+Eigen::Matrix3d reorderHandAxes(const Eigen::Matrix3d& Q, const std::vector<int>& axis_order)
+{
+  Eigen::Matrix3d R = Eigen::MatrixXd::Zero(3, 3);
+  R.col(axis_order[0]) = Q.col(0);
+  R.col(axis_order[1]) = Q.col(1);
+  R.col(axis_order[2]) = Q.col(2);
+  return R;
+}
+
+
+void calculateHandOrientations(const LegacyGrasp& grasp, const std::vector<int>& axis_order, tf::Quaternion quats[2])
+{
+  Eigen::Matrix3d R = Eigen::MatrixXd::Zero(3, 3);
+  R.col(0) = -1.0 * grasp.approach_;
+  R.col(1) = grasp.axis_;
+  R.col(2) << R.col(0).cross(R.col(1));
+
+  Eigen::Transform<double, 3, Eigen::Affine> T(Eigen::AngleAxis<double>(M_PI, grasp.approach_));
+  Eigen::Matrix3d Q = Eigen::MatrixXd::Zero(3, 3);
+  Q.col(0) = T * grasp.approach_;
+  Q.col(1) = T * grasp.axis_;
+  Q.col(2) << Q.col(0).cross(Q.col(1));
+
+  tf::Matrix3x3 TF1, TF2;
+  tf::matrixEigenToTF(reorderHandAxes(R, axis_order), TF1);
+  tf::matrixEigenToTF(reorderHandAxes(Q, axis_order), TF2);
+  TF1.getRotation(quats[0]);
+  TF2.getRotation(quats[1]);
+  quats[0].normalize();
+  quats[1].normalize();
+}
+
+
+void createGraspPose(const LegacyGrasp& grasp, const tf::Quaternion& quat, geometry_msgs::PoseStamped& pose_st)
+{
+  Eigen::Vector3d position = grasp.center_ + HAND_OFFSET * (-1.0 * grasp.approach_);
+  pose_st.header.stamp = ros::Time(0);
+  pose_st.header.frame_id = "base";
+  tf::pointEigenToMsg(position, pose_st.pose.position);
+  tf::quaternionTFToMsg(quat, pose_st.pose.orientation);
+}
+
+
+/** Create random grasps with orthonormal hand axes and approach directions. */
+agile_grasp::Grasps createGrasps(int num_grasps)
+{
+  agile_grasp::Grasps msg;
+  std::vector<agile_grasp::Grasp>& grasps = msg.grasps;
+  grasps.resize(num_grasps);
+  for (int i = 0; i < num_grasps; i++)
+  {
+    Eigen::Vector3d center = Eigen::Vector3d::Random();
+    Eigen::Vector3d axis = Eigen::Vector3d::Random().normalized();
+    Eigen::Vector3d approach = axis.unitOrthogonal();
+    approach = Eigen::AngleAxisd(M_PI * Eigen::Vector2d::Random()(0), axis) * approach;
+    tf::vectorEigenToMsg(center, grasps[i].center);
+    tf::vectorEigenToMsg(center, grasps[i].surface_center);
+    tf::vectorEigenToMsg(axis, grasps[i].axis);
+    tf::vectorEigenToMsg(approach, grasps[i].approach);
+    grasps[i].width.data = 0.05;
+  }
+  return msg;
+}
+
+
+int main(int argc, char** argv)
+{
+  int num_grasps = (argc > 1) ? atoi(argv[1]) : 1000;
+  int num_additional_grasps = (argc > 2) ? atoi(argv[2]) : 4;
+  int num_repetitions = (argc > 3) ? atoi(argv[3]) : 100;
+
+  std::vector<int> axis_order(3);
+  axis_order[0] = 2;
+  axis_order[1] = 0;
+  axis_order[2] = 1;
+
+  agile_grasp::Grasps msg = createGrasps(num_grasps);
+  const std::vector<agile_grasp::Grasp>& grasps = msg.grasps;
+  Arena arena;
+  ArenaVector<double> theta(1 + num_additional_grasps);
+  for (int j = 0; j < theta.size(); j++)
+    theta[j] = (num_additional_grasps > 0) ? -15.0 + 30.0 * j / num_additional_grasps : 0.0;
+
+  // previous implementation
+  std::vector<geometry_msgs::PoseStamped> legacy_poses(2 * num_grasps * theta.size());
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < num_repetitions; r++)
+  {
+    for (int i = 0; i < num_grasps; i++)
+    {
+      LegacyGrasp grasp;
+      tf::vectorMsgToEigen(grasps[i].center, grasp.center_);
+      tf::vectorMsgToEigen(grasps[i].axis, grasp.axis_);
+      tf::vectorMsgToEigen(grasps[i].approach, grasp.approach_);
+      grasp.approach_ = -1.0 * grasp.approach_;
+      grasp.binormal_ = grasp.axis_.cross(grasp.approach_);
+
+      for (int j = 0; j < theta.size(); j++)
+      {
+        LegacyGrasp grasp_rot = rotateGrasp(grasp, theta[j]);
+        tf::Quaternion quats[2];
+        calculateHandOrientations(grasp_rot, axis_order, quats);
+        for (int k = 0; k < 2; k++)
+          createGraspPose(grasp_rot, quats[k], legacy_poses[2 * (j * num_grasps + i) + k]);
+      }
+    }
+  }
+  double legacy_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+  // batch kernel
+  GraspPoseKernel kernel(axis_order, HAND_OFFSET);
+  t0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < num_repetitions; r++)
+  {
+    arena.reset();
+    GraspArrays arrays(msg, arena);
+    CandidatePoses poses(num_grasps, theta.size(), arena);
+    kernel.calculatePoses(arrays, theta, poses, arena);
+  }
+  double kernel_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+  // compare the poses (q and -q describe the same orientation)
+  GraspArrays arrays(msg, arena);
+  CandidatePoses poses(num_grasps, theta.size(), arena);
+  kernel.calculatePoses(arrays, theta, poses, arena);
+  double max_position_error = 0.0;
+  double max_orientation_error = 0.0;
+  for (int p = 0; p < num_grasps * theta.size(); p++)
+  {
+    for (int k = 0; k < 2; k++)
+    {
+      Eigen::Vector3d position;
+      Eigen::Quaterniond orientation;
+      tf::pointMsgToEigen(legacy_poses[2 * p + k].pose.position, position);
+      tf::quaternionMsgToEigen(legacy_poses[2 * p + k].pose.orientation, orientation);
+      max_position_error = std::max(max_position_error,
+        (position - poses.positions_.row(p).matrix().transpose()).norm());
+      max_orientation_error = std::max(max_orientation_error,
+        1.0 - std::abs(orientation.dot(poses.getOrientation(p, k))));
+    }
+  }
+
+  int num_poses = 2 * num_grasps * theta.size();
+  std::cout << "grasps: " << num_grasps << ", approach angles: " << theta.size() << ", poses: " << num_poses
+    << ", repetitions: " << num_repetitions << "\n";
+  std::cout << "previous implementation: " << 1e9 * legacy_time / (num_repetitions * num_poses) << " ns/pose\n";
+  std::cout << "batch kernel: " << 1e9 * kernel_time / (num_repetitions * num_poses) << " ns/pose\n";
+  std::cout << "speedup: " << legacy_time / kernel_time << "x\n";
+  std::cout << "max. position error: " << max_position_error << ", max. orientation error (1 - |<q1,q2>|): "
+    << max_orientation_error << "\n";
+
+  return (max_position_error < 1e-9 && max_orientation_error < 1e-9) ? 0 : 1;
+}
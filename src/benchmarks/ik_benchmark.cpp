@@ -0,0 +1,337 @@
+#include <ros/ros.h>
+#include <urdf/model.h>
+
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+
+#include <eigen_conversions/eigen_msg.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <grasp_selection/arena.h>
+#include <grasp_selection/grasp_arrays.h>
+#include <grasp_selection/grasp_pose_kernel.h>
+#include <grasp_selection/ik_solver.h>
+#include <grasp_selection/ikfast_solver.h>
+#include <grasp_selection/pipeline_stats.h>
+#include <grasp_selection/scene_generator.h>
+#include <grasp_selection/scene_replay.h>
+
+
+// Comparison of the IK backends of the reachability test: sends the same seeded set of robot hand poses through each
+// backend (the MoveIt /compute_ik service, the OpenRAVE /ikfast_solver service, and the in-process ikfast solver at
+// several free joint resolutions) and writes one CSV line per backend with the success rate, the agreement with the
+// first backend, the latency and the throughput. The poses are the two hand orientations of grasps from a synthetic
+// scene (see SceneGenerator), half of them reachable, computed in the same way as the reachability test computes
+// them. The services can be the real ones or ik_replay_node.
+//
+// Usage: ik_benchmark urdf [backends] [num_grasps] [num_threads] [seed] [csv_file]
+//
+// The backends are comma-separated: moveit, openrave, ikfast, or ikfast:<free_joint_step>, e.g.:
+//   ik_benchmark baxter.urdf ikfast,ikfast:0.05,ikfast:0.2,openrave,moveit 500 4 1 ik_backends.csv
+
+
+/** The joints on the /robot/joint_states topic of the Baxter robot, with the right arm at indices 9 to 15. */
+const char* BAXTER_JOINT_STATE_NAMES[] = {"head_nod", "head_pan", "left_e0", "left_e1", "left_s0", "left_s1",
+  "left_w0", "left_w1", "left_w2", "right_e0", "right_e1", "right_s0", "right_s1", "right_w0", "right_w1", "right_w2",
+  "torso_t0"};
+
+/** The arm joints in the robot state returned by MoveIt, starting at ik_first_joint_index. */
+const char* MOVEIT_ARM_JOINT_NAMES[] = {"right_e0", "right_e1", "right_s0", "right_s1", "right_w0", "right_w1",
+  "right_w2"};
+
+const double POSITION_TOLERANCE = 0.001; ///< the maximum position error of a correct solution (meters)
+const double ORIENTATION_TOLERANCE = 0.01; ///< the maximum orientation error of a correct solution (radians)
+const double JOINT_TOLERANCE = 0.01; ///< the maximum joint difference of two agreeing solutions (radians)
+
+
+/** The result of one IK request. */
+struct IKResult
+{
+  bool success_; ///< whether a solution was found
+  bool pose_ok_; ///< whether the forward kinematics of the solution reaches the requested pose
+  uint64_t latency_; ///< the time taken by the request (nanoseconds)
+  std::vector<double> joint_positions_; ///< the solution, in the order of the ikfast chain
+};
+
+
+/** An IK backend. */
+struct Backend
+{
+  std::string name_; ///< the name of the backend
+  std::string service_; ///< the ROS service of the backend (empty for an in-process solver)
+  double free_joint_step_; ///< the free joint resolution of an in-process solver
+  std::vector<int> chain_order_; ///< the index of each joint of the ikfast chain in the solutions of the backend
+};
+
+
+/** Parse a comma-separated list of backends. */
+bool parseBackends(const std::string& text, int num_joints, std::vector<Backend>& backends)
+{
+  std::istringstream stream(text);
+  std::string item;
+  while (std::getline(stream, item, ','))
+  {
+    Backend backend;
+    backend.name_ = item;
+    backend.free_joint_step_ = 0.1;
+    backend.chain_order_.resize(num_joints);
+    for (int j = 0; j < num_joints; j++)
+      backend.chain_order_[j] = j;
+
+    if (item == "moveit")
+      backend.service_ = "/compute_ik";
+    else if (item == "openrave")
+      backend.service_ = "/ikfast_solver";
+    else if (item.compare(0, 7, "ikfast:") == 0)
+    {
+      backend.free_joint_step_ = atof(item.c_str() + 7);
+      if (backend.free_joint_step_ <= 0.0)
+        return false;
+    }
+    else if (item != "ikfast")
+      return false;
+
+    backends.push_back(backend);
+  }
+  return !backends.empty();
+}
+
+
+/** Create an IK solver for a backend; each thread uses its own solver. */
+IKSolver* createSolver(const Backend& backend, const urdf::Model& urdf, const Reaching::Parameters& params,
+  int num_joints)
+{
+  if (backend.service_.empty())
+  {
+    return new IKFastSolver(urdf, params.planning_frame_, params.ik_base_link_, params.arm_link_,
+      std::vector<std::string>(), backend.free_joint_step_);
+  }
+
+  ros::NodeHandle node;
+  if (backend.name_ == "moveit")
+    return new MoveItIKSolver(node, params.move_group_, params.arm_link_, params.ik_first_joint_index_, num_joints);
+  return new OpenRaveIKSolver(node, num_joints, urdf, params.ik_base_link_, params.arm_link_);
+}
+
+
+/** Send the poses through a backend from several threads. */
+double runBackend(const Backend& backend, const urdf::Model& urdf, const Reaching::Parameters& params,
+  const sensor_msgs::JointState& joint_state, const std::vector<geometry_msgs::PoseStamped>& poses,
+  const IKFastSolver& fk_solver, int num_threads, std::vector<IKResult>& results)
+{
+  const int num_joints = fk_solver.getNumJoints();
+  std::vector<IKSolver*> solvers(num_threads);
+  for (int t = 0; t < num_threads; t++)
+  {
+    solvers[t] = createSolver(backend, urdf, params, num_joints);
+    solvers[t]->setJointState(joint_state);
+  }
+
+  results.assign(poses.size(), IKResult());
+  std::atomic<int> next(0);
+  std::vector<std::thread> threads;
+
+  PipelineStats::Clock::time_point start = PipelineStats::Clock::now();
+  for (int t = 0; t < num_threads; t++)
+  {
+    threads.push_back(std::thread([&, t]()
+    {
+      std::vector<double> solution(num_joints);
+      for (int i = next++; i < poses.size(); i = next++)
+      {
+        PipelineStats::Clock::time_point request_start = PipelineStats::Clock::now();
+        const bool success = solvers[t]->solve(poses[i], NULL, 1, 0.01, solution.data());
+        IKResult& result = results[i];
+        result.latency_ = std::chrono::duration_cast<std::chrono::nanoseconds>(PipelineStats::Clock::now()
+          - request_start).count();
+        result.success_ = success;
+        result.pose_ok_ = false;
+        if (!success)
+          continue;
+
+        result.joint_positions_.resize(num_joints);
+        for (int j = 0; j < num_joints; j++)
+          result.joint_positions_[j] = solution[backend.chain_order_[j]];
+
+        // check the solution against the requested pose with the forward kinematics
+        Eigen::Affine3d target;
+        tf::poseMsgToEigen(poses[i].pose, target);
+        const Eigen::Affine3d reached = fk_solver.calculatePose(result.joint_positions_.data());
+        const double position_error = (reached.translation() - target.translation()).norm();
+        const double orientation_error = Eigen::Quaterniond(reached.rotation()).angularDistance(
+          Eigen::Quaterniond(target.rotation()));
+        result.pose_ok_ = (position_error <= POSITION_TOLERANCE && orientation_error <= ORIENTATION_TOLERANCE);
+      }
+    }));
+  }
+  for (int t = 0; t < num_threads; t++)
+    threads[t].join();
+  const double seconds = std::chrono::duration<double>(PipelineStats::Clock::now() - start).count();
+
+  for (int t = 0; t < num_threads; t++)
+    delete solvers[t];
+  return seconds;
+}
+
+
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "ik_benchmark");
+
+  if (argc < 2)
+  {
+    std::cout << "Usage: ik_benchmark urdf [backends] [num_grasps] [num_threads] [seed] [csv_file]\n";
+    return 2;
+  }
+
+  const std::string urdf_filename = argv[1];
+  const std::string backends_text = (argc > 2) ? argv[2] : "ikfast,ikfast:0.05,openrave,moveit";
+  const int num_grasps = (argc > 3) ? atoi(argv[3]) : 500;
+  const int num_threads = std::max((argc > 4) ? atoi(argv[4]) : 1, 1);
+  const int seed = (argc > 5) ? atoi(argv[5]) : 1;
+  const std::string csv_filename = (argc > 6) ? argv[6] : "";
+
+  urdf::Model urdf;
+  if (!urdf.initFile(urdf_filename))
+  {
+    ROS_ERROR("Failed to parse urdf file");
+    return 2;
+  }
+
+  // the poses are generated for the Baxter parameters of SceneReplay
+  SceneReplay replay;
+  const Reaching::Parameters& params = replay.getParameters();
+  IKFastSolver fk_solver(urdf, params.planning_frame_, params.ik_base_link_, params.arm_link_);
+  if (!fk_solver.isValid())
+    return 2;
+  const int num_joints = fk_solver.getNumJoints();
+
+  std::vector<Backend> backends;
+  if (!parseBackends(backends_text, num_joints, backends))
+  {
+    ROS_ERROR("Invalid backends %s", backends_text.c_str());
+    return 2;
+  }
+
+  // MoveIt returns the arm joints in the order of the robot state, the services and ikfast in the order of the chain
+  const std::vector<std::string>& chain_names = fk_solver.getJointNames();
+  for (int b = 0; b < backends.size(); b++)
+  {
+    if (backends[b].name_ != "moveit")
+      continue;
+    for (int j = 0; j < num_joints; j++)
+    {
+      const char** name = std::find(MOVEIT_ARM_JOINT_NAMES, MOVEIT_ARM_JOINT_NAMES + num_joints, chain_names[j]);
+      backends[b].chain_order_[j] = name - MOVEIT_ARM_JOINT_NAMES;
+    }
+  }
+
+  // half of the grasps are reachable, and half are in the workspace and fit into the hand, but are unreachable
+  std::vector<std::string> joint_state_names(BAXTER_JOINT_STATE_NAMES, BAXTER_JOINT_STATE_NAMES
+    + sizeof(BAXTER_JOINT_STATE_NAMES) / sizeof(BAXTER_JOINT_STATE_NAMES[0]));
+  SceneGenerator generator(params, fk_solver, joint_state_names);
+  SceneGenerator::Parameters scene_params = SceneGenerator::getDefaultParameters();
+  const double fractions[SceneGenerator::NUM_LABELS] = {0.5, 0.5, 0.0, 0.0};
+  std::copy(fractions, fractions + SceneGenerator::NUM_LABELS, scene_params.label_fractions_);
+  scene_params.seed_ = seed;
+  scene_params.num_grasps_ = num_grasps;
+  scene_params.num_points_ = 1000;
+  SceneGenerator::Scene scene;
+  if (!generator.generate(scene_params, params.planning_frame_, scene))
+    return 1;
+
+  // the two hand orientations of each grasp, as requested by the reachability test
+  Arena arena;
+  GraspArrays grasps(scene.grasps_, arena);
+  ArenaVector<double> theta(1, 0.0, ArenaAllocator<double>(&arena));
+  CandidatePoses candidates(grasps.size(), theta.size(), arena);
+  GraspPoseKernel pose_kernel(params.axis_order_, params.hand_offset_);
+  pose_kernel.calculatePoses(grasps, theta, candidates, arena);
+
+  std::vector<geometry_msgs::PoseStamped> poses(2 * grasps.size());
+  for (int i = 0; i < grasps.size(); i++)
+  {
+    const int pose_index = candidates.index(i, 0);
+    const Eigen::Vector3d position = candidates.positions_.row(pose_index).matrix().transpose();
+    for (int k = 0; k < 2; k++)
+    {
+      geometry_msgs::PoseStamped& pose = poses[2 * i + k];
+      pose.header.frame_id = params.planning_frame_;
+      tf::pointEigenToMsg(position, pose.pose.position);
+      tf::quaternionEigenToMsg(candidates.getOrientation(pose_index, k), pose.pose.orientation);
+    }
+  }
+  printf("%i poses from %i grasps (seed %i), %i threads\n\n", (int) poses.size(), grasps.size(), seed, num_threads);
+
+  FILE* csv_file = csv_filename.empty() ? stdout : fopen(csv_filename.c_str(), "w");
+  if (csv_file == NULL)
+  {
+    ROS_ERROR("Could not write %s", csv_filename.c_str());
+    return 2;
+  }
+  fprintf(csv_file, "backend,threads,requests,success_rate,pose_ok_rate,success_agreement,joint_agreement,mean_ms,"
+    "p50_ms,p99_ms,throughput_hz,throughput_per_core_hz\n");
+
+  // the first backend that runs is the reference of the agreement
+  std::vector<IKResult> reference;
+  for (int b = 0; b < backends.size(); b++)
+  {
+    const Backend& backend = backends[b];
+    if (!backend.service_.empty() && (!ros::master::check() || !ros::service::exists(backend.service_, false)))
+    {
+      ROS_WARN("Skipping %s: the %s service is not available", backend.name_.c_str(), backend.service_.c_str());
+      continue;
+    }
+
+    std::vector<IKResult> results;
+    const double seconds = runBackend(backend, urdf, params, scene.joint_state_, poses, fk_solver, num_threads,
+      results);
+    if (reference.empty())
+      reference = results;
+
+    LatencyHistogram latencies;
+    int num_success = 0, num_pose_ok = 0, num_success_agreed = 0, num_both = 0, num_joints_agreed = 0;
+    for (int i = 0; i < results.size(); i++)
+    {
+      latencies.record(results[i].latency_);
+      num_success += results[i].success_;
+      num_pose_ok += results[i].pose_ok_;
+      num_success_agreed += (results[i].success_ == reference[i].success_);
+      if (!results[i].success_ || !reference[i].success_)
+        continue;
+
+      // a 7-DOF arm has many solutions for a pose, so the backends only agree if they choose the same one
+      num_both++;
+      double max_difference = 0.0;
+      for (int j = 0; j < num_joints; j++)
+        max_difference = std::max(max_difference, std::abs(results[i].joint_positions_[j]
+          - reference[i].joint_positions_[j]));
+      num_joints_agreed += (max_difference <= JOINT_TOLERANCE);
+    }
+
+    const double throughput = results.size() / seconds;
+    fprintf(csv_file, "%s,%i,%i,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.1f,%.1f\n", backend.name_.c_str(), num_threads,
+      (int) results.size(), (double) num_success / results.size(),
+      (num_success > 0) ? (double) num_pose_ok / num_success : 0.0,
+      (double) num_success_agreed / results.size(), (num_both > 0) ? (double) num_joints_agreed / num_both : 0.0,
+      1e3 * latencies.getMean(), 1e3 * latencies.calculatePercentile(50.0),
+      1e3 * latencies.calculatePercentile(99.0), throughput, throughput / num_threads);
+    fflush(csv_file);
+  }
+
+  if (csv_file != stdout)
+    fclose(csv_file);
+  return 0;
+}
@@ -0,0 +1,374 @@
+#include <benchmark/benchmark.h>
+
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include <pcl/filters/voxel_grid.h>
+
+#include <eigen_conversions/eigen_msg.h>
+#include <geometry_msgs/Pose.h>
+#include <geometry_msgs/PoseStamped.h>
+#include <urdf/model.h>
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <agile_grasp/Grasps.h>
+
+#include <grasp_selection/arena.h>
+#include <grasp_selection/async_logger.h>
+#include <grasp_selection/candidate_store.h>
+#include <grasp_selection/grasp_arrays.h>
+#include <grasp_selection/grasp_pose_kernel.h>
+#include <grasp_selection/ik_solver.h>
+#include <grasp_selection/ikfast_solver.h>
+#include <grasp_selection/reaching.h>
+#include <grasp_selection/scene_index.h>
+#include <grasp_selection/scoring.h>
+
+// the ikfast library is compiled with the same namespace (see CMakeLists.txt)
+#define IKFAST_HAS_LIBRARY
+#define IKFAST_NAMESPACE baxter_ikfast
+#include <ikfast.h>
+
+
+// Microbenchmarks (Google Benchmark) for the per-candidate kernels of the grasp selection: the collision check of the
+// reachability test, the generation of the robot hand poses, the scoring, the vendored ikfast solver, and the point
+// cloud downsampling. All inputs are generated from fixed seeds, so the numbers of two builds can be compared directly,
+// e.g., with the compare.py tool of Google Benchmark.
+//
+// Usage: kernel_benchmark [--benchmark_filter=<regex>] [--benchmark_format=json] [--benchmark_repetitions=<n>]
+
+
+const int SEED = 42;
+const int NUM_CANDIDATES = 1024; ///< the number of different inputs that the per-candidate benchmarks cycle through
+
+
+/** A minimal URDF of the Baxter right arm, with the joint limits of the Baxter URDF. */
+const char* BAXTER_ARM_URDF =
+  "<robot name='baxter'>"
+  "  <link name='base'/> <link name='right_arm_mount'/>"
+  "  <link name='right_upper_shoulder'/> <link name='right_lower_shoulder'/> <link name='right_upper_elbow'/>"
+  "  <link name='right_lower_elbow'/> <link name='right_upper_forearm'/> <link name='right_lower_forearm'/>"
+  "  <link name='right_wrist'/> <link name='right_hand'/> <link name='right_gripper'/>"
+  "  <joint name='right_torso_arm_mount' type='fixed'><parent link='base'/><child link='right_arm_mount'/>"
+  "    <origin xyz='0.024645 -0.219645 0.118588' rpy='0 0 -0.7854'/></joint>"
+  "  <joint name='right_s0' type='revolute'><parent link='right_arm_mount'/><child link='right_upper_shoulder'/>"
+  "    <limit lower='-1.7016' upper='1.7016' effort='50' velocity='1.5'/></joint>"
+  "  <joint name='right_s1' type='revolute'><parent link='right_upper_shoulder'/><child link='right_lower_shoulder'/>"
+  "    <limit lower='-2.147' upper='1.047' effort='50' velocity='1.5'/></joint>"
+  "  <joint name='right_e0' type='revolute'><parent link='right_lower_shoulder'/><child link='right_upper_elbow'/>"
+  "    <limit lower='-3.0541' upper='3.0541' effort='50' velocity='1.5'/></joint>"
+  "  <joint name='right_e1' type='revolute'><parent link='right_upper_elbow'/><child link='right_lower_elbow'/>"
+  "    <limit lower='-0.05' upper='2.618' effort='50' velocity='1.5'/></joint>"
+  "  <joint name='right_w0' type='revolute'><parent link='right_lower_elbow'/><child link='right_upper_forearm'/>"
+  "    <limit lower='-3.059' upper='3.059' effort='15' velocity='4'/></joint>"
+  "  <joint name='right_w1' type='revolute'><parent link='right_upper_forearm'/><child link='right_lower_forearm'/>"
+  "    <limit lower='-1.5707' upper='2.094' effort='15' velocity='4'/></joint>"
+  "  <joint name='right_w2' type='revolute'><parent link='right_lower_forearm'/><child link='right_wrist'/>"
+  "    <limit lower='-3.059' upper='3.059' effort='15' velocity='4'/></joint>"
+  "  <joint name='right_hand' type='fixed'><parent link='right_wrist'/><child link='right_hand'/></joint>"
+  "  <joint name='right_gripper_base' type='fixed'><parent link='right_hand'/><child link='right_gripper'/></joint>"
+  "</robot>";
+
+const char* BAXTER_JOINT_NAMES[] = {"right_s0", "right_s1", "right_e0", "right_e1", "right_w0", "right_w1", "right_w2"};
+
+
+/** An Inverse Kinematics solver that never finds a solution (the collision benchmark does not solve IK). */
+class NoIKSolver : public IKSolver
+{
+  public:
+
+    NoIKSolver() : IKSolver(7) { }
+
+    bool solve(const geometry_msgs::PoseStamped& pose, const double* seed, int attempts, double timeout,
+      double* joint_positions)
+    {
+      return false;
+    }
+};
+
+
+urdf::Model createArmModel()
+{
+  urdf::Model urdf;
+  urdf.initString(BAXTER_ARM_URDF);
+  return urdf;
+}
+
+
+std::vector<std::string> createJointNames()
+{
+  return std::vector<std::string>(BAXTER_JOINT_NAMES, BAXTER_JOINT_NAMES + 7);
+}
+
+
+/** Create a tabletop scene: half of the points on the table, half of them in the region above it (the objects). */
+pcl::PointCloud<pcl::PointXYZ>::Ptr createCloud(int num_points)
+{
+  std::mt19937 generator(SEED);
+  std::uniform_real_distribution<float> table_x(0.4f, 1.2f), table_y(-0.4f, 0.4f);
+  std::uniform_real_distribution<float> objects_x(0.6f, 1.0f), objects_y(-0.26f, 0.14f), objects_z(-0.2f, 0.1f);
+
+  pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>);
+  cloud->points.resize(num_points);
+  for (int i = 0; i < num_points; i++)
+  {
+    pcl::PointXYZ& p = cloud->points[i];
+    if (i % 2 == 0)
+    {
+      p.x = table_x(generator);
+      p.y = table_y(generator);
+      p.z = -0.2f;
+    }
+    else
+    {
+      p.x = objects_x(generator);
+      p.y = objects_y(generator);
+      p.z = objects_z(generator);
+    }
+  }
+  cloud->width = num_points;
+  cloud->height = 1;
+  return cloud;
+}
+
+
+/** Create random grasps in the workspace of select_grasps.launch. */
+agile_grasp::Grasps createGrasps(int num_grasps)
+{
+  std::mt19937 generator(SEED);
+  std::uniform_real_distribution<double> x(0.6, 1.0), y(-0.26, 0.14), z(-0.2, 0.1), angle(-M_PI, M_PI);
+  std::normal_distribution<double> normal;
+
+  agile_grasp::Grasps msg;
+  msg.grasps.resize(num_grasps);
+  for (int i = 0; i < num_grasps; i++)
+  {
+    Eigen::Vector3d center(x(generator), y(generator), z(generator));
+    Eigen::Vector3d axis = Eigen::Vector3d(normal(generator), normal(generator), normal(generator)).normalized();
+    Eigen::Vector3d approach = Eigen::AngleAxisd(angle(generator), axis) * axis.unitOrthogonal();
+    tf::vectorEigenToMsg(center, msg.grasps[i].center);
+    tf::vectorEigenToMsg(center, msg.grasps[i].surface_center);
+    tf::vectorEigenToMsg(axis, msg.grasps[i].axis);
+    tf::vectorEigenToMsg(approach, msg.grasps[i].approach);
+    msg.grasps[i].width.data = 0.02 + 0.05 * (i % 11) / 10.0;
+  }
+  return msg;
+}
+
+
+/** Create random joint positions within the joint limits of the Baxter right arm. */
+std::vector<double> createJointPositions(const IKFastSolver& solver, int num_configurations)
+{
+  std::mt19937 generator(SEED);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  const Eigen::Matrix<double, 2, Eigen::Dynamic>& limits = solver.getJointLimits();
+
+  std::vector<double> joint_positions(num_configurations * limits.cols());
+  for (int i = 0; i < joint_positions.size(); i++)
+  {
+    const int j = i % limits.cols();
+    joint_positions[i] = limits(0, j) + (limits(1, j) - limits(0, j)) * uniform(generator);
+  }
+  return joint_positions;
+}
+
+
+static void BM_CollisionCheck(benchmark::State& state)
+{
+  pcl::PointCloud<pcl::PointXYZ>::Ptr cloud = createCloud(state.range(0));
+  SceneIndex scene_index(0.03);
+  scene_index.setPointCloud(*cloud);
+
+  Reaching::Parameters params;
+  params.axis_order_.resize(3);
+  params.axis_order_[0] = 2;
+  params.axis_order_[1] = 0;
+  params.axis_order_[2] = 1;
+  params.hand_offset_ = 0.095;
+  params.max_colliding_points_ = 1;
+  params.max_joint_step_ = 0.5;
+  Reaching reaching(params, new NoIKSolver);
+  reaching.setSceneIndex(&scene_index);
+
+  agile_grasp::Grasps grasps = createGrasps(NUM_CANDIDATES);
+  std::vector<Eigen::Vector3d> positions(NUM_CANDIDATES), approaches(NUM_CANDIDATES);
+  for (int i = 0; i < NUM_CANDIDATES; i++)
+  {
+    tf::vectorMsgToEigen(grasps.grasps[i].center, positions[i]);
+    tf::vectorMsgToEigen(grasps.grasps[i].approach, approaches[i]);
+  }
+
+  int i = 0;
+  int num_free = 0;
+  for (auto _ : state)
+  {
+    num_free += reaching.isCollisionFree(positions[i], approaches[i]);
+    i = (i + 1) % NUM_CANDIDATES;
+  }
+  benchmark::DoNotOptimize(num_free);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CollisionCheck)->Arg(10000)->Arg(100000)->Arg(1000000);
+
+
+static void BM_GraspPoses(benchmark::State& state)
+{
+  std::vector<int> axis_order(3);
+  axis_order[0] = 2;
+  axis_order[1] = 0;
+  axis_order[2] = 1;
+  GraspPoseKernel kernel(axis_order, 0.095);
+
+  agile_grasp::Grasps msg = createGrasps(state.range(0));
+  const int num_additional_grasps = 4;
+  ArenaVector<double> theta(1 + num_additional_grasps);
+  for (int j = 0; j < theta.size(); j++)
+    theta[j] = -15.0 + 30.0 * j / num_additional_grasps;
+
+  Arena arena;
+  for (auto _ : state)
+  {
+    arena.reset();
+    GraspArrays arrays(msg, arena);
+    CandidatePoses poses(msg.grasps.size(), theta.size(), arena);
+    kernel.calculatePoses(arrays, theta, poses, arena);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * msg.grasps.size() * theta.size());
+}
+BENCHMARK(BM_GraspPoses)->Arg(100)->Arg(1000)->Arg(10000);
+
+
+static void BM_ScoreGrasps(benchmark::State& state)
+{
+  // the scoring logs its selection strategy on each call, which is not part of the measurement
+  AsyncLogger::getInstance().setLevel(AsyncLogger::SCORING, AsyncLogger::LEVEL_WARN);
+
+  urdf::Model urdf = createArmModel();
+  std::vector<std::string> joint_names = createJointNames();
+  Scoring scoring(urdf, joint_names, 0.02, 0.07, 50, Scoring::SCORING_MODE_WORKSPACE);
+
+  IKFastSolver solver(urdf, "base", "right_arm_mount", "right_gripper");
+  const int num_grasps = state.range(0);
+  std::vector<double> joint_positions = createJointPositions(solver, num_grasps);
+  agile_grasp::Grasps grasps = createGrasps(num_grasps);
+  CandidateStore store(7);
+  store.reserve(num_grasps);
+  for (int i = 0; i < num_grasps; i++)
+  {
+    Eigen::Vector3d position, approach;
+    tf::vectorMsgToEigen(grasps.grasps[i].center, position);
+    tf::vectorMsgToEigen(grasps.grasps[i].approach, approach);
+    store.add(i, position, Eigen::Quaterniond::Identity(), approach, grasps.grasps[i].width.data,
+      &joint_positions[7 * i]);
+  }
+
+  geometry_msgs::Pose hand_pose;
+  hand_pose.position.x = 0.7;
+  hand_pose.orientation.w = 1.0;
+
+  Arena arena;
+  for (auto _ : state)
+  {
+    arena.reset();
+    Scoring::Ranking selected = scoring.scoreGrasps(store, hand_pose, arena);
+    benchmark::DoNotOptimize(selected.indices_.data());
+  }
+  state.SetItemsProcessed(state.iterations() * num_grasps);
+}
+BENCHMARK(BM_ScoreGrasps)->Arg(100)->Arg(1000)->Arg(10000)->Arg(100000);
+
+
+static void BM_IKFastComputeFk(benchmark::State& state)
+{
+  IKFastSolver solver(createArmModel(), "base", "right_arm_mount", "right_gripper");
+  std::vector<double> joint_positions = createJointPositions(solver, NUM_CANDIDATES);
+
+  double translation[3], rotation[9];
+  int i = 0;
+  for (auto _ : state)
+  {
+    baxter_ikfast::ComputeFk(&joint_positions[7 * i], translation, rotation);
+    benchmark::DoNotOptimize(translation);
+    i = (i + 1) % NUM_CANDIDATES;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IKFastComputeFk);
+
+
+static void BM_IKFastComputeIk(benchmark::State& state)
+{
+  IKFastSolver solver(createArmModel(), "base", "right_arm_mount", "right_gripper");
+  std::vector<double> joint_positions = createJointPositions(solver, NUM_CANDIDATES);
+  std::vector<double> translations(3 * NUM_CANDIDATES), rotations(9 * NUM_CANDIDATES);
+  for (int i = 0; i < NUM_CANDIDATES; i++)
+    baxter_ikfast::ComputeFk(&joint_positions[7 * i], &translations[3 * i], &rotations[9 * i]);
+
+  // one ComputeIk call for the free joint value of the configuration (a single sample of IKFastSolver)
+  const int free_joint = baxter_ikfast::GetFreeParameters()[0];
+  int i = 0;
+  int num_solutions = 0;
+  for (auto _ : state)
+  {
+    ikfast::IkSolutionList<double> solutions;
+    baxter_ikfast::ComputeIk(&translations[3 * i], &rotations[9 * i], &joint_positions[7 * i + free_joint],
+      solutions);
+    num_solutions += solutions.GetNumSolutions();
+    i = (i + 1) % NUM_CANDIDATES;
+  }
+  benchmark::DoNotOptimize(num_solutions);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IKFastComputeIk);
+
+
+static void BM_IKFastSolver(benchmark::State& state)
+{
+  IKFastSolver solver(createArmModel(), "base", "right_arm_mount", "right_gripper");
+  std::vector<double> joint_positions = createJointPositions(solver, NUM_CANDIDATES);
+  std::vector<geometry_msgs::PoseStamped> poses(NUM_CANDIDATES);
+  for (int i = 0; i < NUM_CANDIDATES; i++)
+    tf::poseEigenToMsg(solver.calculatePose(&joint_positions[7 * i]), poses[i].pose);
+
+  // the complete in-process solver, sampling the free joint over its whole range
+  double solution[7];
+  int i = 0;
+  int num_solved = 0;
+  for (auto _ : state)
+  {
+    num_solved += solver.solve(poses[i], NULL, 1, 0.0, solution);
+    i = (i + 1) % NUM_CANDIDATES;
+  }
+  benchmark::DoNotOptimize(num_solved);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IKFastSolver)->Unit(benchmark::kMicrosecond);
+
+
+static void BM_VoxelGrid(benchmark::State& state)
+{
+  pcl::PointCloud<pcl::PointXYZ>::Ptr cloud = createCloud(state.range(0));
+  pcl::PointCloud<pcl::PointXYZ> filtered;
+
+  // the same filter as SelectionPipeline::setPointCloud
+  for (auto _ : state)
+  {
+    pcl::VoxelGrid<pcl::PointXYZ> vox;
+    vox.setInputCloud(cloud);
+    vox.setLeafSize(0.006f, 0.006f, 0.006f);
+    vox.filter(filtered);
+    benchmark::DoNotOptimize(filtered.points.data());
+  }
+  state.SetItemsProcessed(state.iterations() * cloud->size());
+}
+BENCHMARK(BM_VoxelGrid)->Arg(10000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+
+BENCHMARK_MAIN();
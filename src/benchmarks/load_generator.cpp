@@ -0,0 +1,327 @@
+#include <ros/ros.h>
+#include <urdf/model.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <agile_grasp/Grasps.h>
+
+#include <grasp_selection/async_logger.h>
+#include <grasp_selection/pipeline_stats.h>
+#include <grasp_selection/scene_replay.h>
+
+#include <grasp_selection/SelectGrasps.h>
+
+
+// Load test for the selection node: replays the scenes recorded in a bag file into the grasps, point cloud and joint
+// states topics of a running selection node, and calls its select_grasps service from several concurrent clients at a
+// target rate, as several robots sharing one node would. Every report period, one CSV line is written with the
+// throughput, the latency percentiles and the error rates of the requests that completed in that period, followed by
+// a line with the totals. The node answers a request without reachable grasps with a failed call, so the errors
+// include the empty selections as well as the timeouts and the failed connections.
+//
+// The requests are sent on a fixed schedule (open loop): client c sends its k-th request at (k * num_clients + c) /
+// rate seconds after the start, and its latency is measured from that time. A request that has to wait for the
+// previous response of its client therefore counts the waiting as latency, instead of hiding the backlog by sending
+// fewer requests. With a rate of 0, each client sends its next request as soon as it receives a response (closed
+// loop).
+//
+// Each scene is published with new time stamps, so the node evaluates it again (the reachability test and the
+// scoring), and the scenes are cycled every scene period. The hand pose of a request is the one at the joint state of
+// the current scene (see SceneReplay). Run the node with the OpenRAVE or MoveIt backend against ik_replay_node to
+// test it without the robot and the IK services:
+//   roslaunch grasp_selection ik_replay.launch
+//   roslaunch grasp_selection select_grasps.launch
+//   load_generator scenes.bag baxter.urdf 4 20 60 5 1 load.csv
+//
+// Usage: load_generator bag urdf [num_clients] [rate] [duration] [scene_period] [report_period] [csv_file]
+//   [service] [grasps_topic] [cloud_topic] [joint_states_topic]
+
+
+/** The outcomes of a request. */
+enum Outcome
+{
+  OUTCOME_SELECTED, ///< grasps were selected
+  OUTCOME_FAILED, ///< the service failed, e.g., because no grasp was reachable, or the node could not be reached
+  NUM_OUTCOMES
+};
+
+
+/** The requests that completed in a period. */
+struct Period
+{
+  LatencyHistogram latencies_; ///< the latencies of the successful requests, from their scheduled time
+  LatencyHistogram failed_latencies_; ///< the latencies of the failed requests, e.g., until a timeout
+  uint64_t counts_[NUM_OUTCOMES]; ///< the number of requests with each outcome
+
+  Period()
+  {
+    std::fill(counts_, counts_ + NUM_OUTCOMES, 0);
+  }
+
+  uint64_t getNumRequests() const { return counts_[OUTCOME_SELECTED] + counts_[OUTCOME_FAILED]; }
+};
+
+
+/** Publishes the recorded scenes with new time stamps, and cycles through them. */
+class ScenePublisher
+{
+  public:
+
+    ScenePublisher(ros::NodeHandle& node, const std::vector<SceneReplay::Scene>& scenes,
+      const std::string& grasps_topic, const std::string& cloud_topic, const std::string& joint_states_topic)
+      : scenes_(scenes), current_(0)
+    {
+      grasps_pub_ = node.advertise<agile_grasp::Grasps>(grasps_topic, 1);
+      cloud_pub_ = node.advertise<sensor_msgs::PointCloud2>(cloud_topic, 1);
+      joint_states_pub_ = node.advertise<sensor_msgs::JointState>(joint_states_topic, 1);
+    }
+
+    /**
+     * \brief Publish a scene. The point cloud is published before the grasps, so that a request for the new grasps
+     * uses the new point cloud.
+     * \param index the index of the scene
+    */
+    void publish(int index)
+    {
+      const SceneReplay::Scene& scene = scenes_[index];
+      const ros::Time stamp = ros::Time::now();
+
+      sensor_msgs::JointState joint_state = *scene.joint_state_;
+      joint_state.header.stamp = stamp;
+      joint_states_pub_.publish(joint_state);
+
+      // the node ignores messages with the time stamp of its current scene
+      sensor_msgs::PointCloud2 cloud = *scene.cloud_;
+      cloud.header.stamp = stamp;
+      cloud_pub_.publish(cloud);
+
+      agile_grasp::Grasps grasps = *scene.grasps_;
+      grasps.header.stamp = stamp;
+      grasps_pub_.publish(grasps);
+
+      current_ = index;
+    }
+
+    /**
+     * \brief Return whether the selection node subscribes to all three topics.
+    */
+    bool isConnected() const
+    {
+      return grasps_pub_.getNumSubscribers() > 0 && cloud_pub_.getNumSubscribers() > 0
+        && joint_states_pub_.getNumSubscribers() > 0;
+    }
+
+    int getCurrent() const { return current_; }
+
+
+  private:
+
+    const std::vector<SceneReplay::Scene>& scenes_; ///< the recorded scenes
+    std::atomic<int> current_; ///< the index of the scene published last
+    ros::Publisher grasps_pub_; ///< the publisher of the grasps
+    ros::Publisher cloud_pub_; ///< the publisher of the point clouds
+    ros::Publisher joint_states_pub_; ///< the publisher of the joint states
+};
+
+
+/** Write the CSV line of a period. */
+void printPeriod(FILE* file, const char* label, const Period& period, double seconds)
+{
+  const uint64_t num_requests = period.getNumRequests();
+  const double num = std::max(num_requests, (uint64_t) 1);
+  fprintf(file, "%s,%llu,%.2f,%.3f,%.3f,%.3f,%.3f,%.3f,%.4f,%.3f,%.3f\n", label, 
+    (unsigned long long) num_requests, num_requests / seconds, 1e3 * period.latencies_.getMean(), 
+    1e3 * period.latencies_.calculatePercentile(50.0), 1e3 * period.latencies_.calculatePercentile(95.0), 
+    1e3 * period.latencies_.calculatePercentile(99.0), 1e3 * period.latencies_.getMax(), 
+    period.counts_[OUTCOME_FAILED] / num, 
+    1e3 * period.failed_latencies_.getMean(), 1e3 * period.failed_latencies_.getMax());
+  fflush(file);
+}
+
+
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "load_generator");
+
+  if (argc < 3)
+  {
+    std::cout << "Usage: load_generator bag urdf [num_clients] [rate] [duration] [scene_period] [report_period] "
+      << "[csv_file] [service] [grasps_topic] [cloud_topic] [joint_states_topic]\n";
+    return 2;
+  }
+
+  const std::string bag_filename = argv[1];
+  const std::string urdf_filename = argv[2];
+  const int num_clients = std::max((argc > 3) ? atoi(argv[3]) : 4, 1);
+  const double rate = std::max((argc > 4) ? atof(argv[4]) : 20.0, 0.0);
+  const double duration = (argc > 5) ? atof(argv[5]) : 60.0;
+  const double scene_period = (argc > 6) ? atof(argv[6]) : 5.0;
+  const double report_period = std::max((argc > 7) ? atof(argv[7]) : 1.0, 0.1);
+  const std::string csv_filename = (argc > 8) ? argv[8] : "";
+  const std::string service_name = (argc > 9) ? argv[9] : "/select_grasps/select_grasps";
+  const std::string grasps_topic = (argc > 10) ? argv[10] : "/find_grasps/handle_grasps";
+  const std::string cloud_topic = (argc > 11) ? argv[11] : "/register_clouds/point_cloud";
+  const std::string joint_states_topic = (argc > 12) ? argv[12] : "/robot/joint_states";
+
+  // the offline pipeline of the scene replay is not used, only its scenes and hand poses
+  for (int i = 0; i < AsyncLogger::NUM_CATEGORIES; i++)
+    AsyncLogger::getInstance().setLevel(static_cast<AsyncLogger::Category>(i), AsyncLogger::LEVEL_WARN);
+
+  urdf::Model urdf;
+  if (!urdf.initFile(urdf_filename))
+  {
+    ROS_ERROR("Failed to parse urdf file");
+    return 2;
+  }
+
+  SceneReplay replay;
+  if (!replay.load(bag_filename, urdf, grasps_topic, cloud_topic, joint_states_topic))
+    return 2;
+  const std::vector<SceneReplay::Scene>& scenes = replay.getScenes();
+
+  ros::NodeHandle node;
+  ScenePublisher publisher(node, scenes, grasps_topic, cloud_topic, joint_states_topic);
+
+  // wait until the node subscribes to the topics and answers a request for the first scene
+  ROS_INFO("Waiting for %s ...", service_name.c_str());
+  if (!ros::service::waitForService(service_name, ros::Duration(60.0)))
+  {
+    ROS_ERROR("The %s service is not available", service_name.c_str());
+    return 1;
+  }
+  ros::ServiceClient warm_up_client = node.serviceClient<grasp_selection::SelectGrasps>(service_name);
+  bool is_ready = false;
+  for (int i = 0; i < 60 && !is_ready && ros::ok(); i++)
+  {
+    if (publisher.isConnected())
+    {
+      publisher.publish(0);
+      ros::Duration(0.5).sleep();
+      grasp_selection::SelectGrasps srv;
+      srv.request.hand_pose = scenes[0].hand_pose_;
+      is_ready = warm_up_client.call(srv);
+    }
+    ros::Duration(0.5).sleep();
+  }
+  if (!is_ready)
+  {
+    ROS_ERROR("The selection node did not answer a request for the first scene");
+    return 1;
+  }
+
+  FILE* csv_file = csv_filename.empty() ? stdout : fopen(csv_filename.c_str(), "w");
+  if (csv_file == NULL)
+  {
+    ROS_ERROR("Could not write %s", csv_filename.c_str());
+    return 2;
+  }
+  fprintf(stdout, "%i scenes, %i clients, %.1f requests/s%s, %.0f s\n\n", (int) scenes.size(), num_clients, rate,
+    (rate > 0.0) ? "" : " (closed loop)", duration);
+  fprintf(csv_file, "time_s,requests,throughput_hz,mean_ms,p50_ms,p95_ms,p99_ms,max_ms,error_rate,"
+    "error_mean_ms,error_max_ms\n");
+
+  // the clients record the completed requests in the current period, which the main thread swaps out
+  typedef std::chrono::steady_clock Clock;
+  std::mutex mutex;
+  Period period, total;
+  std::atomic<bool> is_running(true);
+  const Clock::time_point start = Clock::now();
+  const Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(
+    std::chrono::duration<double>(duration));
+
+  std::vector<std::thread> clients;
+  for (int c = 0; c < num_clients; c++)
+  {
+    clients.push_back(std::thread([&, c]()
+    {
+      // each client has its own connection, as each robot would
+      ros::NodeHandle client_node;
+      ros::ServiceClient client = client_node.serviceClient<grasp_selection::SelectGrasps>(service_name);
+      for (uint64_t k = 0; is_running; k++)
+      {
+        Clock::time_point scheduled = Clock::now();
+        if (rate > 0.0)
+        {
+          scheduled = start + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>((k * num_clients + c) / rate));
+          if (scheduled >= end)
+            break;
+          std::this_thread::sleep_until(scheduled);
+        }
+
+        grasp_selection::SelectGrasps srv;
+        srv.request.hand_pose = scenes[publisher.getCurrent()].hand_pose_;
+        const Outcome outcome = client.call(srv) ? OUTCOME_SELECTED : OUTCOME_FAILED;
+        const uint64_t latency = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now()
+          - scheduled).count();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        period.counts_[outcome]++;
+        if (outcome != OUTCOME_FAILED)
+          period.latencies_.record(latency);
+        else
+          period.failed_latencies_.record(latency);
+      }
+    }));
+  }
+
+  // publish the scenes and report each period until the end
+  int scene = 0;
+  Clock::time_point scene_start = start;
+  Clock::time_point period_start = start;
+  while (ros::ok() && Clock::now() < end)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    const Clock::time_point now = Clock::now();
+
+    if (scene_period > 0.0 && std::chrono::duration<double>(now - scene_start).count() >= scene_period)
+    {
+      scene = (scene + 1) % scenes.size();
+      publisher.publish(scene);
+      scene_start = now;
+    }
+
+    const double seconds = std::chrono::duration<double>(now - period_start).count();
+    if (seconds >= report_period)
+    {
+      Period completed;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::swap(completed, period);
+      }
+
+      char label[32];
+      snprintf(label, sizeof(label), "%.1f", std::chrono::duration<double>(now - start).count());
+      printPeriod(csv_file, label, completed, seconds);
+      total.latencies_.add(completed.latencies_);
+      total.failed_latencies_.add(completed.failed_latencies_);
+      for (int o = 0; o < NUM_OUTCOMES; o++)
+        total.counts_[o] += completed.counts_[o];
+      period_start = now;
+    }
+  }
+
+  // the requests that are still outstanding complete after the end and count towards the total
+  is_running = false;
+  for (int c = 0; c < num_clients; c++)
+    clients[c].join();
+  total.latencies_.add(period.latencies_);
+  total.failed_latencies_.add(period.failed_latencies_);
+  for (int o = 0; o < NUM_OUTCOMES; o++)
+    total.counts_[o] += period.counts_[o];
+  printPeriod(csv_file, "total", total, std::chrono::duration<double>(Clock::now() - start).count());
+
+  if (csv_file != stdout)
+    fclose(csv_file);
+  return 0;
+}
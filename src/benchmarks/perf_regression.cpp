@@ -0,0 +1,340 @@
+#include <ros/ros.h>
+#include <urdf/model.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <grasp_selection/async_logger.h>
+#include <grasp_selection/memory_usage.h>
+#include <grasp_selection/pipeline_stats.h>
+#include <grasp_selection/scene_replay.h>
+
+#include <grasp_selection/GraspList.h>
+
+
+// Performance regression check for the grasp selection: replays the scenes recorded in a bag file (see SceneReplay)
+// and compares the wall time, the number of IK calls, the number of points tested by the collision checks, and the
+// number of heap allocations of each scene against a baseline file. The check fails if a value exceeds its baseline by
+// more than the tolerance of the metric, or if a scene selects different grasps than when the baseline was recorded.
+// It also fails if the evaluation of a scene (see SelectionPipeline::getNumEvaluationAllocations) allocates from the
+// heap once the pipeline has warmed up, independent of the baseline.
+//
+// Usage: perf_regression bag urdf baseline [num_repetitions] [--update]
+//
+// With --update, the measured values are written to the baseline file instead (keeping its tolerances). The wall
+// times depend on the machine, so the baseline has to be recorded on the machine that runs the check, or their
+// tolerance set to a negative value, which skips the metric. The counts and the selected grasps do not depend on the
+// machine; the CI test replays scenes that generate_scenes creates from a fixed seed against such a baseline
+// (src/benchmarks/perf_baseline_generated.txt). The exit code is 0 if there is no regression, 1 if there is one or a
+// scene has no baseline, and 2 if the inputs could not be read.
+
+
+/** The metrics that are compared against the baseline. */
+enum Metric
+{
+  TIME, ///< the wall time of the selection in milliseconds
+  IK_CALLS, ///< the number of IK calls
+  COLLISION_POINTS, ///< the number of points tested by the collision checks of the robot hand poses
+  ALLOCATIONS, ///< the number of heap allocations
+  NUM_METRICS
+};
+
+const char* METRIC_NAMES[NUM_METRICS] = {"time_ms", "ik_calls", "collision_points", "allocations"};
+
+/** The default tolerances (fractions of the baseline value, negative: not checked); the counts are deterministic for a
+ * given build. */
+const double DEFAULT_TOLERANCES[NUM_METRICS] = {0.25, 0.0, 0.0, 0.05};
+
+
+/** The measured or the baseline values of a scene. */
+struct SceneMetrics
+{
+  double values_[NUM_METRICS];
+  uint64_t digest_;
+  uint64_t evaluation_allocations_; ///< the most heap allocations of an evaluation after the warm-up (not stored)
+};
+
+
+/** A baseline file: the tolerance of each metric, and the values of each scene. */
+struct Baseline
+{
+  double tolerances_[NUM_METRICS];
+  std::map<int, SceneMetrics> scenes_;
+};
+
+
+/** Find a metric by its name. */
+int findMetric(const std::string& name)
+{
+  for (int i = 0; i < NUM_METRICS; i++)
+  {
+    if (name == METRIC_NAMES[i])
+      return i;
+  }
+  return -1;
+}
+
+
+/** Read a baseline file. A missing file is an empty baseline with the default tolerances. */
+bool readBaseline(const std::string& filename, Baseline& baseline)
+{
+  std::copy(DEFAULT_TOLERANCES, DEFAULT_TOLERANCES + NUM_METRICS, baseline.tolerances_);
+  baseline.scenes_.clear();
+
+  std::ifstream file(filename.c_str());
+  if (!file)
+    return true;
+
+  std::string line;
+  int line_number = 0;
+  while (std::getline(file, line))
+  {
+    line_number++;
+    std::istringstream stream(line);
+    std::string keyword;
+    if (!(stream >> keyword) || keyword[0] == '#')
+      continue;
+
+    if (keyword == "tolerance")
+    {
+      std::string name;
+      double tolerance;
+      int metric = -1;
+      if (stream >> name >> tolerance)
+        metric = findMetric(name);
+      if (metric < 0)
+      {
+        ROS_ERROR("%s:%i: invalid tolerance", filename.c_str(), line_number);
+        return false;
+      }
+      baseline.tolerances_[metric] = tolerance;
+    }
+    else if (keyword == "scene")
+    {
+      int index;
+      SceneMetrics metrics;
+      std::string name, digest;
+      bool is_valid = static_cast<bool>(stream >> index);
+      for (int i = 0; i < NUM_METRICS && is_valid; i++)
+        is_valid = (stream >> name >> metrics.values_[i]) && name == METRIC_NAMES[i];
+      is_valid = is_valid && (stream >> name >> digest) && name == "digest";
+      if (!is_valid)
+      {
+        ROS_ERROR("%s:%i: invalid scene", filename.c_str(), line_number);
+        return false;
+      }
+      metrics.digest_ = strtoull(digest.c_str(), NULL, 16);
+      baseline.scenes_[index] = metrics;
+    }
+    else
+    {
+      ROS_ERROR("%s:%i: unknown keyword %s", filename.c_str(), line_number, keyword.c_str());
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+/** Write a baseline file. */
+bool writeBaseline(const std::string& filename, const std::string& bag_filename, const Baseline& baseline)
+{
+  FILE* file = fopen(filename.c_str(), "w");
+  if (file == NULL)
+  {
+    ROS_ERROR("Could not write baseline file %s", filename.c_str());
+    return false;
+  }
+
+  fprintf(file, "# Baseline of perf_regression, recorded from %s.\n", bag_filename.c_str());
+  fprintf(file, "# A value may exceed its baseline by the tolerance (a fraction of the baseline) before the check "
+    "fails.\n");
+  for (int i = 0; i < NUM_METRICS; i++)
+    fprintf(file, "tolerance %s %g\n", METRIC_NAMES[i], baseline.tolerances_[i]);
+
+  for (std::map<int, SceneMetrics>::const_iterator it = baseline.scenes_.begin(); it != baseline.scenes_.end(); it++)
+  {
+    fprintf(file, "scene %i", it->first);
+    for (int i = 0; i < NUM_METRICS; i++)
+      fprintf(file, " %s %.*f", METRIC_NAMES[i], (i == TIME) ? 3 : 0, it->second.values_[i]);
+    fprintf(file, " digest %016llx\n", (unsigned long long) it->second.digest_);
+  }
+
+  bool is_written = (ferror(file) == 0);
+  fclose(file);
+  return is_written;
+}
+
+
+/** Run a scene repeatedly, and return the median of each metric. */
+SceneMetrics measureScene(SceneReplay& replay, int index, int num_repetitions)
+{
+  PipelineStats& stats = replay.getPipeline().getStats();
+  std::vector<std::vector<double> > values(NUM_METRICS, std::vector<double>(num_repetitions));
+  SceneMetrics metrics;
+
+  // the first run warms up the caches and the buffers of the pipeline, and is not measured
+  grasp_selection::GraspList msg;
+  replay.selectGrasps(index, msg);
+  metrics.digest_ = SceneReplay::calculateDigest(msg);
+  metrics.evaluation_allocations_ = 0;
+
+  for (int r = 0; r < num_repetitions; r++)
+  {
+    grasp_selection::GraspList msg;
+    const uint64_t ik_calls = stats.getHistogram(PipelineStats::INVERSE_KINEMATICS).getCount();
+    const uint64_t collision_points = stats.getNumCollisionPoints();
+    const uint64_t allocations = AllocationCounter::getNumAllocations();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    replay.selectGrasps(index, msg);
+
+    values[TIME][r] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    values[ALLOCATIONS][r] = AllocationCounter::getNumAllocations() - allocations;
+    values[IK_CALLS][r] = stats.getHistogram(PipelineStats::INVERSE_KINEMATICS).getCount() - ik_calls;
+    values[COLLISION_POINTS][r] = stats.getNumCollisionPoints() - collision_points;
+    metrics.evaluation_allocations_ = std::max(metrics.evaluation_allocations_, 
+      replay.getPipeline().getNumEvaluationAllocations());
+  }
+
+  for (int i = 0; i < NUM_METRICS; i++)
+  {
+    std::nth_element(values[i].begin(), values[i].begin() + num_repetitions / 2, values[i].end());
+    metrics.values_[i] = values[i][num_repetitions / 2];
+  }
+  return metrics;
+}
+
+
+int main(int argc, char** argv)
+{
+  std::vector<std::string> args;
+  bool is_updating = false;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--update") == 0)
+      is_updating = true;
+    else
+      args.push_back(argv[i]);
+  }
+
+  if (args.size() < 3)
+  {
+    std::cout << "Usage: perf_regression bag urdf baseline [num_repetitions] [--update]\n";
+    return 2;
+  }
+
+  const std::string bag_filename = args[0];
+  const std::string urdf_filename = args[1];
+  const std::string baseline_filename = args[2];
+  const int num_repetitions = std::max(1, (args.size() > 3) ? atoi(args[3].c_str()) : 5);
+
+  // the response messages are stamped with the current time
+  ros::Time::init();
+
+  // the progress messages are not part of the measurement
+  for (int i = 0; i < AsyncLogger::NUM_CATEGORIES; i++)
+    AsyncLogger::getInstance().setLevel(static_cast<AsyncLogger::Category>(i), AsyncLogger::LEVEL_WARN);
+
+  urdf::Model urdf;
+  if (!urdf.initFile(urdf_filename))
+  {
+    ROS_ERROR("Failed to parse urdf file");
+    return 2;
+  }
+
+  Baseline baseline;
+  if (!readBaseline(baseline_filename, baseline))
+    return 2;
+
+  SceneReplay replay;
+  if (!replay.load(bag_filename, urdf, "/find_grasps/handle_grasps", "/register_clouds/point_cloud",
+    "/robot/joint_states"))
+    return 2;
+
+  const int num_scenes = replay.getScenes().size();
+  std::vector<SceneMetrics> measured(num_scenes);
+  for (int i = 0; i < num_scenes; i++)
+    measured[i] = measureScene(replay, i, num_repetitions);
+
+  if (is_updating)
+  {
+    baseline.scenes_.clear();
+    for (int i = 0; i < num_scenes; i++)
+      baseline.scenes_[i] = measured[i];
+    if (!writeBaseline(baseline_filename, bag_filename, baseline))
+      return 2;
+    printf("Wrote the baseline of %i scenes to %s\n", num_scenes, baseline_filename.c_str());
+    return 0;
+  }
+
+  // compare each scene against its baseline
+  int num_regressions = 0;
+  int num_missing = 0;
+  printf("%-6s %-18s %14s %14s %9s  %s\n", "scene", "metric", "baseline", "measured", "change", "result");
+  for (int i = 0; i < num_scenes; i++)
+  {
+    // the temporary data of the evaluation comes from the arena of the pipeline, whatever the baseline says
+    if (measured[i].evaluation_allocations_ > 0)
+    {
+      printf("%-6i evaluation made %llu heap allocations after the warm-up, expected none\n", i,
+        (unsigned long long) measured[i].evaluation_allocations_);
+      num_regressions++;
+    }
+
+    std::map<int, SceneMetrics>::const_iterator it = baseline.scenes_.find(i);
+    if (it == baseline.scenes_.end())
+    {
+      printf("%-6i no baseline\n", i);
+      num_missing++;
+      continue;
+    }
+
+    const SceneMetrics& expected = it->second;
+    for (int m = 0; m < NUM_METRICS; m++)
+    {
+      const double limit = expected.values_[m] * (1.0 + baseline.tolerances_[m]);
+      const double lower = expected.values_[m] * (1.0 - baseline.tolerances_[m]);
+      const double change = (expected.values_[m] > 0) ? 100.0 * (measured[i].values_[m] / expected.values_[m] - 1.0)
+        : 0.0;
+      const char* result = "ok";
+      if (baseline.tolerances_[m] < 0.0)
+        result = "skipped";
+      else if (measured[i].values_[m] > limit)
+      {
+        result = "REGRESSION";
+        num_regressions++;
+      }
+      else if (measured[i].values_[m] < lower)
+        result = "improved";
+
+      printf("%-6i %-18s %14.3f %14.3f %8.1f%%  %s\n", i, METRIC_NAMES[m], expected.values_[m],
+        measured[i].values_[m], change, result);
+    }
+
+    if (measured[i].digest_ != expected.digest_)
+    {
+      printf("%-6i selected grasps differ from the baseline (digest %016llx, expected %016llx)\n", i,
+        (unsigned long long) measured[i].digest_, (unsigned long long) expected.digest_);
+      num_regressions++;
+    }
+  }
+
+  // a scene without a baseline is not checked, so the check cannot pass
+  if (num_missing > 0)
+    printf("\n%i of %i scenes have no baseline; record one with --update\n", num_missing, num_scenes);
+  printf("\n%i regressions\n", num_regressions);
+  return (num_regressions == 0 && num_missing == 0) ? 0 : 1;
+}
@@ -0,0 +1,208 @@
+#include <ros/ros.h>
+#include <urdf/model.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <grasp_selection/async_logger.h>
+#include <grasp_selection/memory_usage.h>
+#include <grasp_selection/pipeline_stats.h>
+#include <grasp_selection/profiling.h>
+#include <grasp_selection/scene_replay.h>
+
+#include <grasp_selection/GraspList.h>
+
+
+// Offline replay benchmark for the grasp selection: reads the grasps, point clouds and joint states recorded in a bag
+// file, runs the complete selection (the same SelectionPipeline that the selection node uses) on each recorded scene
+// with the in-process ikfast solver, and reports the throughput, the latencies of the pipeline stages, and whether all
+// repetitions of a scene select the same grasps. No ROS master, MoveIt or OpenRAVE is needed.
+//
+// Each grasps message in the bag forms a scene together with the latest point cloud and joint state recorded before
+// it (see SceneReplay). The parameters are the Baxter defaults from select_grasps.launch.
+//
+// Usage: replay_benchmark bag urdf [num_repetitions] [grasps_topic] [cloud_topic] [joint_states_topic]
+//   [--perf-counters]
+//
+// With --perf-counters, the hardware performance counters of each stage are reported as well (if the kernel grants
+// access to them).
+//
+// Record a bag on the robot with:
+//   rosbag record /find_grasps/handle_grasps /register_clouds/point_cloud /robot/joint_states
+
+
+/** Sum the recorded latencies of a range of stages (in seconds). */
+double sumStageTimes(const PipelineStats& stats, PipelineStats::Stage first, PipelineStats::Stage last)
+{
+  double sum = 0.0;
+  for (int s = first; s <= last; s++)
+  {
+    const LatencyHistogram& histogram = stats.getHistogram((PipelineStats::Stage) s);
+    sum += histogram.getMean() * histogram.getCount();
+  }
+  return sum;
+}
+
+
+int main(int argc, char** argv)
+{
+  std::vector<std::string> args;
+  bool uses_perf_counters = false;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--perf-counters") == 0)
+      uses_perf_counters = true;
+    else
+      args.push_back(argv[i]);
+  }
+
+  if (args.size() < 2)
+  {
+    std::cout << "Usage: replay_benchmark bag urdf [num_repetitions] [grasps_topic] [cloud_topic] "
+      << "[joint_states_topic] [--perf-counters]\n";
+    return 2;
+  }
+
+  std::string bag_filename = args[0];
+  std::string urdf_filename = args[1];
+  int num_repetitions = (args.size() > 2) ? atoi(args[2].c_str()) : 10;
+  std::string grasps_topic = (args.size() > 3) ? args[3] : "/find_grasps/handle_grasps";
+  std::string cloud_topic = (args.size() > 4) ? args[4] : "/register_clouds/point_cloud";
+  std::string joint_states_topic = (args.size() > 5) ? args[5] : "/robot/joint_states";
+
+  // the response messages are stamped with the current time
+  ros::Time::init();
+
+  // only warnings and errors are logged, so that the progress messages do not run into the result tables
+  for (int i = 0; i < AsyncLogger::NUM_CATEGORIES; i++)
+    AsyncLogger::getInstance().setLevel(static_cast<AsyncLogger::Category>(i), AsyncLogger::LEVEL_WARN);
+
+  urdf::Model urdf;
+  if (!urdf.initFile(urdf_filename))
+  {
+    ROS_ERROR("Failed to parse urdf file");
+    return 2;
+  }
+
+  SceneReplay replay;
+  if (!replay.load(bag_filename, urdf, grasps_topic, cloud_topic, joint_states_topic))
+    return 2;
+  const std::vector<SceneReplay::Scene>& scenes = replay.getScenes();
+  if (uses_perf_counters && !replay.getPipeline().getStats().enablePerfCounters())
+    ROS_WARN("Hardware performance counters are not available (see /proc/sys/kernel/perf_event_paranoid)");
+
+  // each repetition runs the whole pipeline, including the point cloud preparation
+  const PipelineStats& stats = replay.getPipeline().getStats();
+  int num_grasps = 0;
+  int num_mismatches = 0;
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < scenes.size(); i++)
+  {
+    const SceneReplay::Scene& scene = scenes[i];
+    uint64_t first_digest = 0;
+    int num_selected = 0;
+    const double reaching_start = sumStageTimes(stats, PipelineStats::FILTERING, PipelineStats::COLLISION_CHECKING);
+    const double scoring_start = sumStageTimes(stats, PipelineStats::SCORING, PipelineStats::SCORING);
+
+    for (int r = 0; r < num_repetitions; r++)
+    {
+      grasp_selection::GraspList msg;
+      replay.selectGrasps(i, msg);
+      num_grasps += scene.grasps_->grasps.size();
+
+      uint64_t digest = SceneReplay::calculateDigest(msg);
+      if (r == 0)
+      {
+        first_digest = digest;
+        num_selected = msg.grasps.size();
+      }
+      else if (digest != first_digest)
+        num_mismatches++;
+    }
+
+    // the time of the reachability test (from the filtering to the collision checks) and the scoring per repetition,
+    // to compare scenes of different sizes
+    const double reaching_time = (sumStageTimes(stats, PipelineStats::FILTERING, PipelineStats::COLLISION_CHECKING)
+      - reaching_start) / num_repetitions;
+    const double scoring_time = (sumStageTimes(stats, PipelineStats::SCORING, PipelineStats::SCORING) - scoring_start)
+      / num_repetitions;
+    printf("scene %i: %i grasps, %i points, %i selected, reaching %.3f ms, scoring %.3f ms, digest %016llx\n", i,
+      (int) scene.grasps_->grasps.size(), (int) (scene.cloud_->width * scene.cloud_->height), num_selected,
+      1e3 * reaching_time, 1e3 * scoring_time, (unsigned long long) first_digest);
+
+    // the memory of the last repetition: the point cloud preparation, the selection, and the data they keep
+    const MemoryUsage& cloud_memory = replay.getPipeline().getCloudMemory();
+    const MemoryUsage& request_memory = replay.getPipeline().getRequestMemory();
+    const SelectionPipeline::DataSizes sizes = replay.getPipeline().getDataSizes();
+    printf("  memory: cloud %llu allocations (%.2f MB, peak RSS +%.2f MB), selection %llu allocations (%.2f MB, peak "
+      "RSS +%.2f MB), %llu voxels (%.2f MB), index %.2f MB, %llu candidates, reachable %.2f MB, arena %.2f MB\n",
+      (unsigned long long) cloud_memory.num_allocations_, 1e-6 * cloud_memory.num_bytes_,
+      1e-6 * cloud_memory.peak_rss_increase_, (unsigned long long) request_memory.num_allocations_,
+      1e-6 * request_memory.num_bytes_, 1e-6 * request_memory.peak_rss_increase_,
+      (unsigned long long) sizes.num_voxels_, 1e-6 * sizes.cloud_bytes_, 1e-6 * sizes.scene_index_bytes_,
+      (unsigned long long) sizes.num_candidates_, 1e-6 * sizes.candidate_bytes_, 1e-6 * sizes.arena_bytes_);
+  }
+  double total_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+  std::cout << "\nscenes: " << scenes.size() << ", repetitions: " << num_repetitions << ", time: " << total_time
+    << " s\n";
+  std::cout << "throughput: " << scenes.size() * num_repetitions / total_time << " scenes/s, "
+    << num_grasps / total_time << " grasps/s\n\n";
+
+  printf("%-20s %8s %10s %10s %10s %10s %10s\n", "stage (ms)", "count", "mean", "p50", "p95", "p99", "max");
+  for (int s = 0; s < PipelineStats::NUM_STAGES; s++)
+  {
+    const LatencyHistogram& histogram = stats.getHistogram((PipelineStats::Stage) s);
+    if (histogram.getCount() == 0)
+      continue;
+
+    printf("%-20s %8llu %10.3f %10.3f %10.3f %10.3f %10.3f\n", PipelineStats::getStageName((PipelineStats::Stage) s),
+      (unsigned long long) histogram.getCount(), 1e3 * histogram.getMean(), 1e3 * histogram.calculatePercentile(50),
+      1e3 * histogram.calculatePercentile(95), 1e3 * histogram.calculatePercentile(99), 1e3 * histogram.getMax());
+  }
+
+  // the hardware events per execution of each stage; a low IPC with many cache misses means the stage waits for memory
+  if (stats.getPerfCounters() != NULL)
+  {
+    printf("\n%-20s %14s %14s %8s %16s %16s\n", "stage", "cycles", "instructions", "IPC", "cache miss/1k", 
+      "branch miss/1k");
+    for (int s = 0; s < PipelineStats::NUM_STAGES; s++)
+    {
+      const uint64_t count = stats.getHistogram((PipelineStats::Stage) s).getCount();
+      const uint64_t* counts = stats.getPerfCounts((PipelineStats::Stage) s).counts_;
+      if (count == 0 || counts[PerfCounters::CYCLES] == 0 || counts[PerfCounters::INSTRUCTIONS] == 0)
+        continue;
+
+      const double instructions = counts[PerfCounters::INSTRUCTIONS];
+      printf("%-20s %14.0f %14.0f %8.2f %16.3f %16.3f\n", PipelineStats::getStageName((PipelineStats::Stage) s),
+        (double) counts[PerfCounters::CYCLES] / count, instructions / count, 
+        instructions / counts[PerfCounters::CYCLES], 1e3 * counts[PerfCounters::CACHE_MISSES] / instructions,
+        1e3 * counts[PerfCounters::BRANCH_MISSES] / instructions);
+    }
+  }
+
+  // the rejection counts of all repetitions
+  const RejectionCounts& rejections = stats.getRejections();
+  printf("\n%-20s %10s %14s\n", "check", "rejected", "time (ms)");
+  for (int c = 0; c < RejectionCounts::NUM_CHECKS; c++)
+  {
+    const RejectionCounts::Check check = (RejectionCounts::Check) c;
+    printf("%-20s %10llu %14.3f\n", RejectionCounts::getCheckName(check),
+      (unsigned long long) rejections.getRejected(check), 1e3 * rejections.getRejectedTime(check));
+  }
+  printf("grasps: %llu, candidates: %llu, reachable: %llu\n", (unsigned long long) rejections.getNumGrasps(),
+    (unsigned long long) rejections.getNumCandidates(), (unsigned long long) rejections.getNumReachable());
+
+  std::cout << "\nrepetitions with different results: " << num_mismatches << "\n";
+
+  // the statistics of the profile sites (only in profiling builds)
+  printf("\n");
+  ProfileSite::printReport();
+  return (num_mismatches == 0) ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+#include <ros/ros.h>
+#include <urdf/model.h>
+
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include <pcl_conversions/pcl_conversions.h>
+
+#include <boost/make_shared.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <grasp_selection/async_logger.h>
+#include <grasp_selection/request_log.h>
+#include <grasp_selection/scene_replay.h>
+
+#include <grasp_selection/GraspList.h>
+
+
+// Offline replay of the request log of the selection node (see the request_log_directory parameter): runs each logged
+// request again on its scene, with the logged joint state and hand pose, and compares the outcome with the logged one:
+// whether the service succeeded, which grasps were reachable, and which grasps were selected (with their IK solutions
+// and trajectories, see SceneReplay::calculateDigest). No ROS master, MoveIt or OpenRAVE is needed.
+//
+// The selection is created with the parameters of the node that are logged at the start of each file (see
+// msg/ParametersRecord.msg), and runs with the in-process ikfast solver. A node that used the MoveIt or OpenRAVE IK
+// services can find other IK solutions, so its requests are expected to differ in the selected grasps, but usually not
+// in the reachable ones.
+//
+// Usage: request_log_replay urdf log_file [log_file ...]
+//
+// Each log file starts with the parameters and its scene, so the files can be replayed on their own, e.g., only the
+// file of an incident.
+
+
+int main(int argc, char** argv)
+{
+  if (argc < 3)
+  {
+    std::cout << "Usage: request_log_replay urdf log_file [log_file ...]\n";
+    return 2;
+  }
+
+  // the response messages are stamped with the current time
+  ros::Time::init();
+  for (int i = 0; i < AsyncLogger::NUM_CATEGORIES; i++)
+    AsyncLogger::getInstance().setLevel(static_cast<AsyncLogger::Category>(i), AsyncLogger::LEVEL_WARN);
+
+  urdf::Model urdf;
+  if (!urdf.initFile(argv[1]))
+  {
+    ROS_ERROR("Failed to parse urdf file");
+    return 2;
+  }
+
+  // the grasp selection is created again for the parameters of each file, which can come from different nodes
+  SceneReplay replay;
+
+  int num_requests = 0;
+  int num_different = 0;
+  int num_skipped = 0;
+  for (int f = 2; f < argc; f++)
+  {
+    RequestLogReader reader;
+    if (!reader.open(argv[f]))
+      return 2;
+    printf("%s\n", argv[f]);
+
+    grasp_selection::ParametersRecord parameters;
+    grasp_selection::SceneRecord scene;
+    grasp_selection::RequestRecord request;
+    agile_grasp::Grasps::ConstPtr grasps;
+    sensor_msgs::PointCloud2 cloud_msg;
+    uint64_t scene_id = 0;
+    bool is_created = false;
+    bool has_scene = false;
+    bool is_scene_new = false;
+    RequestLogWriter::EntryType type;
+    while ((type = reader.read(parameters, scene, request)) != RequestLogWriter::ENTRY_NONE)
+    {
+      if (type == RequestLogWriter::ENTRY_PARAMETERS)
+      {
+        if (!replay.create(urdf, parameters))
+          return 2;
+        is_created = true;
+        is_scene_new = has_scene;
+        continue;
+      }
+
+      if (type == RequestLogWriter::ENTRY_SCENE)
+      {
+        grasps = boost::make_shared<agile_grasp::Grasps>(scene.grasps);
+        pcl::PointCloud<pcl::PointXYZ> cloud;
+        cloud.resize(scene.points.size() / 3);
+        for (int i = 0; i < cloud.size(); i++)
+          cloud.points[i] = pcl::PointXYZ(scene.points[3 * i], scene.points[3 * i + 1], scene.points[3 * i + 2]);
+        cloud.header.frame_id = scene.cloud_frame;
+        pcl::toROSMsg(cloud, cloud_msg);
+        scene_id = scene.scene_id;
+        has_scene = true;
+        is_scene_new = true;
+        continue;
+      }
+
+      // the parameters or the scene of a request are missing if they did not fit into the log file
+      if (!is_created || !has_scene || request.scene_id != scene_id)
+      {
+        num_skipped++;
+        continue;
+      }
+
+      // the downsampled point cloud is unchanged by the downsampling of the pipeline
+      SelectionPipeline& pipeline = replay.getPipeline();
+      if (is_scene_new)
+      {
+        pipeline.setPointCloud(cloud_msg);
+        pipeline.setGrasps(grasps);
+        is_scene_new = false;
+      }
+      pipeline.setJointState(request.joint_state);
+
+      grasp_selection::GraspList msg;
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      const bool success = pipeline.selectGrasps(request.hand_pose, msg);
+      const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      const CandidateStore& reachable = pipeline.getReachableGrasps();
+      bool is_reachable_same = (reachable.size() == request.reachable_ids.size());
+      for (int i = 0; i < reachable.size() && is_reachable_same; i++)
+        is_reachable_same = (reachable.getId(i) == request.reachable_ids[i]);
+      const bool is_selected_same = (SceneReplay::calculateDigest(msg)
+        == SceneReplay::calculateDigest(request.grasps));
+      const bool is_same = (success == (bool) request.success && is_reachable_same && is_selected_same);
+
+      printf("request %llu (scene %llu): %i grasps, reachable %i (logged %i), selected %i (logged %i), %.3f ms "
+        "(logged %.3f ms), %s\n", (unsigned long long) request.request_id, (unsigned long long) request.scene_id,
+        (int) grasps->grasps.size(), reachable.size(), (int) request.reachable_ids.size(), (int) msg.grasps.size(),
+        (int) request.grasps.grasps.size(), 1e3 * seconds, 1e-6 * request.latency, is_same ? "same" : "DIFFERENT");
+      num_requests++;
+      num_different += !is_same;
+    }
+  }
+
+  printf("\n%i requests, %i with a different outcome, %i skipped without their parameters or scene\n", num_requests,
+    num_different, num_skipped);
+  return (num_different == 0) ? 0 : 1;
+}
@@ -0,0 +1,81 @@
+#include <grasp_selection/arena.h>
+
+#include <cstdint>
+
+
+Arena::Arena(std::size_t block_size) : offset_(0)
+{
+  addBlock(block_size);
+  reset();
+}
+
+
+Arena::~Arena()
+{
+  for (int i = 0; i < blocks_.size(); i++)
+    ::operator delete(blocks_[i].data_);
+}
+
+
+void* Arena::allocate(std::size_t num_bytes, std::size_t alignment)
+{
+  std::size_t start = alignOffset(offset_, alignment);
+
+  // the current block is full, so continue in a new block
+  if (start + num_bytes > blocks_.back().size_)
+  {
+    addBlock(num_bytes + alignment);
+    start = alignOffset(0, alignment);
+  }
+
+  offset_ = start + num_bytes;
+  stats_.num_allocations_++;
+  stats_.num_bytes_ += num_bytes;
+  return blocks_.back().data_ + start;
+}
+
+
+std::size_t Arena::alignOffset(std::size_t offset, std::size_t alignment) const
+{
+  std::uintptr_t address = reinterpret_cast<std::uintptr_t>(blocks_.back().data_ + offset);
+  std::uintptr_t aligned = (address + alignment - 1) & ~static_cast<std::uintptr_t>(alignment - 1);
+  return offset + (aligned - address);
+}
+
+
+void Arena::reset()
+{
+  // merge the blocks so that the next request fits into a single block
+  if (blocks_.size() > 1)
+  {
+    std::size_t size = 0;
+    for (int i = 0; i < blocks_.size(); i++)
+    {
+      size += blocks_[i].size_;
+      ::operator delete(blocks_[i].data_);
+    }
+    blocks_.clear();
+    addBlock(size);
+  }
+
+  offset_ = 0;
+  stats_.num_allocations_ = 0;
+  stats_.num_bytes_ = 0;
+  stats_.num_heap_allocations_ = 0;
+}
+
+
+void Arena::addBlock(std::size_t min_size)
+{
+  // grow geometrically to keep the number of blocks small
+  std::size_t size = min_size;
+  if (blocks_.size() > 0 && 2 * blocks_.back().size_ > size)
+    size = 2 * blocks_.back().size_;
+
+  Block block;
+  block.data_ = static_cast<char*>(::operator new(size));
+  block.size_ = size;
+  blocks_.push_back(block);
+  offset_ = 0;
+  stats_.num_heap_allocations_++;
+}
@@ -0,0 +1,82 @@
+#include <grasp_selection/arm_kinematics.h>
+
+#include <ros/console.h>
+
+#include <algorithm>
+
+
+ArmKinematics::ArmKinematics(const urdf::Model& urdf, const std::string& base_link, const std::string& tip_link,
+  const std::vector<std::string>& joint_names) : velocity_limits_(joint_names.size(), 1.0), is_valid_(false)
+{
+  // the planning frame may be given with a leading slash
+  std::string base = (base_link.size() > 0 && base_link[0] == '/') ? base_link.substr(1) : base_link;
+
+  // walk from the tip link up to the base link
+  std::string link_name = (tip_link.size() > 0 && tip_link[0] == '/') ? tip_link.substr(1) : tip_link;
+  while (link_name != base)
+  {
+    auto link = urdf.getLink(link_name);
+    if (!link || !link->parent_joint)
+    {
+      ROS_ERROR("No kinematic chain from link %s to link %s in URDF", base.c_str(), tip_link.c_str());
+      chain_.clear();
+      return;
+    }
+
+    const urdf::Joint& urdf_joint = *link->parent_joint;
+    const urdf::Pose& pose = urdf_joint.parent_to_joint_origin_transform;
+    double qx, qy, qz, qw;
+    pose.rotation.getQuaternion(qx, qy, qz, qw);
+
+    Joint joint;
+    joint.origin_ = Eigen::Translation3d(pose.position.x, pose.position.y, pose.position.z)
+      * Eigen::Quaterniond(qw, qx, qy, qz);
+    joint.axis_ << urdf_joint.axis.x, urdf_joint.axis.y, urdf_joint.axis.z;
+    joint.type_ = urdf_joint.type;
+    joint.index_ = -1;
+    if (joint.type_ == urdf::Joint::REVOLUTE || joint.type_ == urdf::Joint::CONTINUOUS
+      || joint.type_ == urdf::Joint::PRISMATIC)
+    {
+      std::vector<std::string>::const_iterator it = std::find(joint_names.begin(), joint_names.end(),
+        urdf_joint.name);
+      if (it != joint_names.end())
+      {
+        joint.index_ = it - joint_names.begin();
+        if (urdf_joint.limits && urdf_joint.limits->velocity > 0)
+          velocity_limits_[joint.index_] = urdf_joint.limits->velocity;
+      }
+      else
+        ROS_WARN("Joint %s is not an arm joint, keeping it at zero", urdf_joint.name.c_str());
+    }
+
+    chain_.push_back(joint);
+    link_name = urdf_joint.parent_link_name;
+  }
+
+  std::reverse(chain_.begin(), chain_.end());
+  is_valid_ = true;
+}
+
+
+void ArmKinematics::calculateFrameOrigins(const double* joint_positions, Eigen::Vector3d* origins) const
+{
+  Eigen::Affine3d T = Eigen::Affine3d::Identity();
+  origins[0] = T.translation();
+
+  for (int i = 0; i < chain_.size(); i++)
+  {
+    const Joint& joint = chain_[i];
+    T = T * joint.origin_;
+
+    if (joint.index_ >= 0)
+    {
+      double q = joint_positions[joint.index_];
+      if (joint.type_ == urdf::Joint::PRISMATIC)
+        T = T * Eigen::Translation3d(q * joint.axis_);
+      else
+        T = T * Eigen::AngleAxisd(q, joint.axis_);
+    }
+
+    origins[i + 1] = T.translation();
+  }
+}
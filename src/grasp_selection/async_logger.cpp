@@ -0,0 +1,269 @@
+#include <grasp_selection/async_logger.h>
+
+#include <algorithm>
+#include <cstring>
+
+
+namespace
+{
+
+/** Order the records by the time at which they were logged. */
+template <typename Record>
+bool isEarlier(const Record& a, const Record& b)
+{
+  return a.time_ < b.time_;
+}
+
+/** Append a single formatted value to a line. */
+template <typename T>
+void appendFormatted(std::string& line, const char* spec, T value)
+{
+  char buffer[256];
+  int length = snprintf(buffer, sizeof(buffer), spec, value);
+  if (length < 0)
+    return;
+  if (length < sizeof(buffer))
+  {
+    line.append(buffer, length);
+    return;
+  }
+
+  std::vector<char> long_buffer(length + 1);
+  snprintf(&long_buffer[0], long_buffer.size(), spec, value);
+  line.append(&long_buffer[0], length);
+}
+
+}
+
+
+AsyncLogger& AsyncLogger::getInstance()
+{
+  static AsyncLogger logger;
+  return logger;
+}
+
+
+AsyncLogger::AsyncLogger() : num_flush_requests_(0), num_flushes_(0), is_stopping_(false)
+{
+  for (int i = 0; i < NUM_CATEGORIES; i++)
+    levels_[i].store(LEVEL_INFO);
+
+  thread_ = std::thread(&AsyncLogger::run, this);
+}
+
+
+AsyncLogger::~AsyncLogger()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_stopping_ = true;
+  }
+  condition_.notify_all();
+  thread_.join();
+
+  for (int i = 0; i < buffers_.size(); i++)
+    delete buffers_[i];
+}
+
+
+void AsyncLogger::flush()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  const uint64_t request = ++num_flush_requests_;
+  condition_.notify_all();
+  while (num_flushes_ < request && !is_stopping_)
+    condition_.wait(lock);
+}
+
+
+const char* AsyncLogger::getCategoryName(Category category)
+{
+  static const char* names[NUM_CATEGORIES] = {"reaching", "scoring", "selection"};
+  return names[category];
+}
+
+
+bool AsyncLogger::parseLevel(const std::string& name, Level& level)
+{
+  static const char* names[] = {"debug", "info", "warn", "error", "none"};
+  for (int i = 0; i <= LEVEL_NONE; i++)
+  {
+    if (name == names[i])
+    {
+      level = static_cast<Level>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+
+AsyncLogger::RingBuffer* AsyncLogger::createThreadBuffer()
+{
+  RingBuffer* buffer = new RingBuffer(BUFFER_CAPACITY);
+  std::lock_guard<std::mutex> lock(mutex_);
+  buffers_.push_back(buffer);
+  return buffer;
+}
+
+
+void AsyncLogger::run()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true)
+  {
+    condition_.wait_for(lock, std::chrono::milliseconds(FLUSH_PERIOD),
+      [this] { return is_stopping_ || num_flushes_ < num_flush_requests_; });
+
+    // the records are formatted without holding the lock, so that new threads can register their buffers
+    const uint64_t num_requests = num_flush_requests_;
+    const bool is_stopping = is_stopping_;
+    std::vector<RingBuffer*> buffers = buffers_;
+    lock.unlock();
+    writeRecords(buffers);
+    lock.lock();
+
+    num_flushes_ = num_requests;
+    condition_.notify_all();
+    if (is_stopping)
+      break;
+  }
+}
+
+
+void AsyncLogger::writeRecords(const std::vector<RingBuffer*>& buffers)
+{
+  records_.clear();
+  size_t num_dropped = 0;
+  for (int i = 0; i < buffers.size(); i++)
+    num_dropped += buffers[i]->pop(records_);
+
+  if (records_.empty() && num_dropped == 0)
+    return;
+
+  // the records of different threads are interleaved by time
+  std::stable_sort(records_.begin(), records_.end(), isEarlier<Record>);
+
+  text_.clear();
+  for (int i = 0; i < records_.size(); i++)
+    formatRecord(records_[i], text_);
+
+  if (num_dropped > 0)
+  {
+    char line[96];
+    snprintf(line, sizeof(line), "[ WARN] [logger]: %zu messages dropped because the log buffers were full\n",
+      num_dropped);
+    text_ += line;
+  }
+
+  fwrite(text_.data(), 1, text_.size(), stdout);
+  fflush(stdout);
+}
+
+
+void AsyncLogger::formatRecord(const Record& record, std::string& line)
+{
+  static const char* level_names[] = {"DEBUG", " INFO", " WARN", "ERROR"};
+
+  // the prefix follows the format of the ROS console
+  char prefix[96];
+  snprintf(prefix, sizeof(prefix), "[%s] [%lld.%09lld] [%s]: ", level_names[record.level_],
+    (long long) (record.time_ / 1000000000), (long long) (record.time_ % 1000000000),
+    getCategoryName(static_cast<Category>(record.category_)));
+  line += prefix;
+
+  const char* f = record.format_;
+  int next_arg = 0;
+  char spec[32];
+  while (*f != '\0')
+  {
+    if (*f != '%')
+    {
+      const char* start = f;
+      while (*f != '\0' && *f != '%')
+        f++;
+      line.append(start, f - start);
+      continue;
+    }
+    if (f[1] == '%')
+    {
+      line += '%';
+      f += 2;
+      continue;
+    }
+
+    // copy the flags, the width and the precision; the length modifiers are replaced by the type of the stored
+    // argument
+    const char* start = f++;
+    int n = 0;
+    spec[n++] = '%';
+    while (*f != '\0' && strchr("-+ #0123456789.", *f) != NULL)
+    {
+      if (n < sizeof(spec) - 4)
+        spec[n++] = *f;
+      f++;
+    }
+    while (*f != '\0' && strchr("hlLqjzt", *f) != NULL)
+      f++;
+    const char conversion = *f;
+    if (conversion != '\0')
+      f++;
+
+    if (conversion == '\0' || next_arg >= record.num_args_)
+    {
+      line.append(start, f - start);
+      continue;
+    }
+
+    const Arg& arg = record.args_[next_arg++];
+    long long i = (arg.type_ == Arg::SIGNED) ? arg.i_ : (arg.type_ == Arg::UNSIGNED) ? (long long) arg.u_
+      : (arg.type_ == Arg::FLOATING) ? (long long) arg.d_ : 0;
+    double d = (arg.type_ == Arg::FLOATING) ? arg.d_ : (arg.type_ == Arg::UNSIGNED) ? (double) arg.u_ : (double) i;
+    switch (conversion)
+    {
+      case 'd':
+      case 'i':
+        strcpy(spec + n, "lld");
+        appendFormatted(line, spec, i);
+        break;
+      case 'u':
+      case 'o':
+      case 'x':
+      case 'X':
+        spec[n++] = 'l';
+        spec[n++] = 'l';
+        spec[n++] = conversion;
+        spec[n] = '\0';
+        appendFormatted(line, spec, (arg.type_ == Arg::UNSIGNED) ? arg.u_ : (unsigned long long) i);
+        break;
+      case 'f':
+      case 'F':
+      case 'e':
+      case 'E':
+      case 'g':
+      case 'G':
+      case 'a':
+      case 'A':
+        spec[n++] = conversion;
+        spec[n] = '\0';
+        appendFormatted(line, spec, d);
+        break;
+      case 'c':
+        strcpy(spec + n, "c");
+        appendFormatted(line, spec, (int) i);
+        break;
+      case 's':
+        strcpy(spec + n, "s");
+        appendFormatted(line, spec, (arg.type_ == Arg::STRING && arg.s_ != NULL) ? arg.s_ : "(null)");
+        break;
+      case 'p':
+        strcpy(spec + n, "p");
+        appendFormatted(line, spec, (arg.type_ == Arg::POINTER) ? arg.p_ : NULL);
+        break;
+      default:
+        line.append(start, f - start);
+    }
+  }
+
+  line += '\n';
+}
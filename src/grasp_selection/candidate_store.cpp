@@ -0,0 +1,56 @@
+#include <grasp_selection/candidate_store.h>
+
+#include <algorithm>
+
+
+void CandidateStore::reset(int num_joints, int num_pregrasps)
+{
+  num_joints_ = num_joints;
+  num_pregrasps_ = num_pregrasps;
+  ids_.clear();
+  positions_.clear();
+  orientations_.clear();
+  approaches_.clear();
+  widths_.clear();
+  joint_positions_.clear();
+  pregrasp_joint_positions_.clear();
+  scores_.clear();
+}
+
+
+void CandidateStore::reserve(int size)
+{
+  ids_.reserve(size);
+  positions_.reserve(3 * size);
+  orientations_.reserve(4 * size);
+  approaches_.reserve(3 * size);
+  widths_.reserve(size);
+  joint_positions_.reserve(num_joints_ * size);
+  pregrasp_joint_positions_.reserve(num_pregrasps_ * num_joints_ * size);
+  scores_.reserve(size);
+}
+
+
+std::size_t CandidateStore::getMemorySize() const
+{
+  const std::size_t num_doubles = positions_.capacity() + orientations_.capacity() + approaches_.capacity() 
+    + widths_.capacity() + joint_positions_.capacity() + pregrasp_joint_positions_.capacity() + scores_.capacity();
+  return ids_.capacity() * sizeof(int) + num_doubles * sizeof(double);
+}
+
+
+int CandidateStore::add(int id, const Eigen::Vector3d& position, const Eigen::Quaterniond& orientation,
+  const Eigen::Vector3d& approach, double width, const double* joint_positions, const double* pregrasp_joint_positions)
+{
+  ids_.push_back(id);
+  positions_.insert(positions_.end(), position.data(), position.data() + 3);
+  orientations_.insert(orientations_.end(), orientation.coeffs().data(), orientation.coeffs().data() + 4);
+  approaches_.insert(approaches_.end(), approach.data(), approach.data() + 3);
+  widths_.push_back(width);
+  joint_positions_.insert(joint_positions_.end(), joint_positions, joint_positions + num_joints_);
+  if (num_pregrasps_ > 0)
+    pregrasp_joint_positions_.insert(pregrasp_joint_positions_.end(), pregrasp_joint_positions, 
+      pregrasp_joint_positions + num_pregrasps_ * num_joints_);
+  scores_.push_back(0.0);
+  return ids_.size() - 1;
+}
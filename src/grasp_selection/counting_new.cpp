@@ -0,0 +1,55 @@
+#include <grasp_selection/memory_usage.h>
+
+#include <cstdlib>
+#include <new>
+
+
+// Replacements of the global operator new and delete that count the heap allocations (see AllocationCounter). The
+// replacements only take effect if they are linked into the executable itself, so this file is a source of each
+// executable that reports its allocations instead of a part of a library.
+
+
+void* operator new(size_t size)
+{
+  AllocationCounter::count(size);
+  void* p = malloc(size == 0 ? 1 : size);
+  if (p == NULL)
+    throw std::bad_alloc();
+  return p;
+}
+
+void* operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+  AllocationCounter::count(size);
+  return malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept
+{
+  return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept
+{
+  free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+  free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+  free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+  free(p);
+}
@@ -0,0 +1,79 @@
+#include <grasp_selection/grasp_arrays.h>
+
+
+GraspArrays::GraspArrays(int size, Arena& arena) : size_(size),
+  ids_(arena.allocateArray<int>(size)),
+  centers_(arena.allocateArray<double>(3 * size, SIMD_ALIGNMENT), size, 3),
+  surface_centers_(arena.allocateArray<double>(3 * size, SIMD_ALIGNMENT), size, 3),
+  axes_(arena.allocateArray<double>(3 * size, SIMD_ALIGNMENT), size, 3),
+  approaches_(arena.allocateArray<double>(3 * size, SIMD_ALIGNMENT), size, 3),
+  binormals_(arena.allocateArray<double>(3 * size, SIMD_ALIGNMENT), size, 3),
+  widths_(arena.allocateArray<double>(size, SIMD_ALIGNMENT), size)
+{ }
+
+
+GraspArrays::GraspArrays(const agile_grasp::Grasps& grasps, Arena& arena) : GraspArrays(grasps.grasps.size(), arena)
+{
+  // decode the message field by field
+  for (int i = 0; i < size_; i++)
+  {
+    const agile_grasp::Grasp& grasp = grasps.grasps[i];
+    ids_[i] = i;
+    centers_(i, 0) = grasp.center.x;
+    centers_(i, 1) = grasp.center.y;
+    centers_(i, 2) = grasp.center.z;
+    surface_centers_(i, 0) = grasp.surface_center.x;
+    surface_centers_(i, 1) = grasp.surface_center.y;
+    surface_centers_(i, 2) = grasp.surface_center.z;
+    axes_(i, 0) = grasp.axis.x;
+    axes_(i, 1) = grasp.axis.y;
+    axes_(i, 2) = grasp.axis.z;
+    approaches_(i, 0) = grasp.approach.x;
+    approaches_(i, 1) = grasp.approach.y;
+    approaches_(i, 2) = grasp.approach.z;
+    widths_(i) = grasp.width.data;
+  }
+  
+  // binormal = axis x (-approach) (used as rotation axis to generate additional approach vectors)
+  for (int k = 0; k < 3; k++)
+  {
+    const int k1 = (k + 1) % 3;
+    const int k2 = (k + 2) % 3;
+    binormals_.col(k) = approaches_.col(k1) * axes_.col(k2) - approaches_.col(k2) * axes_.col(k1);
+  }
+}
+
+
+GraspArrays GraspArrays::select(const Mask& mask, Arena& arena) const
+{
+  GraspArrays selected(mask.count(), arena);
+  
+  int j = 0;
+  for (int i = 0; i < size_; i++)
+  {
+    if (!mask(i))
+      continue;
+    
+    selected.ids_[j] = ids_[i];
+    selected.centers_.row(j) = centers_.row(i);
+    selected.surface_centers_.row(j) = surface_centers_.row(i);
+    selected.axes_.row(j) = axes_.row(i);
+    selected.approaches_.row(j) = approaches_.row(i);
+    selected.binormals_.row(j) = binormals_.row(i);
+    selected.widths_(j) = widths_(i);
+    j++;
+  }
+  
+  return selected;
+}
+
+
+CandidatePoses::CandidatePoses(int num_grasps, int num_angles, Arena& arena) : num_grasps_(num_grasps),
+  num_angles_(num_angles),
+  positions_(arena.allocateArray<double>(3 * num_grasps * num_angles, SIMD_ALIGNMENT), num_grasps * num_angles, 3),
+  approaches_(arena.allocateArray<double>(3 * num_grasps * num_angles, SIMD_ALIGNMENT), num_grasps * num_angles, 3),
+  first_orientations_(arena.allocateArray<double>(4 * num_grasps * num_angles, SIMD_ALIGNMENT),
+    num_grasps * num_angles, 4),
+  second_orientations_(arena.allocateArray<double>(4 * num_grasps * num_angles, SIMD_ALIGNMENT),
+    num_grasps * num_angles, 4)
+{ }
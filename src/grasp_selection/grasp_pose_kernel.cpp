@@ -0,0 +1,107 @@
+#include <grasp_selection/grasp_pose_kernel.h>
+
+#include <cmath>
+
+
+GraspPoseKernel::GraspPoseKernel(const std::vector<int>& axis_order, double hand_offset) : hand_offset_(hand_offset)
+{
+  for (int i = 0; i < 3; i++)
+    axis_order_[i] = axis_order[i];
+}
+
+
+void GraspPoseKernel::calculatePoses(const GraspArrays& grasps, const ArenaVector<double>& theta,
+  CandidatePoses& poses, Arena& arena) const
+{
+  const int n = grasps.size();
+  const GraspArrays::Array3& B = grasps.binormals_;
+  const GraspArrays::Array3& V = grasps.approaches_;
+  const GraspArrays::Array3& A = grasps.axes_;
+
+  // temporary data: the rotated hand axes, dot products, and the hand orientations as rotation matrices (one
+  // column-major matrix entry per column)
+  GraspArrays::Array3 axes(arena.allocateArray<double>(3 * n, SIMD_ALIGNMENT), n, 3);
+  GraspArrays::Array1 dot_approach(arena.allocateArray<double>(n, SIMD_ALIGNMENT), n);
+  GraspArrays::Array1 dot_axis(arena.allocateArray<double>(n, SIMD_ALIGNMENT), n);
+  RotationArray rotations(arena.allocateArray<double>(9 * n, SIMD_ALIGNMENT), n, 9);
+  
+  for (int j = 0; j < theta.size(); j++)
+  {
+    const double c = cos(theta[j] * (M_PI / 180.0));
+    const double s = sin(theta[j] * (M_PI / 180.0));
+    auto approaches = poses.approaches_.middleRows(j * n, n);
+    auto positions = poses.positions_.middleRows(j * n, n);
+    
+    // rotate the approach vectors and hand axes about the binormals (Rodrigues' formula), one coordinate at a time
+    dot_approach = B.col(0) * V.col(0) + B.col(1) * V.col(1) + B.col(2) * V.col(2);
+    dot_axis = B.col(0) * A.col(0) + B.col(1) * A.col(1) + B.col(2) * A.col(2);
+    for (int k = 0; k < 3; k++)
+    {
+      const int k1 = (k + 1) % 3;
+      const int k2 = (k + 2) % 3;
+      approaches.col(k) = c * V.col(k) + s * (B.col(k1) * V.col(k2) - B.col(k2) * V.col(k1))
+        + (1.0 - c) * dot_approach * B.col(k);
+      axes.col(k) = c * A.col(k) + s * (B.col(k1) * A.col(k2) - B.col(k2) * A.col(k1))
+        + (1.0 - c) * dot_axis * B.col(k);
+      
+      // translate grasp position by <hand_offset_> against the grasp approach vector
+      positions.col(k) = grasps.centers_.col(k) - hand_offset_ * approaches.col(k);
+    }
+    
+    // first hand orientation: the hand approaches the grasp position
+    for (int k = 0; k < 3; k++)
+    {
+      rotations.col(3 * axis_order_[0] + k) = -approaches.col(k); // grasp approach vector
+      rotations.col(3 * axis_order_[1] + k) = axes.col(k); // hand axis
+    }
+    completeRotations(rotations);
+    convertToQuaternions(rotations, poses.first_orientations_.middleRows(j * n, n));
+    
+    // rotate by 180deg around the grasp approach vector to get the "opposite" hand orientation
+    dot_approach = approaches.col(0).square() + approaches.col(1).square() + approaches.col(2).square();
+    dot_axis = approaches.col(0) * axes.col(0) + approaches.col(1) * axes.col(1) + approaches.col(2) * axes.col(2);
+    for (int k = 0; k < 3; k++)
+    {
+      rotations.col(3 * axis_order_[0] + k) = 2.0 * dot_approach * approaches.col(k) - approaches.col(k);
+      rotations.col(3 * axis_order_[1] + k) = 2.0 * dot_axis * approaches.col(k) - axes.col(k);
+    }
+    completeRotations(rotations);
+    convertToQuaternions(rotations, poses.second_orientations_.middleRows(j * n, n));
+  }
+}
+
+
+void GraspPoseKernel::completeRotations(RotationArray& rotations) const
+{
+  // hand binormal = grasp approach vector x hand axis
+  for (int k = 0; k < 3; k++)
+  {
+    const int k1 = (k + 1) % 3;
+    const int k2 = (k + 2) % 3;
+    rotations.col(3 * axis_order_[2] + k) = 
+      rotations.col(3 * axis_order_[0] + k1) * rotations.col(3 * axis_order_[1] + k2) 
+      - rotations.col(3 * axis_order_[0] + k2) * rotations.col(3 * axis_order_[1] + k1);
+  }
+}
+
+
+template <class Block>
+void GraspPoseKernel::convertToQuaternions(const RotationArray& rotations, Block orientations) const
+{
+  const int n = rotations.rows();
+  const double* entries[9];
+  for (int e = 0; e < 9; e++)
+    entries[e] = rotations.col(e).data();
+  
+  for (int i = 0; i < n; i++)
+  {
+    Eigen::Matrix3d R;
+    for (int e = 0; e < 9; e++)
+      R(e) = entries[e][i];
+    
+    Eigen::Quaterniond quat(R);
+    quat.normalize();
+    for (int e = 0; e < 4; e++)
+      orientations(i, e) = quat.coeffs()(e);
+  }
+}
@@ -0,0 +1,213 @@
+#include <grasp_selection/ik_solver.h>
+
+#include <algorithm>
+#include <chrono>
+
+
+void waitForIKService(ros::ServiceClient& service)
+{
+  while (!service.exists())
+  {
+    ROS_INFO("Waiting for Inverse Kinematics service ...");
+    ros::Duration(1.0).sleep();
+  }
+  ROS_INFO("Inverse Kinematics service is available");
+}
+
+
+bool collectJoints(const urdf::Model& urdf, const std::string& base_link, const std::string& tip_link,
+  std::vector<boost::shared_ptr<const urdf::Joint> >& joints)
+{
+  std::string base = (base_link.size() > 0 && base_link[0] == '/') ? base_link.substr(1) : base_link;
+  std::string link_name = (tip_link.size() > 0 && tip_link[0] == '/') ? tip_link.substr(1) : tip_link;
+  joints.clear();
+
+  while (link_name != base)
+  {
+    auto link = urdf.getLink(link_name);
+    if (!link || !link->parent_joint)
+    {
+      ROS_ERROR("No kinematic chain from link %s to link %s in URDF", base.c_str(), tip_link.c_str());
+      return false;
+    }
+
+    joints.push_back(link->parent_joint);
+    link_name = link->parent_joint->parent_link_name;
+  }
+
+  std::reverse(joints.begin(), joints.end());
+  return true;
+}
+
+
+bool IKSolver::setJointOrder(const std::vector<std::string>& chain_names, const std::vector<std::string>& joint_names)
+{
+  chain_indices_.clear();
+  if (joint_names.empty())
+    return true;
+
+  // for each joint in the solutions, the index of the same joint in the chain
+  chain_indices_.resize(joint_names.size(), -1);
+  for (int i = 0; i < chain_names.size(); i++)
+  {
+    std::vector<std::string>::const_iterator it = std::find(joint_names.begin(), joint_names.end(), chain_names[i]);
+    if (it == joint_names.end())
+    {
+      ROS_ERROR("The joint %s of the IK chain is not in the joint states", chain_names[i].c_str());
+      chain_indices_.clear();
+      return false;
+    }
+    chain_indices_[it - joint_names.begin()] = i;
+  }
+
+  if (std::find(chain_indices_.begin(), chain_indices_.end(), -1) != chain_indices_.end())
+  {
+    ROS_ERROR("The joint states have joints that are not in the IK chain");
+    chain_indices_.clear();
+    return false;
+  }
+  return true;
+}
+
+
+void IKSolver::toChainOrder(const double* joint_positions, double* chain_positions) const
+{
+  if (chain_indices_.empty())
+  {
+    std::copy(joint_positions, joint_positions + num_joints_, chain_positions);
+    return;
+  }
+
+  for (int i = 0; i < chain_indices_.size(); i++)
+    chain_positions[chain_indices_[i]] = joint_positions[i];
+}
+
+
+void IKSolver::fromChainOrder(const double* chain_positions, double* joint_positions) const
+{
+  if (chain_indices_.empty())
+  {
+    std::copy(chain_positions, chain_positions + num_joints_, joint_positions);
+    return;
+  }
+
+  for (int i = 0; i < chain_indices_.size(); i++)
+    joint_positions[i] = chain_positions[chain_indices_[i]];
+}
+
+
+MoveItIKSolver::MoveItIKSolver(ros::NodeHandle& node, const std::string& move_group, const std::string& arm_link,
+  int first_joint_index, int num_joints) : IKSolver(num_joints), first_joint_index_(first_joint_index)
+{
+  ik_service_ = node.serviceClient<moveit_msgs::GetPositionIK>("/compute_ik");
+  waitForIKService(ik_service_);
+
+  // the IK messages are reused for all IK requests so that their memory is only allocated once
+  ik_.request.ik_request.group_name = move_group;
+  ik_.request.ik_request.ik_link_name = arm_link;
+  ik_.request.ik_request.avoid_collisions = false;
+}
+
+
+bool MoveItIKSolver::solve(const geometry_msgs::PoseStamped& pose, const double* seed, int attempts, double timeout,
+  double* joint_positions)
+{
+  // create IK request (the group and link names are set once in the constructor)
+  moveit_msgs::GetPositionIK::Request& request = ik_.request;
+  request.ik_request.attempts = attempts;
+  request.ik_request.timeout = ros::Duration(timeout);
+  request.ik_request.pose_stamped = pose;
+  request.ik_request.pose_stamped.header.stamp = ros::Time::now();
+
+  // seed the solver with the given joint positions, embedded into the full robot state of the previous solution;
+  // without a seed, MoveIt starts from the current robot state
+  sensor_msgs::JointState& seed_state = request.ik_request.robot_state.joint_state;
+  const sensor_msgs::JointState& previous_state = ik_.response.solution.joint_state;
+  if (seed != NULL && previous_state.position.size() >= first_joint_index_ + num_joints_)
+  {
+    seed_state.name = previous_state.name;
+    seed_state.position = previous_state.position;
+    std::copy(seed, seed + num_joints_, seed_state.position.begin() + first_joint_index_);
+  }
+  else
+  {
+    seed_state.name.clear();
+    seed_state.position.clear();
+  }
+
+  // solve IK
+  ik_service_.call(request, ik_.response);
+  const sensor_msgs::JointState& solution = ik_.response.solution.joint_state;
+  if (ik_.response.error_code.val == ik_.response.error_code.NO_IK_SOLUTION
+    || solution.position.size() < first_joint_index_ + num_joints_)
+    return false;
+
+  std::copy(&solution.position[first_joint_index_], &solution.position[first_joint_index_] + num_joints_,
+    joint_positions);
+  return true;
+}
+
+
+OpenRaveIKSolver::OpenRaveIKSolver(ros::NodeHandle& node, int num_joints, const urdf::Model& urdf,
+  const std::string& base_link, const std::string& tip_link, const std::vector<std::string>& joint_names)
+  : IKSolver(num_joints)
+{
+  // the service returns the joint positions in the order of the ikfast chain
+  if (!joint_names.empty())
+  {
+    std::vector<boost::shared_ptr<const urdf::Joint> > joints;
+    std::vector<std::string> chain_names;
+    if (collectJoints(urdf, base_link, tip_link, joints))
+    {
+      for (int i = 0; i < joints.size(); i++)
+        if (joints[i]->type != urdf::Joint::FIXED)
+          chain_names.push_back(joints[i]->name);
+    }
+
+    if (chain_names.size() != num_joints_ || !setJointOrder(chain_names, joint_names))
+      ROS_WARN("Cannot map the joints of the ikfast chain to the joint states; using the order of the chain");
+  }
+
+  ik_service_ = node.serviceClient<grasp_selection::SolveIK>("/ikfast_solver");
+  waitForIKService(ik_service_);
+}
+
+
+bool OpenRaveIKSolver::solve(const geometry_msgs::PoseStamped& pose, const double* seed, int attempts,
+  double timeout, double* joint_positions)
+{
+  // create IK request
+  ik_.request.target_pose = pose.pose;
+  if (seed != NULL)
+  {
+    ik_.request.current_joint_positions.resize(num_joints_);
+    toChainOrder(seed, &ik_.request.current_joint_positions[0]);
+  }
+  else
+    ik_.request.current_joint_positions.clear();
+
+  // solve IK
+  ik_service_.call(ik_.request, ik_.response);
+  if (!ik_.response.success || (int) ik_.response.solution.size() < num_joints_)
+    return false;
+
+  fromChainOrder(&ik_.response.solution[0], joint_positions);
+  return true;
+}
+
+
+RecordingIKSolver::RecordingIKSolver(IKSolver* solver, const std::string& filename)
+  : IKSolver(solver->getNumJoints()), solver_(solver), writer_(filename, solver->getNumJoints())
+{ }
+
+
+bool RecordingIKSolver::solve(const geometry_msgs::PoseStamped& pose, const double* seed, int attempts,
+  double timeout, double* joint_positions)
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  const bool success = solver_->solve(pose, seed, attempts, timeout, joint_positions);
+  const int64_t latency = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()
+    - start).count();
+  writer_.write(pose.pose, seed, success, joint_positions, latency);
+  return success;
+}
@@ -0,0 +1,192 @@
+#include <grasp_selection/ik_trace.h>
+
+#include <ros/ros.h>
+
+#include <cmath>
+#include <cstring>
+
+
+namespace
+{
+
+const char MAGIC[4] = {'G', 'S', 'I', 'K'};
+const int32_t VERSION = 1;
+
+const uint32_t FLAG_HAS_SEED = 1;
+const uint32_t FLAG_SUCCESS = 2;
+
+/** The fixed-size part of a record. */
+struct RecordHeader
+{
+  double pose_[7]; ///< the position and the orientation (x, y, z, w)
+  uint32_t flags_;
+  uint32_t padding_;
+  int64_t latency_;
+};
+
+}
+
+
+IKTraceWriter::IKTraceWriter(const std::string& filename, int num_joints) : num_joints_(num_joints)
+{
+  file_ = fopen(filename.c_str(), "wb");
+  if (file_ == NULL)
+  {
+    ROS_ERROR("Could not create IK trace file %s", filename.c_str());
+    return;
+  }
+
+  int32_t header[3];
+  memcpy(&header[0], MAGIC, sizeof(MAGIC));
+  header[1] = VERSION;
+  header[2] = num_joints;
+  fwrite(header, sizeof(header), 1, file_);
+}
+
+
+IKTraceWriter::~IKTraceWriter()
+{
+  if (file_ != NULL)
+    fclose(file_);
+}
+
+
+void IKTraceWriter::write(const geometry_msgs::Pose& pose, const double* seed, bool success,
+  const double* joint_positions, int64_t latency)
+{
+  if (file_ == NULL)
+    return;
+
+  RecordHeader record;
+  record.pose_[0] = pose.position.x;
+  record.pose_[1] = pose.position.y;
+  record.pose_[2] = pose.position.z;
+  record.pose_[3] = pose.orientation.x;
+  record.pose_[4] = pose.orientation.y;
+  record.pose_[5] = pose.orientation.z;
+  record.pose_[6] = pose.orientation.w;
+  record.flags_ = ((seed != NULL) ? FLAG_HAS_SEED : 0) | (success ? FLAG_SUCCESS : 0);
+  record.padding_ = 0;
+  record.latency_ = latency;
+
+  // the file is buffered by stdio, so that a record does not cost a system call
+  fwrite(&record, sizeof(record), 1, file_);
+  if (seed != NULL)
+    fwrite(seed, sizeof(double), num_joints_, file_);
+  if (success)
+    fwrite(joint_positions, sizeof(double), num_joints_, file_);
+}
+
+
+IKTrace::IKTrace(double cell_size, double orientation_weight) : cell_size_(cell_size),
+  orientation_weight_(orientation_weight), num_joints_(0)
+{ }
+
+
+bool IKTrace::read(const std::string& filename)
+{
+  records_.clear();
+  cells_.clear();
+
+  FILE* file = fopen(filename.c_str(), "rb");
+  if (file == NULL)
+  {
+    ROS_ERROR("Could not open IK trace file %s", filename.c_str());
+    return false;
+  }
+
+  int32_t header[3];
+  if (fread(header, sizeof(header), 1, file) != 1 || memcmp(&header[0], MAGIC, sizeof(MAGIC)) != 0
+    || header[1] != VERSION || header[2] <= 0)
+  {
+    ROS_ERROR("%s is not an IK trace file of version %i", filename.c_str(), VERSION);
+    fclose(file);
+    return false;
+  }
+  num_joints_ = header[2];
+
+  RecordHeader header_in;
+  bool is_complete = true;
+  while (fread(&header_in, sizeof(header_in), 1, file) == 1)
+  {
+    IKTraceRecord record;
+    record.position_ << header_in.pose_[0], header_in.pose_[1], header_in.pose_[2];
+    record.orientation_ = Eigen::Quaterniond(header_in.pose_[6], header_in.pose_[3], header_in.pose_[4],
+      header_in.pose_[5]).normalized();
+    record.has_seed_ = (header_in.flags_ & FLAG_HAS_SEED) != 0;
+    record.success_ = (header_in.flags_ & FLAG_SUCCESS) != 0;
+    record.latency_ = header_in.latency_;
+    if (record.has_seed_)
+    {
+      record.seed_.resize(num_joints_);
+      is_complete = fread(&record.seed_[0], sizeof(double), num_joints_, file) == num_joints_;
+    }
+    if (record.success_ && is_complete)
+    {
+      record.joint_positions_.resize(num_joints_);
+      is_complete = fread(&record.joint_positions_[0], sizeof(double), num_joints_, file) == num_joints_;
+    }
+    if (!is_complete)
+      break;
+
+    const int x = (int) floor(record.position_(0) / cell_size_);
+    const int y = (int) floor(record.position_(1) / cell_size_);
+    const int z = (int) floor(record.position_(2) / cell_size_);
+    cells_[calculateGridKey(x, y, z)].push_back(records_.size());
+    records_.push_back(record);
+  }
+  fclose(file);
+
+  // a trace whose writer was killed can end in a partial record, which is ignored
+  if (!is_complete)
+    ROS_WARN("%s ends in an incomplete record", filename.c_str());
+
+  ROS_INFO("Read %i IK requests (%i joints) from %s", size(), num_joints_, filename.c_str());
+  return true;
+}
+
+
+int IKTrace::findNearest(const geometry_msgs::Pose& pose, double max_distance, double& distance) const
+{
+  const Eigen::Vector3d position(pose.position.x, pose.position.y, pose.position.z);
+  const Eigen::Quaterniond orientation = Eigen::Quaterniond(pose.orientation.w, pose.orientation.x,
+    pose.orientation.y, pose.orientation.z).normalized();
+
+  // the position distance is a lower bound of the pose distance, so only the cells within <max_distance> are visited
+  const int x_min = (int) floor((position(0) - max_distance) / cell_size_);
+  const int y_min = (int) floor((position(1) - max_distance) / cell_size_);
+  const int z_min = (int) floor((position(2) - max_distance) / cell_size_);
+  const int x_max = (int) floor((position(0) + max_distance) / cell_size_);
+  const int y_max = (int) floor((position(1) + max_distance) / cell_size_);
+  const int z_max = (int) floor((position(2) + max_distance) / cell_size_);
+
+  int nearest = -1;
+  distance = max_distance;
+  for (int x = x_min; x <= x_max; x++)
+  {
+    for (int y = y_min; y <= y_max; y++)
+    {
+      for (int z = z_min; z <= z_max; z++)
+      {
+        CellMap::const_iterator it = cells_.find(calculateGridKey(x, y, z));
+        if (it == cells_.end())
+          continue;
+
+        const std::vector<int>& indices = it->second;
+        for (int i = 0; i < indices.size(); i++)
+        {
+          const IKTraceRecord& record = records_[indices[i]];
+          const double d = (record.position_ - position).norm()
+            + orientation_weight_ * (1.0 - fabs(record.orientation_.dot(orientation)));
+          if (d <= distance)
+          {
+            distance = d;
+            nearest = indices[i];
+          }
+        }
+      }
+    }
+  }
+
+  return nearest;
+}
@@ -0,0 +1,166 @@
+#include <grasp_selection/ikfast_solver.h>
+
+#include <ros/console.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// the ikfast library is compiled with the same namespace (see CMakeLists.txt)
+#define IKFAST_HAS_LIBRARY
+#define IKFAST_NAMESPACE baxter_ikfast
+#include <ikfast.h>
+
+
+IKFastSolver::IKFastSolver(const urdf::Model& urdf, const std::string& planning_frame, const std::string& base_link,
+  const std::string& tip_link, const std::vector<std::string>& joint_names, double free_joint_step)
+  : IKSolver(baxter_ikfast::GetNumJoints()), base_transform_(Eigen::Affine3d::Identity()),
+    joint_limits_(2, baxter_ikfast::GetNumJoints()), free_joint_(baxter_ikfast::GetFreeParameters()[0]),
+    free_joint_step_(free_joint_step), is_valid_(false)
+{
+  // the base link of the ikfast chain is fixed in the planning frame
+  std::vector<boost::shared_ptr<const urdf::Joint> > joints;
+  if (!collectJoints(urdf, planning_frame, base_link, joints))
+    return;
+
+  for (int i = 0; i < joints.size(); i++)
+  {
+    const urdf::Pose& pose = joints[i]->parent_to_joint_origin_transform;
+    double qx, qy, qz, qw;
+    pose.rotation.getQuaternion(qx, qy, qz, qw);
+    base_transform_ = base_transform_ * Eigen::Translation3d(pose.position.x, pose.position.y, pose.position.z)
+      * Eigen::Quaterniond(qw, qx, qy, qz);
+  }
+
+  // the joint limits of the ikfast chain
+  if (!collectJoints(urdf, base_link, tip_link, joints))
+    return;
+
+  for (int i = 0; i < joints.size(); i++)
+  {
+    if (joints[i]->type == urdf::Joint::FIXED)
+      continue;
+
+    if (joint_names_.size() == num_joints_)
+    {
+      ROS_ERROR("The chain from link %s to link %s has more joints than the ikfast solver", base_link.c_str(),
+        tip_link.c_str());
+      return;
+    }
+
+    const int j = joint_names_.size();
+    joint_names_.push_back(joints[i]->name);
+    joint_limits_(0, j) = joints[i]->limits ? joints[i]->limits->lower : -M_PI;
+    joint_limits_(1, j) = joints[i]->limits ? joints[i]->limits->upper : M_PI;
+  }
+
+  if (joint_names_.size() != num_joints_)
+  {
+    ROS_ERROR("The chain from link %s to link %s has %i joints, the ikfast solver has %i", base_link.c_str(),
+      tip_link.c_str(), (int) joint_names_.size(), num_joints_);
+    return;
+  }
+
+  // the solutions and seeds are reordered from the chain into the given joint order
+  if (!setJointOrder(joint_names_, joint_names))
+    return;
+
+  // without a seed and a joint state, the solution closest to the middle of the joint limits is chosen
+  current_joint_positions_ = 0.5 * (joint_limits_.row(0) + joint_limits_.row(1)).transpose();
+  is_valid_ = true;
+}
+
+
+bool IKFastSolver::solve(const geometry_msgs::PoseStamped& pose, const double* seed, int attempts, double timeout,
+  double* joint_positions)
+{
+  if (!is_valid_)
+    return false;
+
+  // transform the pose into the frame of the base link of the ikfast chain
+  Eigen::Affine3d target = Eigen::Translation3d(pose.pose.position.x, pose.pose.position.y, pose.pose.position.z)
+    * Eigen::Quaterniond(pose.pose.orientation.w, pose.pose.orientation.x, pose.pose.orientation.y,
+      pose.pose.orientation.z);
+  target = base_transform_.inverse() * target;
+  Eigen::Matrix<double, 3, 3, Eigen::RowMajor> rotation = target.rotation();
+  Eigen::Vector3d translation = target.translation();
+
+  Eigen::VectorXd reference = current_joint_positions_;
+  if (seed != NULL)
+    toChainOrder(seed, reference.data());
+
+  // sample the free joint outward from its reference value, like OpenRAVE, and keep the closest solution
+  double best_distance = std::numeric_limits<double>::max();
+  Eigen::VectorXd best(num_joints_);
+  const double lower = joint_limits_(0, free_joint_);
+  const double upper = joint_limits_(1, free_joint_);
+  const double start = std::min(upper, std::max(lower, reference(free_joint_)));
+  solveForFreeValue(translation.data(), rotation.data(), start, reference, best_distance, best);
+  for (int k = 1; start - k * free_joint_step_ >= lower || start + k * free_joint_step_ <= upper; k++)
+  {
+    if (start - k * free_joint_step_ >= lower)
+      solveForFreeValue(translation.data(), rotation.data(), start - k * free_joint_step_, reference, best_distance,
+        best);
+    if (start + k * free_joint_step_ <= upper)
+      solveForFreeValue(translation.data(), rotation.data(), start + k * free_joint_step_, reference, best_distance,
+        best);
+  }
+
+  if (best_distance == std::numeric_limits<double>::max())
+    return false;
+
+  fromChainOrder(best.data(), joint_positions);
+  return true;
+}
+
+
+void IKFastSolver::setJointState(const sensor_msgs::JointState& joint_state)
+{
+  for (int i = 0; i < joint_names_.size(); i++)
+  {
+    std::vector<std::string>::const_iterator it = std::find(joint_state.name.begin(), joint_state.name.end(),
+      joint_names_[i]);
+    if (it != joint_state.name.end() && it - joint_state.name.begin() < joint_state.position.size())
+      current_joint_positions_(i) = joint_state.position[it - joint_state.name.begin()];
+  }
+}
+
+
+Eigen::Affine3d IKFastSolver::calculatePose(const double* joint_positions) const
+{
+  double translation[3];
+  Eigen::Matrix<double, 3, 3, Eigen::RowMajor> rotation;
+  baxter_ikfast::ComputeFk(joint_positions, translation, rotation.data());
+
+  Eigen::Affine3d pose = Eigen::Affine3d::Identity();
+  pose.linear() = rotation;
+  pose.translation() = Eigen::Map<Eigen::Vector3d>(translation);
+  return base_transform_ * pose;
+}
+
+
+void IKFastSolver::solveForFreeValue(const double* translation, const double* rotation, double free_value,
+  const Eigen::VectorXd& reference, double& best_distance, Eigen::VectorXd& best) const
+{
+  ikfast::IkSolutionList<double> solutions;
+  if (!baxter_ikfast::ComputeIk(translation, rotation, &free_value, solutions))
+    return;
+
+  Eigen::VectorXd solution(num_joints_);
+  for (int i = 0; i < solutions.GetNumSolutions(); i++)
+  {
+    solutions.GetSolution(i).GetSolution(solution.data(), &free_value);
+
+    // like OpenRAVE, discard the solutions that violate the joint limits
+    if ((solution.array() < joint_limits_.row(0).transpose().array()).any()
+      || (solution.array() > joint_limits_.row(1).transpose().array()).any())
+      continue;
+
+    double distance = (solution - reference).squaredNorm();
+    if (distance < best_distance)
+    {
+      best_distance = distance;
+      best = solution;
+    }
+  }
+}
@@ -0,0 +1,64 @@
+#include <grasp_selection/memory_usage.h>
+
+#include <cstdio>
+
+
+std::atomic<uint64_t> AllocationCounter::num_allocations_(0);
+std::atomic<uint64_t> AllocationCounter::num_bytes_(0);
+
+
+MemoryProbe::MemoryProbe(MemoryUsage& usage) : usage_(usage), rss_(0), peak_rss_(0)
+{
+  num_allocations_ = AllocationCounter::getNumAllocations();
+  num_bytes_ = AllocationCounter::getNumBytes();
+
+  // reset the peak to the current resident set size ("5" only resets the peak, see proc(5))
+  FILE* file = fopen("/proc/self/clear_refs", "w");
+  if (file != NULL)
+  {
+    fputs("5", file);
+    fclose(file);
+  }
+  readRSS(rss_, peak_rss_);
+}
+
+
+MemoryProbe::~MemoryProbe()
+{
+  uint64_t peak_rss = 0;
+  usage_.num_allocations_ = AllocationCounter::getNumAllocations() - num_allocations_;
+  usage_.num_bytes_ = AllocationCounter::getNumBytes() - num_bytes_;
+  usage_.rss_ = 0;
+  usage_.peak_rss_increase_ = 0;
+  if (readRSS(usage_.rss_, peak_rss))
+    usage_.peak_rss_increase_ = (int64_t) peak_rss - (int64_t) peak_rss_;
+}
+
+
+bool MemoryProbe::readRSS(uint64_t& rss, uint64_t& peak_rss)
+{
+  FILE* file = fopen("/proc/self/status", "r");
+  if (file == NULL)
+    return false;
+
+  // the sizes are given in kB
+  int num_found = 0;
+  char line[128];
+  unsigned long long size;
+  while (num_found < 2 && fgets(line, sizeof(line), file) != NULL)
+  {
+    if (sscanf(line, "VmHWM: %llu kB", &size) == 1)
+    {
+      peak_rss = 1024 * size;
+      num_found++;
+    }
+    else if (sscanf(line, "VmRSS: %llu kB", &size) == 1)
+    {
+      rss = 1024 * size;
+      num_found++;
+    }
+  }
+
+  fclose(file);
+  return num_found == 2;
+}
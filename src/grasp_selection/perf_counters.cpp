@@ -0,0 +1,79 @@
+#include <grasp_selection/perf_counters.h>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+
+PerfCounters::PerfCounters() : num_open_(0)
+{
+  static const uint64_t events[NUM_COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+  std::fill(fds_, fds_ + NUM_COUNTERS, -1);
+
+  for (int i = 0; i < NUM_COUNTERS; i++)
+  {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = events[i];
+    attr.disabled = (i == CYCLES); // the group starts when its leader is enabled
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    // the calling thread on any CPU; without the cycle counter, there is no group to add the others to
+    fds_[i] = syscall(__NR_perf_event_open, &attr, 0, -1, fds_[CYCLES], 0);
+    if (fds_[CYCLES] < 0)
+      return;
+    if (fds_[i] >= 0)
+      num_open_++;
+  }
+
+  ioctl(fds_[CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(fds_[CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+
+PerfCounters::~PerfCounters()
+{
+  for (int i = 0; i < NUM_COUNTERS; i++)
+  {
+    if (fds_[i] >= 0)
+      close(fds_[i]);
+  }
+}
+
+
+void PerfCounters::read(Values& values) const
+{
+  std::fill(values.counts_, values.counts_ + NUM_COUNTERS, 0);
+  if (!isAvailable())
+    return;
+
+  // the number of counters, the times the group was enabled and running, and the value of each open counter
+  uint64_t buffer[3 + NUM_COUNTERS];
+  const ssize_t size = (3 + num_open_) * sizeof(uint64_t);
+  if (::read(fds_[CYCLES], buffer, size) != size || buffer[0] != num_open_)
+    return;
+
+  // if the counters were multiplexed, extrapolate them to the whole time they were enabled
+  const double scale = (buffer[2] > 0 && buffer[2] < buffer[1]) ? (double) buffer[1] / buffer[2] : 1.0;
+  for (int i = 0, j = 3; i < NUM_COUNTERS; i++)
+  {
+    if (fds_[i] >= 0)
+      values.counts_[i] = (uint64_t) (scale * buffer[j++]);
+  }
+}
+
+
+const char* PerfCounters::getCounterName(Counter counter)
+{
+  static const char* names[NUM_COUNTERS] = {"cycles", "instructions", "cache_misses", "branch_misses"};
+  return names[counter];
+}
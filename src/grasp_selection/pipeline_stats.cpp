@@ -0,0 +1,164 @@
+#include <grasp_selection/pipeline_stats.h>
+
+#include <algorithm>
+#include <cmath>
+
+
+LatencyHistogram::LatencyHistogram() : counts_(calculateBucket(UINT64_MAX) + 1, 0), count_(0), sum_(0), max_(0)
+{ }
+
+
+void LatencyHistogram::record(uint64_t nanoseconds)
+{
+  counts_[calculateBucket(nanoseconds)]++;
+  count_++;
+  sum_ += nanoseconds;
+  max_ = std::max(max_, nanoseconds);
+}
+
+
+void LatencyHistogram::add(const LatencyHistogram& other)
+{
+  for (int i = 0; i < counts_.size(); i++)
+    counts_[i] += other.counts_[i];
+  count_ += other.count_;
+  sum_ += other.sum_;
+  max_ = std::max(max_, other.max_);
+}
+
+
+void LatencyHistogram::reset()
+{
+  std::fill(counts_.begin(), counts_.end(), 0);
+  count_ = 0;
+  sum_ = 0;
+  max_ = 0;
+}
+
+
+double LatencyHistogram::calculatePercentile(double percentile) const
+{
+  if (count_ == 0)
+    return 0.0;
+
+  // find the bucket that contains the latency of the given rank
+  uint64_t rank = std::max((uint64_t) 1, (uint64_t) ceil(percentile / 100.0 * count_));
+  if (rank >= count_)
+    return getMax();
+  
+  uint64_t num_counted = 0;
+  for (int i = 0; i < counts_.size(); i++)
+  {
+    num_counted += counts_[i];
+    if (num_counted >= rank)
+    {
+      // report the middle of the bucket, but never more than the largest latency
+      uint64_t lower = calculateLowerBound(i);
+      uint64_t upper = (i + 1 < counts_.size()) ? calculateLowerBound(i + 1) : max_;
+      return 1e-9 * std::min(max_, lower + (upper - lower) / 2);
+    }
+  }
+
+  return getMax();
+}
+
+
+int LatencyHistogram::calculateBucket(uint64_t nanoseconds)
+{
+  // the latencies below 2 * NUM_SUB_BUCKETS nanoseconds have a bucket each
+  if (nanoseconds < 2 * NUM_SUB_BUCKETS)
+    return nanoseconds;
+
+  // for larger latencies, the leading bits after the most significant bit select the sub-bucket
+  int shift = 63 - __builtin_clzll(nanoseconds) - SUB_BUCKET_BITS;
+  int sub_bucket = (nanoseconds >> shift) - NUM_SUB_BUCKETS;
+  return (shift + 1) * NUM_SUB_BUCKETS + sub_bucket;
+}
+
+
+uint64_t LatencyHistogram::calculateLowerBound(int bucket)
+{
+  if (bucket < 2 * NUM_SUB_BUCKETS)
+    return bucket;
+
+  int shift = bucket / NUM_SUB_BUCKETS - 1;
+  uint64_t sub_bucket = bucket % NUM_SUB_BUCKETS;
+  return (NUM_SUB_BUCKETS + sub_bucket) << shift;
+}
+
+
+const char* PipelineStats::getStageName(Stage stage)
+{
+  static const char* names[NUM_STAGES] = {"cloud_conversion", "voxelization", "scene_indexing", "filtering",
+    "pose_generation", "inverse_kinematics", "collision_checking", "scoring", "trajectory_planning", "visualization",
+    "response"};
+  return names[stage];
+}
+
+
+bool PipelineStats::enablePerfCounters()
+{
+  if (counters_ != NULL)
+    return true;
+  
+  counters_ = new PerfCounters;
+  if (counters_->isAvailable())
+    return true;
+  
+  delete counters_;
+  counters_ = NULL;
+  return false;
+}
+
+
+void PipelineStats::startRequest()
+{
+  if (counters_ == NULL)
+    return;
+
+  for (int i = 0; i < NUM_STAGES; i++)
+    std::fill(request_counts_[i].counts_, request_counts_[i].counts_ + PerfCounters::NUM_COUNTERS, 0);
+  counters_->read(request_start_);
+}
+
+
+void PipelineStats::endRequest()
+{
+  if (counters_ == NULL)
+    return;
+
+  PerfCounters::Values end;
+  counters_->read(end);
+  for (int i = 0; i < PerfCounters::NUM_COUNTERS; i++)
+    request_total_.counts_[i] = end.counts_[i] - request_start_.counts_[i];
+}
+
+
+void RejectionCounts::reset()
+{
+  num_grasps_ = 0;
+  num_candidates_ = 0;
+  num_reachable_ = 0;
+  std::fill(rejected_, rejected_ + NUM_CHECKS, 0);
+  std::fill(rejected_time_, rejected_time_ + NUM_CHECKS, 0);
+}
+
+
+void RejectionCounts::add(const RejectionCounts& other)
+{
+  num_grasps_ += other.num_grasps_;
+  num_candidates_ += other.num_candidates_;
+  num_reachable_ += other.num_reachable_;
+  for (int i = 0; i < NUM_CHECKS; i++)
+  {
+    rejected_[i] += other.rejected_[i];
+    rejected_time_[i] += other.rejected_time_[i];
+  }
+}
+
+
+const char* RejectionCounts::getCheckName(Check check)
+{
+  static const char* names[NUM_CHECKS] = {"workspace", "aperture", "inverse_kinematics", "collision", "approach"};
+  return names[check];
+}
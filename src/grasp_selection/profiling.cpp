@@ -0,0 +1,39 @@
+#include <grasp_selection/profiling.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+
+std::atomic<ProfileSite*> ProfileSite::first_(NULL);
+
+
+ProfileSite::ProfileSite(const char* name) : name_(name), count_(0), total_(0), max_(0)
+{
+  // push the site onto the list without a lock (a site is constructed once, the first time it is executed)
+  next_ = first_.load(std::memory_order_relaxed);
+  while (!first_.compare_exchange_weak(next_, this, std::memory_order_release, std::memory_order_relaxed))
+    ;
+}
+
+
+void ProfileSite::printReport()
+{
+  std::vector<const ProfileSite*> sites;
+  for (const ProfileSite* site = getFirst(); site != NULL; site = site->getNext())
+    sites.push_back(site);
+  if (sites.empty())
+    return;
+
+  std::sort(sites.begin(), sites.end(), [](const ProfileSite* a, const ProfileSite* b)
+    { return a->getTotal() > b->getTotal(); });
+
+  printf("%-45s %10s %12s %12s %12s\n", "profile site", "count", "total (ms)", "mean (ms)", "max (ms)");
+  for (int i = 0; i < sites.size(); i++)
+  {
+    const ProfileSite* site = sites[i];
+    const uint64_t count = site->getCount();
+    printf("%-45s %10llu %12.3f %12.4f %12.4f\n", site->getName(), (unsigned long long) count, 1e3 * site->getTotal(),
+      (count > 0) ? 1e3 * site->getTotal() / count : 0.0, 1e3 * site->getMax());
+  }
+}
@@ -1,312 +1,234 @@
 #include <grasp_selection/reaching.h>
 
 
-Reaching::Reaching(const Parameters& params, ros::NodeHandle& node) : params_(params), cloud_(new PointCloud)
+Reaching::Reaching(const Parameters& params, IKSolver* ik_solver) : params_(params), ik_solver_(ik_solver), 
+  scene_index_(NULL), stats_(NULL), rejections_(NULL), num_joints_(ik_solver->getNumJoints()), 
+  pose_kernel_(params.axis_order_, params.hand_offset_), ik_joint_positions_(num_joints_)
 {
-	// wait for Inverse Kinematics service
-  if (params_.planning_lib_ == Reaching::MOVE_IT)
-    ik_service_ = node.serviceClient<moveit_msgs::GetPositionIK>("/compute_ik");
-  else if (params_.planning_lib_ == Reaching::OPEN_RAVE)
-    ik_service_ = node.serviceClient<grasp_selection::SolveIK>("/ikfast_solver");
+  // the pre-grasp poses are solved from the grasp pose outward
+  std::sort(params_.pregrasp_offsets_.begin(), params_.pregrasp_offsets_.end());
   
-  while (!ik_service_.exists())
-  {
-    ROS_INFO("Waiting for Inverse Kinematics service ...");
-    ros::Duration(1.0).sleep();
-  }
-  ROS_INFO("Inverse Kinematics service is available");
+  // record the IK requests so that they can be replayed without the solver (see ik_replay_node)
+  if (!params_.ik_trace_file_.empty())
+    ik_solver_ = new RecordingIKSolver(ik_solver_, params_.ik_trace_file_);
+}
+
+
+void Reaching::selectFeasibleGrasps(const agile_grasp::Grasps& grasps_in, CandidateStore& grasps_out, Arena& arena)
+{
+  // use fixed-size joint types for the Baxter arm, and dynamically sized ones for all other arms
+  if (num_joints_ == BAXTER_NUM_JOINTS)
+    selectFeasibleGrasps<BAXTER_NUM_JOINTS>(grasps_in, grasps_out, arena);
+  else
+    selectFeasibleGrasps<Eigen::Dynamic>(grasps_in, grasps_out, arena);
 }
 
 
-std::vector<GraspScored> Reaching::selectFeasibleGrasps(const agile_grasp::Grasps& grasps_in)
+template <int DOF>
+void Reaching::selectFeasibleGrasps(const agile_grasp::Grasps& grasps_in, CandidateStore& grasps_out, Arena& arena)
 {
-	std::vector<GraspScored> grasps_selected;
+  PROFILE_SCOPE("Reaching::selectFeasibleGrasps");
+  grasps_out.reset(num_joints_, params_.pregrasp_offsets_.size());
+  grasps_out.reserve(2 * grasps_in.grasps.size());
+  ArenaVector<double> pregrasp_joint_positions(params_.pregrasp_offsets_.size() * num_joints_, 0.0, 
+    ArenaAllocator<double>(&arena));
+  
+  // approach angles for the additional grasps
+  ArenaVector<double> theta(1, 0.0, ArenaAllocator<double>(&arena));
+  if (params_.num_additional_grasps_ > 0)
+  {
+    theta.resize(1 + params_.num_additional_grasps_);
+    for (int j = 0; j < theta.size(); j++)
+      theta[j] = -15.0 + 30.0 * j / params_.num_additional_grasps_;
+  }
+  
+  // decode all grasps and keep the ones that lie within the workspace and fit into the robot hand
+  StageTimer filter_timer(stats_, PipelineStats::FILTERING);
+  GraspArrays all_grasps(grasps_in, arena);
+  GraspArrays::Mask mask(arena.allocateArray<bool>(all_grasps.size()), all_grasps.size());
+  filterGrasps(all_grasps, mask);
+  GraspArrays grasps = all_grasps.select(mask, arena);
+  filter_timer.stop();
+  if (rejections_ != NULL)
+    rejections_->addCandidates(2 * grasps.size() * theta.size());
+  
+  // calculate the robot hand poses for all remaining grasps and approach angles in one batch
+  CandidatePoses poses(grasps.size(), theta.size(), arena);
+  {
+    StageTimer timer(stats_, PipelineStats::POSE_GENERATION);
+    pose_kernel_.calculatePoses(grasps, theta, poses, arena);
+  }
 		
 	// evaluate the reachability of each grasp
-	for (int i = 0; i < grasps_in.grasps.size(); i++)
+	for (int i = 0; i < grasps.size(); i++)
   {
-    const agile_grasp::Grasp& grasp = grasps_in.grasps[i];
-    
-    // check whether grasp lies within the workspace of the robot arm
-    ROS_INFO_COND(params_.is_printing_, "Checking if grasp %i, position (%1.2f, %1.2f, %1.2f), can be reached: ", i, 
-      grasp.center.x, grasp.center.y, grasp.center.z);    
-		if (!isInWorkspace(grasp.surface_center.x, grasp.surface_center.y, grasp.surface_center.z))
-		{
-      ROS_INFO_COND(params_.is_printing_, " NOT OK!");
-			continue;
-		}
-		ROS_INFO_COND(params_.is_printing_, " OK");
-
-    // avoid objects that are smaller/larger than the minimum/maximum robot hand aperture
-    ROS_INFO_COND(params_.is_printing_, "Checking aperture: ");
-    if (grasp.width.data < params_.min_aperture_ || grasp.width.data > params_.max_aperture_)
-    {
-      ROS_INFO_COND(params_.is_printing_, "too small/large for the hand (min, max): %.4f (%.4f, %.4f)!", 
-        grasp.width.data, params_.min_aperture_, params_.max_aperture_);
-      continue;
-    }
-    ROS_INFO_COND(params_.is_printing_, " OK");
-    
-    GraspEigen grasp_eigen(grasp);
-    
-    // generate additional grasps
-    Eigen::VectorXd theta;
-    if (params_.num_additional_grasps_ > 0)
-    {
-      theta = Eigen::VectorXd::LinSpaced(1 + params_.num_additional_grasps_, -15.0, 15.0);
-    }
-    else
-    {
-      theta.resize(1);
-      theta << 0.0;
-    }
-    
     // check all grasps for reachability
     for (int j = 0; j < theta.size(); j++)
     {
-			ROS_INFO_COND(params_.is_printing_, "j: %i", j);
-      
-      // calculate approach vector and hand axis for the new grasp
-			GraspEigen grasp_eigen_rot = rotateGrasp(grasp_eigen, theta[j]);
+      const int pose_index = poses.index(i, j);
+      const Eigen::Vector3d position = poses.positions_.row(pose_index).matrix().transpose();
+      const Eigen::Vector3d approach = poses.approaches_.row(pose_index).matrix().transpose();
 		
-			// create a grasp for each hand orientation and check whether they are reachable by the IK and collision-free
-      std::vector<tf::Quaternion> quats = calculateHandOrientations(grasp_eigen_rot);
+			// check each hand orientation for reachability by the IK and collisions
       bool is_collision_free = false;      
-      for (int k = 0; k < quats.size(); k++)
+      for (int k = 0; k < 2; k++)
       {
-        ROS_INFO_COND(params_.is_printing_, "k: %i", k);
+        TraceScope candidate_scope(stats_ != NULL ? stats_->getTraceRecorder() : NULL, "candidate", grasps.ids_[i]);
+        PipelineStats::Clock::time_point candidate_start = PipelineStats::Clock::now();
         
         // create grasp pose
-        geometry_msgs::PoseStamped grasp_pose = createGraspPose(grasp_eigen_rot, quats[k], theta[j]);
+        const Eigen::Quaterniond orientation = poses.getOrientation(pose_index, k);
+        geometry_msgs::PoseStamped& grasp_pose = grasp_pose_;
+        createGraspPose(position, orientation, grasp_pose);
         
         // try to solve IK
-        ROS_INFO_COND(params_.is_printing_, " Solving IK: ");
-        double tik0 = omp_get_wtime();
-        IKSolution ik_solution = solveIK(grasp_pose);        
-        ROS_INFO_COND(params_.is_printing_, " IK runtime: %.2f", omp_get_wtime() - tik0);
-				if (!ik_solution.success_) // IK fails
+        double* joint_positions = &ik_joint_positions_[0];
+				if (!solveIK(grasp_pose, joint_positions)) // IK fails
 				{
-					ROS_INFO_COND(params_.is_printing_, "IK failed for grasp %i, approach %i, orientation %i!\n", i, j, k);
+					ASYNC_LOG_DEBUG(AsyncLogger::REACHING, "IK failed for grasp %i, approach %i, orientation %i!", 
+            grasps.ids_[i], j, k);
+          recordRejection(RejectionCounts::INVERSE_KINEMATICS, candidate_start);
 					continue;
 				}
-        ROS_INFO_COND(params_.is_printing_, " OK");
         
         // check collisions (only required for one orientation/quaternion)
-        ROS_INFO_COND(params_.is_printing_, " Checking collisions: ");
         if (!is_collision_free)
         {
-          double tcoll0 = omp_get_wtime();
-					is_collision_free = isCollisionFree(grasp_pose, grasp_eigen_rot.approach_);
-          ROS_INFO_COND(params_.is_printing_, " Collision checker runtime: %.2f", omp_get_wtime() - tcoll0);
+					is_collision_free = isCollisionFree(position, approach);
 					if (!is_collision_free)
 					{
-						ROS_INFO_COND(params_.is_printing_, "Grasp %i, approach %i, orientation %i collides with point cloud!\n", i,
-              j, k);
+						ASYNC_LOG_DEBUG(AsyncLogger::REACHING, "Grasp %i, approach %i, orientation %i collides with point "
+              "cloud!", grasps.ids_[i], j, k);
+            recordRejection(RejectionCounts::COLLISION, candidate_start);
 						continue;
 					}
 				}
-        ROS_INFO_COND(params_.is_printing_, " OK");
-				        
-				if (params_.is_printing_)
+        
+        // check that the pre-grasp poses are reachable on a continuous path in joint space
+        if (!solvePregraspIK<DOF>(position, orientation, approach, joint_positions, 
+          pregrasp_joint_positions.data()))
         {
-          std::cout << "IK solution: ";
-          for(int t=0; t < ik_solution.joint_positions_.size(); t++)
-            std::cout << ik_solution.joint_positions_[t] << " ";
-          std::cout << std::endl;
+          ASYNC_LOG_DEBUG(AsyncLogger::REACHING, "Pre-grasp IK failed or is discontinuous for grasp %i, approach %i, "
+            "orientation %i!", grasps.ids_[i], j, k);
+          recordRejection(RejectionCounts::APPROACH, candidate_start);
+          continue;
         }
+				        
+        ASYNC_LOG_DEBUG(AsyncLogger::REACHING, "Grasp %i, approach %i, orientation %i is reachable", grasps.ids_[i], 
+          j, k);
         
         // create grasp based on inverse kinematics solution
-				GraspScored grasp_scored(i, grasp_pose, grasp_eigen_rot.approach_, grasp.width.data, ik_solution.joint_positions_, 0.0);
-				grasps_selected.push_back(grasp_scored);
+				grasps_out.add(grasps.ids_[i], position, orientation, approach, grasps.widths_(i), 
+          joint_positions, pregrasp_joint_positions.data());
+        if (rejections_ != NULL)
+          rejections_->addReachable(1);
       }
 		}
 	}
-	
-	return grasps_selected;
 }
 
 
-bool Reaching::isInWorkspace(double x, double y, double z)
+void Reaching::filterGrasps(const GraspArrays& grasps, GraspArrays::Mask& mask)
 {
-	if (x >= params_.workspace_[0] && x <= params_.workspace_[1] && y >= params_.workspace_[2] 
-		&& y <= params_.workspace_[3]	&& z >= params_.workspace_[4] && z <= params_.workspace_[5])
-	{
-		return true;
-	}
-	
-	return false;
-}
-
-
-Reaching::GraspEigen Reaching::rotateGrasp(const GraspEigen& grasp_in, double theta)
-{
-	GraspEigen grasp_out;
-	
-	Eigen::Transform<double, 3, Eigen::Affine> R(Eigen::AngleAxis<double>(theta * (M_PI / 180.0), grasp_in.binormal_));
-	grasp_out.axis_ = R * grasp_in.axis_;
-	grasp_out.approach_ = R * (-1.0 * grasp_in.approach_);	
-	
-	grasp_out.binormal_ = grasp_out.axis_.cross(grasp_out.approach_);
-	grasp_out.center_ = grasp_in.center_;
-	
-	return grasp_out;
-}
-
-
-std::vector<tf::Quaternion> Reaching::calculateHandOrientations(const GraspEigen& grasp)
-{
-  // calculate first hand orientation
-  Eigen::Matrix3d R = Eigen::MatrixXd::Zero(3, 3);
-  R.col(0) = -1.0 * grasp.approach_;
-  R.col(1) = grasp.axis_;
-  R.col(2) << R.col(0).cross(R.col(1));
-	
-	// rotate by 180deg around the grasp approach vector to get the "opposite" hand orientation
-	Eigen::Transform<double, 3, Eigen::Affine> T(Eigen::AngleAxis<double>(M_PI, grasp.approach_));
-	
-	// calculate second hand orientation
-  Eigen::Matrix3d Q = Eigen::MatrixXd::Zero(3, 3);
-  Q.col(0) = T * grasp.approach_;
-  Q.col(1) = T * grasp.axis_;
-  Q.col(2) << Q.col(0).cross(Q.col(1));
+  PROFILE_SCOPE("Reaching::filterGrasps");
+  const GraspArrays::Array3& p = grasps.surface_centers_;
+  const std::vector<double>& ws = params_.workspace_;
   
-  // reorder rotation matrix columns according to axes ordering of the robot hand
-  Eigen::Matrix3d R1 = reorderHandAxes(R);
-  Eigen::Matrix3d R2 = reorderHandAxes(Q);
-	
-	// convert Eigen rotation matrices to TF quaternions and normalize them
-	tf::Matrix3x3 TF1, TF2;
-  tf::matrixEigenToTF(R1, TF1);
-  tf::matrixEigenToTF(R2, TF2);
-  tf::Quaternion quat1, quat2;
-  TF1.getRotation(quat1);
-  TF2.getRotation(quat2);
-  quat1.normalize();
-  quat2.normalize();
-		
-	std::vector<tf::Quaternion> quats;
-	quats.push_back(quat1);
-	quats.push_back(quat2);
+  // check whether grasps lie within the workspace of the robot arm, and avoid objects that are smaller/larger than 
+  // the minimum/maximum robot hand aperture
+  auto in_workspace = (p.col(0) >= ws[0]) && (p.col(0) <= ws[1]) && (p.col(1) >= ws[2]) && (p.col(1) <= ws[3]) 
+    && (p.col(2) >= ws[4]) && (p.col(2) <= ws[5]);
+  mask = in_workspace && (grasps.widths_ >= params_.min_aperture_) && (grasps.widths_ <= params_.max_aperture_);
   
-  // for debugging
-  //tf::TransformBroadcaster br;
-  //tf::Transform transform;
-  //transform.setOrigin( tf::Vector3(grasp.center_(0), grasp.center_(1), grasp.center_(2)) );
-  //transform.setRotation( quat1 );
-  //br.sendTransform(tf::StampedTransform(transform, ros::Time::now(), "base", "carrot1"));
-  //ros::Duration(1.0).sleep();
-  //transform.setRotation( quat2 );
-  //br.sendTransform(tf::StampedTransform(transform, ros::Time::now(), "base", "carrot2"));
-  //ros::Duration(1.0).sleep();
-  //std::cout << "transform:\n" << transform.getOrigin() << std::endl;
+  // the grasps outside the workspace are counted for the workspace check, even if they do not fit into the hand
+  if (rejections_ != NULL)
+  {
+    const int num_in_workspace = in_workspace.count();
+    rejections_->addGrasps(grasps.size());
+    rejections_->reject(RejectionCounts::WORKSPACE, grasps.size() - num_in_workspace);
+    rejections_->reject(RejectionCounts::APERTURE, num_in_workspace - mask.count());
+  }
   
-	return quats;
-}
-
-
-Eigen::Matrix3d Reaching::reorderHandAxes(const Eigen::Matrix3d& Q)
-{
-  Eigen::Matrix3d R = Eigen::MatrixXd::Zero(3, 3);
-  R.col(params_.axis_order_[0]) = Q.col(0); // grasp approach vector
-  R.col(params_.axis_order_[1]) = Q.col(1); // hand axis
-  R.col(params_.axis_order_[2]) = Q.col(2); // hand binormal
-  return R;
+  if (AsyncLogger::getInstance().isEnabled(AsyncLogger::REACHING, AsyncLogger::LEVEL_DEBUG))
+  {
+    for (int i = 0; i < grasps.size(); i++)
+    {
+      if (!mask(i))
+        ASYNC_LOG_DEBUG(AsyncLogger::REACHING, "Grasp %i, position (%1.2f, %1.2f, %1.2f), width %.4f, is outside "
+          "the workspace or too small/large for the hand (min, max): (%.4f, %.4f)!", grasps.ids_[i], grasps.centers_(i, 0), grasps.centers_(i, 1), 
+          grasps.centers_(i, 2), grasps.widths_(i), params_.min_aperture_, params_.max_aperture_);
+    }
+  }
+  ASYNC_LOG_DEBUG(AsyncLogger::REACHING, "%i of %i grasps lie within the workspace and fit into the hand", 
+    (int) mask.count(), grasps.size());
 }
 
 
-geometry_msgs::PoseStamped Reaching::createGraspPose(const GraspEigen& grasp, const tf::Quaternion& quat, double theta)
+void Reaching::createGraspPose(const Eigen::Vector3d& position, const Eigen::Quaterniond& orientation, 
+  geometry_msgs::PoseStamped& pose_st)
 {  
-  // calculate grasp position
-  Eigen::Vector3d position = grasp.center_;
-  Eigen::Vector3d approach = -1.0 * grasp.approach_;
-    
-	// translate grasp position by <hand_offset_> along the grasp approach vector
-	position = position + params_.hand_offset_ * approach;
-  		
-	geometry_msgs::PoseStamped pose_st;
 	pose_st.header.stamp = ros::Time(0);
   pose_st.header.frame_id = params_.planning_frame_;
   tf::pointEigenToMsg(position, pose_st.pose.position);
-  tf::quaternionTFToMsg(quat, pose_st.pose.orientation);
-    
-	return pose_st;
+  tf::quaternionEigenToMsg(orientation, pose_st.pose.orientation);
 }
 
 
-Reaching::IKSolution Reaching::solveIK(const geometry_msgs::PoseStamped& pose, int attempts, double timeout)
+bool Reaching::solveIK(const geometry_msgs::PoseStamped& pose, double* joint_positions, const double* seed, 
+  int attempts, double timeout)
 {
-  IKSolution ik;
-  
-  if (params_.planning_lib_ == Reaching::MOVE_IT)
-  {
-    moveit_msgs::GetPositionIK::Response resp = solveIKMoveIt(pose, attempts, timeout);
-    if (resp.error_code.val == resp.error_code.NO_IK_SOLUTION)
-    {
-      ik.success_ = false;
-      ik.joint_positions_.resize(0);
-    }
-    else
-    {
-      ik.success_ = true;
-      ik.joint_positions_ = extractJointPositions(resp);
-    }
-  }
-  else if (params_.planning_lib_ == Reaching::OPEN_RAVE)
-  {
-    grasp_selection::SolveIK::Response resp = solveIKOpenRave(pose);
-    ik.success_ = resp.success;
-    ik.joint_positions_ = resp.solution;
-  }
-    
-  return ik;
+  PROFILE_SCOPE("Reaching::solveIK");
+  StageTimer timer(stats_, PipelineStats::INVERSE_KINEMATICS);
+  const uint64_t num_allocations = AllocationCounter::getNumAllocations();
+  const bool success = ik_solver_->solve(pose, seed, attempts, timeout, joint_positions);
+  if (stats_ != NULL)
+    stats_->addIKAllocations(AllocationCounter::getNumAllocations() - num_allocations);
+  return success;
 }
 
 
-grasp_selection::SolveIK::Response Reaching::solveIKOpenRave(const geometry_msgs::PoseStamped& pose)
+template <int DOF>
+bool Reaching::solvePregraspIK(const Eigen::Vector3d& position, const Eigen::Quaterniond& orientation, 
+  const Eigen::Vector3d& approach, const double* grasp_joint_positions, double* pregrasp_joint_positions)
 {
-  // create IK request
-  grasp_selection::SolveIK::Request req;
-  req.target_pose = pose.pose;
+  PROFILE_SCOPE("Reaching::solvePregraspIK");
+  const double* previous = grasp_joint_positions;
   
-  // solve IK
-  grasp_selection::SolveIK::Response resp;
-  ik_service_.call(req, resp);  
-  return resp;
-}
-
-
-moveit_msgs::GetPositionIK::Response Reaching::solveIKMoveIt(const geometry_msgs::PoseStamped& pose, int attempts, 
-	double timeout)
-{
-  // create IK request
-  moveit_msgs::GetPositionIK::Request request;
-  request.ik_request.group_name = params_.move_group_;
-  request.ik_request.attempts = attempts;
-  request.ik_request.timeout = ros::Duration(timeout);
-  request.ik_request.pose_stamped = pose;
-  request.ik_request.pose_stamped.header.stamp = ros::Time::now();
-  request.ik_request.ik_link_name = params_.arm_link_;
-  request.ik_request.avoid_collisions = false;
+  for (int p = 0; p < params_.pregrasp_offsets_.size(); p++)
+  {
+    // the pre-grasp pose lies behind the grasp pose along the approach direction
+    createGraspPose(position - params_.pregrasp_offsets_[p] * approach, orientation, grasp_pose_);
+    
+    // start from the solution for the previous pose along the approach to stay in the same IK branch
+    double* current = pregrasp_joint_positions + p * num_joints_;
+    if (!solveIK(grasp_pose_, current, previous))
+      return false;
+    
+    // a large change of a joint (e.g., a joint flip) means that the arm cannot follow the approach
+    double step = calculateMaxJointStep<DOF>(previous, current, num_joints_);
+    ASYNC_LOG_DEBUG(AsyncLogger::REACHING, "Pre-grasp offset: %.3f, max. joint step: %.3f", 
+      params_.pregrasp_offsets_[p], step);
+    if (step > params_.max_joint_step_)
+      return false;
+    
+    previous = current;
+  }
   
-  //std::cout << "IK Request:\n" << request << std::endl;
-
-  // solve IK
-  moveit_msgs::GetPositionIK::Response response;
-  ik_service_.call(request, response);
-  return response;
+  return true;
 }
 
 
-bool Reaching::isCollisionFree(const geometry_msgs::PoseStamped& pose_st, const Eigen::Vector3d& approach)
+bool Reaching::isCollisionFree(const Eigen::Vector3d& position, const Eigen::Vector3d& approach)
 {
+  PROFILE_SCOPE("Reaching::isCollisionFree");
+  StageTimer timer(stats_, PipelineStats::COLLISION_CHECKING);
 	const double R = 0.06; // radius of cylinder
   const double L = 0.1; // height of cylinder
   const double OFFSET = 0.005; // used to compensate invalid sensor measurements on object sides
   double r2 = R * R;
 
   // calculate lower and upper cylinder caps
-  Eigen::Vector3d c0;
-  tf::pointMsgToEigen(pose_st.pose.position, c0);
+  const Eigen::Vector3d& c0 = position;
   Eigen::Vector3d c1 = c0 - L * approach;
   Eigen::Vector3d c = c0 + 0.5 * (c1 - c0);
 
@@ -314,31 +236,30 @@ bool Reaching::isCollisionFree(const geometry_msgs::PoseStamped& pose_st, const
   Eigen::Vector3d n = -1.0 * approach;
   Eigen::Vector3d s = c - OFFSET * approach;
   
-  // check each point in point cloud against collision cylinder
+  if (scene_index_ == NULL)
+    return true;
+  
+  // only check the points in the grid cells that overlap the bounding box of the collision cylinder
+  Eigen::Vector3d min = c0.cwiseMin(c1) - Eigen::Vector3d::Constant(R);
+  Eigen::Vector3d max = c0.cwiseMax(c1) + Eigen::Vector3d::Constant(R);
   int k = 0;
-  for (int j = 0; j < cloud_->size(); j++)
+  int num_points = 0;
+  bool is_free = scene_index_->visitPoints(min, max, [&](const Eigen::Vector3d& p)
   {
-    Eigen::Vector3d p = (cloud_->points[j].getVector3fMap()).cast<double>();
-
+    num_points++;
+    
     // check whether point lies on side of plane (s,n) that points toward upper cylinder cap and between lower and 
     // upper cylinder cap, and compare distance(point,cylinder_axis)^2 with radius^2
     if (n.dot(p - s) < 0 && approach.dot(p - c0) < 0 && approach.dot(p - c1) > 0
         && (((p - c) - (p - c).dot(approach) * approach).squaredNorm() <= r2))
     {
       k++;
-      if (k > params_.max_colliding_points_)
-        return false;
     }
-  }
+    return k <= params_.max_colliding_points_;
+  });
   
-	return true;
+  if (stats_ != NULL)
+    stats_->addCollisionPoints(num_points);
+  return is_free;
 }
 
-
-std::vector<double> Reaching::extractJointPositions(const moveit_msgs::GetPositionIK::Response& ik_response)
-{
-	int num_joints = params_.ik_last_joint_index_ - params_.ik_first_joint_index_ + 1;  
-  std::vector<double> joint_positions(ik_response.solution.joint_state.position.begin() + params_.ik_first_joint_index_, 
-		ik_response.solution.joint_state.position.begin() + params_.ik_first_joint_index_ + num_joints);
-	return joint_positions;
-}
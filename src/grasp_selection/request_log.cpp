@@ -0,0 +1,314 @@
+#include <grasp_selection/request_log.h>
+
+#include <ros/serialization.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+
+namespace
+{
+
+const char MAGIC[4] = {'G', 'S', 'R', 'L'};
+const int32_t VERSION = 2;
+const uint32_t FILE_HEADER_SIZE = 2 * sizeof(int32_t);
+const uint32_t ENTRY_HEADER_SIZE = 2 * sizeof(uint32_t);
+const double MIN_RETRY_DELAY = 1.0;
+const double MAX_RETRY_DELAY = 60.0;
+
+/** Return the name of a log file. */
+std::string getFilename(const std::string& directory, int number)
+{
+  char name[32];
+  snprintf(name, sizeof(name), "/requests_%06d.log", number);
+  return directory + name;
+}
+
+}
+
+
+RequestLogWriter::RequestLogWriter(const Parameters& params, const grasp_selection::ParametersRecord& node_params)
+  : params_(params), fd_(-1), data_(NULL), size_(0), retry_time_(std::chrono::steady_clock::now()),
+    retry_delay_(MIN_RETRY_DELAY), scene_id_(0), request_id_(0), num_dropped_(0)
+{
+  params_.num_files_ = std::max(params_.num_files_, 1);
+  mkdir(params_.directory_.c_str(), 0755);
+
+  // the parameters do not change, so they are serialized once for all files
+  namespace ser = ros::serialization;
+  const uint32_t size = ser::serializationLength(node_params);
+  parameters_.resize(ENTRY_HEADER_SIZE + size);
+  const uint32_t header[2] = {ENTRY_PARAMETERS, size};
+  memcpy(&parameters_[0], header, sizeof(header));
+  ser::OStream stream(&parameters_[ENTRY_HEADER_SIZE], size);
+  ser::serialize(stream, node_params);
+
+  // continue after the files of earlier runs, which count towards the maximum number of files
+  DIR* dir = opendir(params_.directory_.c_str());
+  if (dir != NULL)
+  {
+    std::vector<int> numbers;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+      int number;
+      char suffix[8];
+      if (sscanf(entry->d_name, "requests_%d.%7s", &number, suffix) == 2 && strcmp(suffix, "log") == 0)
+        numbers.push_back(number);
+    }
+    closedir(dir);
+    std::sort(numbers.begin(), numbers.end());
+    file_numbers_.assign(numbers.begin(), numbers.end());
+  }
+
+  if (openFile())
+  {
+    ROS_INFO("Writing the requests to %s (at most %i files of %.1f MB)", params_.directory_.c_str(),
+      params_.num_files_, 1e-6 * params_.file_size_);
+  }
+}
+
+
+void RequestLogWriter::writeScene(const agile_grasp::Grasps& grasps, const pcl::PointCloud<pcl::PointXYZ>& cloud)
+{
+  namespace ser = ros::serialization;
+  scene_id_++;
+
+  // the entry is kept for the start of the next file
+  const uint32_t size = ser::serializationLength(scene_id_) + ser::serializationLength(grasps)
+    + ser::serializationLength(cloud.header.frame_id) + sizeof(uint32_t) + 3 * sizeof(float) * cloud.size();
+  std::vector<uint8_t> scene(ENTRY_HEADER_SIZE + size);
+  const uint32_t header[2] = {ENTRY_SCENE, size};
+  memcpy(&scene[0], header, sizeof(header));
+
+  ser::OStream stream(&scene[ENTRY_HEADER_SIZE], size);
+  ser::serialize(stream, scene_id_);
+  ser::serialize(stream, grasps);
+  ser::serialize(stream, cloud.header.frame_id);
+  ser::serialize(stream, (uint32_t) (3 * cloud.size()));
+  for (int i = 0; i < cloud.size(); i++)
+  {
+    ser::serialize(stream, cloud.points[i].x);
+    ser::serialize(stream, cloud.points[i].y);
+    ser::serialize(stream, cloud.points[i].z);
+  }
+
+  // a new file must not start with the previous scene
+  scene_.clear();
+  uint8_t* data = reserve(ENTRY_SCENE, size);
+  if (data != NULL)
+    memcpy(data, &scene[ENTRY_HEADER_SIZE], size);
+  scene_.swap(scene);
+}
+
+
+void RequestLogWriter::writeRequest(const ros::Time& stamp, int64_t latency,
+  const grasp_selection::SelectGrasps::Request& request, const sensor_msgs::JointState& joint_state,
+  const CandidateStore& reachable, const grasp_selection::RejectionStatistics& rejections, bool success,
+  const grasp_selection::GraspList& grasps)
+{
+  namespace ser = ros::serialization;
+  const uint64_t request_id = request_id_++;
+  const uint8_t success_byte = success;
+  const uint8_t return_rejections = request.return_rejections;
+  const uint32_t num_reachable = reachable.size();
+
+  // the fields in the order of RequestRecord.msg
+  const uint32_t size = 2 * sizeof(uint64_t) + ser::serializationLength(stamp) + sizeof(latency)
+    + ser::serializationLength(request.hand_pose) + 1 + ser::serializationLength(joint_state)
+    + sizeof(uint32_t) + num_reachable * sizeof(int32_t)
+    + ser::serializationLength(rejections) + 1 + ser::serializationLength(grasps);
+  uint8_t* data = reserve(ENTRY_REQUEST, size);
+  if (data == NULL)
+    return;
+
+  ser::OStream stream(data, size);
+  ser::serialize(stream, request_id);
+  ser::serialize(stream, scene_id_);
+  ser::serialize(stream, stamp);
+  ser::serialize(stream, latency);
+  ser::serialize(stream, request.hand_pose);
+  ser::serialize(stream, return_rejections);
+  ser::serialize(stream, joint_state);
+  ser::serialize(stream, num_reachable);
+  for (int i = 0; i < num_reachable; i++)
+    ser::serialize(stream, (int32_t) reachable.getId(i));
+  ser::serialize(stream, rejections);
+  ser::serialize(stream, success_byte);
+  ser::serialize(stream, grasps);
+}
+
+
+uint8_t* RequestLogWriter::reserve(EntryType type, uint32_t size)
+{
+  // an entry that is larger than a file (apart from its header and the current scene) is dropped
+  const uint64_t entry_size = ENTRY_HEADER_SIZE + size;
+  if (data_ != NULL && size_ + entry_size > params_.file_size_ && FILE_HEADER_SIZE + entry_size <= params_.file_size_)
+  {
+    closeFile();
+    openFile();
+  }
+  else if (data_ == NULL && std::chrono::steady_clock::now() >= retry_time_)
+    openFile();
+
+  if (data_ == NULL || size_ + entry_size > params_.file_size_)
+  {
+    num_dropped_++;
+    ROS_WARN_THROTTLE(10.0, "Dropped %llu entries of the request log", (unsigned long long) num_dropped_);
+    return NULL;
+  }
+
+  const uint32_t header[2] = {(uint32_t) type, size};
+  memcpy(data_ + size_, header, sizeof(header));
+  uint8_t* data = data_ + size_ + ENTRY_HEADER_SIZE;
+  size_ += entry_size;
+  return data;
+}
+
+
+bool RequestLogWriter::openFile()
+{
+  const int number = file_numbers_.empty() ? 0 : file_numbers_.back() + 1;
+  while (file_numbers_.size() >= params_.num_files_)
+  {
+    unlink(getFilename(params_.directory_, file_numbers_.front()).c_str());
+    file_numbers_.pop_front();
+  }
+
+  // the file is sparse until it is written, and truncated to its used size when it is closed
+  const std::string filename = getFilename(params_.directory_, number);
+  fd_ = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  void* data = MAP_FAILED;
+  if (fd_ >= 0 && ftruncate(fd_, params_.file_size_) == 0)
+    data = mmap(NULL, params_.file_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (data == MAP_FAILED)
+  {
+    // the entries are dropped until a later attempt succeeds
+    ROS_ERROR("Could not create request log file %s", filename.c_str());
+    if (fd_ >= 0)
+    {
+      ::close(fd_);
+      unlink(filename.c_str());
+    }
+    fd_ = -1;
+    retry_time_ = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(retry_delay_));
+    ROS_WARN("Creating a request log file again in %.0f s", retry_delay_);
+    retry_delay_ = std::min(2.0 * retry_delay_, MAX_RETRY_DELAY);
+    return false;
+  }
+  data_ = static_cast<uint8_t*>(data);
+  file_numbers_.push_back(number);
+  retry_delay_ = MIN_RETRY_DELAY;
+
+  int32_t header[2];
+  memcpy(&header[0], MAGIC, sizeof(MAGIC));
+  header[1] = VERSION;
+  memcpy(data_, header, sizeof(header));
+  size_ = FILE_HEADER_SIZE;
+
+  if (size_ + parameters_.size() <= params_.file_size_)
+  {
+    memcpy(data_ + size_, &parameters_[0], parameters_.size());
+    size_ += parameters_.size();
+  }
+  if (!scene_.empty() && size_ + scene_.size() <= params_.file_size_)
+  {
+    memcpy(data_ + size_, &scene_[0], scene_.size());
+    size_ += scene_.size();
+  }
+  return true;
+}
+
+
+void RequestLogWriter::closeFile()
+{
+  if (data_ == NULL)
+    return;
+
+  munmap(data_, params_.file_size_);
+  if (ftruncate(fd_, size_) != 0)
+    ROS_WARN("Could not truncate request log file %s", getFilename(params_.directory_, file_numbers_.back()).c_str());
+  ::close(fd_);
+  data_ = NULL;
+  fd_ = -1;
+}
+
+
+bool RequestLogReader::open(const std::string& filename)
+{
+  close();
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    ROS_ERROR("Could not open request log file %s", filename.c_str());
+    return false;
+  }
+
+  struct stat status;
+  void* data = MAP_FAILED;
+  if (fstat(fd, &status) == 0 && status.st_size >= FILE_HEADER_SIZE)
+    data = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+
+  int32_t header[2];
+  if (data != MAP_FAILED)
+    memcpy(header, data, sizeof(header));
+  if (data == MAP_FAILED || memcmp(&header[0], MAGIC, sizeof(MAGIC)) != 0 || header[1] != VERSION)
+  {
+    ROS_ERROR("%s is not a request log file of version %i", filename.c_str(), VERSION);
+    if (data != MAP_FAILED)
+      munmap(data, status.st_size);
+    return false;
+  }
+
+  data_ = static_cast<uint8_t*>(data);
+  size_ = status.st_size;
+  position_ = FILE_HEADER_SIZE;
+  return true;
+}
+
+
+RequestLogWriter::EntryType RequestLogReader::read(grasp_selection::ParametersRecord& parameters,
+  grasp_selection::SceneRecord& scene, grasp_selection::RequestRecord& request)
+{
+  if (data_ == NULL || position_ + ENTRY_HEADER_SIZE > size_)
+    return RequestLogWriter::ENTRY_NONE;
+
+  // the file of a writer that was killed ends in zeros, or in an incomplete entry
+  uint32_t header[2];
+  memcpy(header, data_ + position_, sizeof(header));
+  const RequestLogWriter::EntryType type = static_cast<RequestLogWriter::EntryType>(header[0]);
+  if ((type != RequestLogWriter::ENTRY_SCENE && type != RequestLogWriter::ENTRY_REQUEST
+      && type != RequestLogWriter::ENTRY_PARAMETERS) || position_ + ENTRY_HEADER_SIZE + header[1] > size_)
+  {
+    return RequestLogWriter::ENTRY_NONE;
+  }
+
+  ros::serialization::IStream stream(data_ + position_ + ENTRY_HEADER_SIZE, header[1]);
+  if (type == RequestLogWriter::ENTRY_PARAMETERS)
+    ros::serialization::deserialize(stream, parameters);
+  else if (type == RequestLogWriter::ENTRY_SCENE)
+    ros::serialization::deserialize(stream, scene);
+  else
+    ros::serialization::deserialize(stream, request);
+  position_ += ENTRY_HEADER_SIZE + header[1];
+  return type;
+}
+
+
+void RequestLogReader::close()
+{
+  if (data_ != NULL)
+    munmap(data_, size_);
+  data_ = NULL;
+  size_ = 0;
+  position_ = 0;
+}
@@ -0,0 +1,378 @@
+#include <grasp_selection/scene_generator.h>
+
+#include <eigen_conversions/eigen_msg.h>
+#include <pcl_conversions/pcl_conversions.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+
+
+namespace
+{
+
+/** Draw a random number in [0, 1) with 53 random bits from two outputs of the generator. */
+double drawUnit(std::mt19937& random)
+{
+  const uint32_t a = random() >> 5, b = random() >> 6;
+  return (a * 67108864.0 + b) / 9007199254740992.0;
+}
+
+/** A primitive object standing on the table. */
+struct Object
+{
+  enum Shape { BOX, CYLINDER, SPHERE, NUM_SHAPES };
+
+  Shape shape_;
+  Eigen::Vector3d center_; ///< the center of the bottom face (the lowest point of a sphere)
+  double yaw_; ///< the rotation about the vertical axis
+  Eigen::Vector3d size_; ///< the edge lengths of a box, the diameter and the height of a cylinder, or the diameter
+
+  /** Calculate the area of the visible surface (all but the bottom face). */
+  double calculateArea() const
+  {
+    const double r = 0.5 * size_(0);
+    if (shape_ == BOX)
+      return size_(0) * size_(1) + 2.0 * (size_(0) + size_(1)) * size_(2);
+    if (shape_ == CYLINDER)
+      return M_PI * r * r + 2.0 * M_PI * r * size_(2);
+    return 4.0 * M_PI * r * r;
+  }
+
+  /** Draw a random point on the visible surface, with a uniform density. */
+  Eigen::Vector3d samplePoint(std::mt19937& random) const
+  {
+    const double r = 0.5 * size_(0);
+    Eigen::Vector3d p;
+
+    if (shape_ == BOX)
+    {
+      // choose the face by its area: the top, or one of the sides along x or y
+      const double a = size_(0) * size_(1), b = size_(0) * size_(2), c = size_(1) * size_(2);
+      const double u = drawUnit(random) * (a + 2.0 * b + 2.0 * c);
+      const double s = drawUnit(random) - 0.5, t = drawUnit(random);
+      if (u < a)
+        p << s * size_(0), (drawUnit(random) - 0.5) * size_(1), size_(2);
+      else if (u < a + 2.0 * b)
+        p << s * size_(0), ((u < a + b) ? -0.5 : 0.5) * size_(1), t * size_(2);
+      else
+        p << ((u < a + 2.0 * b + c) ? -0.5 : 0.5) * size_(0), s * size_(1), t * size_(2);
+    }
+    else if (shape_ == CYLINDER)
+    {
+      const double top = M_PI * r * r, side = 2.0 * M_PI * r * size_(2);
+      const double phi = 2.0 * M_PI * drawUnit(random);
+      if (drawUnit(random) * (top + side) < top)
+      {
+        const double rho = r * sqrt(drawUnit(random));
+        p << rho * cos(phi), rho * sin(phi), size_(2);
+      }
+      else
+        p << r * cos(phi), r * sin(phi), drawUnit(random) * size_(2);
+    }
+    else
+    {
+      // uniform on the sphere: uniform height and angle (Archimedes)
+      const double z = 2.0 * drawUnit(random) - 1.0, phi = 2.0 * M_PI * drawUnit(random);
+      const double rho = sqrt(1.0 - z * z);
+      p << r * rho * cos(phi), r * rho * sin(phi), r * (1.0 + z);
+    }
+
+    return center_ + Eigen::AngleAxisd(yaw_, Eigen::Vector3d::UnitZ()) * p;
+  }
+};
+
+}
+
+
+SceneGenerator::SceneGenerator(const Reaching::Parameters& reaching_params, IKFastSolver& solver,
+  const std::vector<std::string>& joint_state_names) : reaching_params_(reaching_params), solver_(solver),
+  joint_state_names_(joint_state_names)
+{
+  const std::vector<std::string>& chain_names = solver_.getJointNames();
+  chain_indices_.resize(chain_names.size(), -1);
+  for (int i = 0; i < chain_names.size(); i++)
+  {
+    std::vector<std::string>::const_iterator it = std::find(joint_state_names_.begin(), joint_state_names_.end(),
+      chain_names[i]);
+    if (it != joint_state_names_.end())
+      chain_indices_[i] = it - joint_state_names_.begin();
+  }
+}
+
+
+SceneGenerator::Parameters SceneGenerator::getDefaultParameters()
+{
+  Parameters params;
+  params.seed_ = 1;
+  const double table[5] = {0.4, 1.2, -0.5, 0.4, -0.23};
+  params.table_.assign(table, table + 5);
+  params.num_objects_ = 10;
+  params.min_object_size_ = 0.03;
+  params.max_object_size_ = 0.12;
+  params.num_points_ = 20000;
+  params.noise_ = 0.002;
+  params.num_grasps_ = 1000;
+  params.label_fractions_[REACHABLE] = 0.4;
+  params.label_fractions_[UNREACHABLE] = 0.2;
+  params.label_fractions_[OUTSIDE_WORKSPACE] = 0.2;
+  params.label_fractions_[INVALID_APERTURE] = 0.2;
+  params.max_attempts_ = 10000;
+  return params;
+}
+
+
+const char* SceneGenerator::getLabelName(Label label)
+{
+  static const char* names[NUM_LABELS] = {"reachable", "unreachable", "outside_workspace", "invalid_aperture"};
+  return names[label];
+}
+
+
+bool SceneGenerator::generate(const Parameters& params, const std::string& frame_id, Scene& scene)
+{
+  std::mt19937 random(params.seed_);
+
+  // the robot stands at the middle of its joint limits, which the ikfast solver uses as the seed of all IK requests
+  const Eigen::Matrix<double, 2, Eigen::Dynamic>& limits = solver_.getJointLimits();
+  scene.joint_state_.name = joint_state_names_;
+  scene.joint_state_.position.assign(joint_state_names_.size(), 0.0);
+  for (int i = 0; i < chain_indices_.size(); i++)
+  {
+    if (chain_indices_[i] >= 0)
+      scene.joint_state_.position[chain_indices_[i]] = 0.5 * (limits(0, i) + limits(1, i));
+  }
+  solver_.setJointState(scene.joint_state_);
+
+  PointCloud cloud;
+  generateCloud(params, random, cloud);
+  pcl::toROSMsg(cloud, scene.cloud_);
+  scene.cloud_.header.frame_id = frame_id;
+
+  // the number of grasps with each label is rounded down, and the remainder is added to the first label
+  std::vector<Label>& labels = scene.labels_;
+  labels.clear();
+  labels.reserve(params.num_grasps_);
+  double total_fraction = 0.0;
+  for (int l = 0; l < NUM_LABELS; l++)
+    total_fraction += params.label_fractions_[l];
+  for (int l = NUM_LABELS - 1; l >= 0; l--)
+  {
+    const int count = (l == 0) ? params.num_grasps_ - labels.size()
+      : (int) (params.num_grasps_ * params.label_fractions_[l] / total_fraction);
+    labels.insert(labels.end(), count, static_cast<Label>(l));
+  }
+  std::shuffle(labels.begin(), labels.end(), random);
+
+  // most of the time is spent in the IK requests that verify the labels, so the grasps are generated in parallel
+  scene.grasps_.header.frame_id = frame_id;
+  scene.grasps_.grasps.resize(labels.size());
+  int num_failed = 0;
+#pragma omp parallel for schedule(dynamic) reduction(+: num_failed)
+  for (int i = 0; i < labels.size(); i++)
+  {
+    std::seed_seq seed_sequence = {params.seed_, i};
+    std::mt19937 grasp_random(seed_sequence);
+    if (!generateGrasp(params, labels[i], grasp_random, scene.grasps_.grasps[i]))
+      num_failed++;
+  }
+
+  if (num_failed > 0)
+  {
+    ROS_ERROR("%i grasps not found within %i attempts", num_failed, params.max_attempts_);
+    return false;
+  }
+  return true;
+}
+
+
+void SceneGenerator::generateCloud(const Parameters& params, std::mt19937& random, PointCloud& cloud) const
+{
+  const std::vector<double>& table = params.table_;
+  const std::vector<double>& ws = reaching_params_.workspace_;
+
+  // the objects stand on the part of the table that lies within the workspace
+  const double x_min = std::max(table[0], ws[0]), x_max = std::min(table[1], ws[1]);
+  const double y_min = std::max(table[2], ws[2]), y_max = std::min(table[3], ws[3]);
+  std::vector<Object> objects(params.num_objects_);
+  std::vector<double> areas(1 + objects.size());
+  areas[0] = (table[1] - table[0]) * (table[3] - table[2]);
+  for (int i = 0; i < objects.size(); i++)
+  {
+    Object& object = objects[i];
+    object.shape_ = static_cast<Object::Shape>((int) (drawUnit(random) * Object::NUM_SHAPES));
+    object.center_ << uniform(random, x_min, x_max), uniform(random, y_min, y_max), table[4];
+    object.yaw_ = uniform(random, 0.0, M_PI);
+    object.size_ << uniform(random, params.min_object_size_, params.max_object_size_),
+      uniform(random, params.min_object_size_, params.max_object_size_),
+      uniform(random, params.min_object_size_, 2.0 * params.max_object_size_);
+    areas[i + 1] = object.calculateArea();
+  }
+
+  // the points are spread over the table and the objects by area, so that all surfaces have the same density; a 
+  // surface is found by its cumulative area
+  std::partial_sum(areas.begin(), areas.end(), areas.begin());
+  cloud.points.resize(params.num_points_);
+  for (int i = 0; i < params.num_points_; i++)
+  {
+    const int surface = std::upper_bound(areas.begin(), areas.end(), drawUnit(random) * areas.back()) - areas.begin();
+    Eigen::Vector3d p;
+    if (surface == 0)
+      p << uniform(random, table[0], table[1]), uniform(random, table[2], table[3]), table[4];
+    else
+      p = objects[surface - 1].samplePoint(random);
+
+    if (params.noise_ > 0.0)
+      p += Eigen::Vector3d(normal(random, params.noise_), normal(random, params.noise_), normal(random, params.noise_));
+    cloud.points[i].x = p(0);
+    cloud.points[i].y = p(1);
+    cloud.points[i].z = p(2);
+  }
+  cloud.width = params.num_points_;
+  cloud.height = 1;
+  cloud.is_dense = true;
+}
+
+
+bool SceneGenerator::generateGrasp(const Parameters& params, Label label, std::mt19937& random,
+  agile_grasp::Grasp& grasp) const
+{
+  const std::vector<double>& ws = reaching_params_.workspace_;
+  const double min_aperture = reaching_params_.min_aperture_;
+  const double max_aperture = reaching_params_.max_aperture_;
+  Eigen::Vector3d center, approach, axis;
+  double width = uniform(random, min_aperture, max_aperture);
+  bool is_found = false;
+
+  for (int attempt = 0; attempt < params.max_attempts_ && !is_found; attempt++)
+  {
+    switch (label)
+    {
+      case REACHABLE:
+        sampleReachableGrasp(random, center, approach, axis);
+        is_found = isInWorkspace(center) && hasIKSolution(center, approach, axis);
+        break;
+
+      case UNREACHABLE:
+        center = sampleWorkspacePosition(random);
+        sampleOrientation(random, approach, axis);
+        is_found = !hasIKSolution(center, approach, axis);
+        break;
+
+      case OUTSIDE_WORKSPACE:
+        // within 0.3m of the workspace
+        center << uniform(random, ws[0] - 0.3, ws[1] + 0.3), uniform(random, ws[2] - 0.3, ws[3] + 0.3),
+          uniform(random, ws[4] - 0.3, ws[5]);
+        sampleOrientation(random, approach, axis);
+        is_found = !isInWorkspace(center);
+        break;
+
+      default:
+        center = sampleWorkspacePosition(random);
+        sampleOrientation(random, approach, axis);
+        width = (uniform(random, 0.0, 1.0) < 0.5) ? uniform(random, 0.0, 0.99 * min_aperture)
+          : uniform(random, 1.01 * max_aperture, 2.0 * max_aperture);
+        is_found = true;
+    }
+  }
+
+  // the workspace check uses the surface center, which is set to the grasp position
+  tf::vectorEigenToMsg(center, grasp.center);
+  tf::vectorEigenToMsg(center, grasp.surface_center);
+  tf::vectorEigenToMsg(approach, grasp.approach);
+  tf::vectorEigenToMsg(axis, grasp.axis);
+  grasp.width.data = width;
+  return is_found;
+}
+
+
+void SceneGenerator::sampleReachableGrasp(std::mt19937& random, Eigen::Vector3d& center, Eigen::Vector3d& approach,
+  Eigen::Vector3d& axis) const
+{
+  const Eigen::Matrix<double, 2, Eigen::Dynamic>& limits = solver_.getJointLimits();
+  std::vector<double> joint_positions(solver_.getNumJoints());
+  for (int i = 0; i < joint_positions.size(); i++)
+    joint_positions[i] = uniform(random, limits(0, i), limits(1, i));
+
+  // invert the construction of the hand pose in GraspPoseKernel: the first hand axis is the negated approach vector,
+  // the second one the grasp axis, and the hand lies <hand_offset_> behind the grasp position
+  const Eigen::Affine3d pose = solver_.calculatePose(&joint_positions[0]);
+  const std::vector<int>& axis_order = reaching_params_.axis_order_;
+  approach = -pose.linear().col(axis_order[0]);
+  axis = pose.linear().col(axis_order[1]);
+  center = pose.translation() + reaching_params_.hand_offset_ * approach;
+}
+
+
+void SceneGenerator::sampleOrientation(std::mt19937& random, Eigen::Vector3d& approach, Eigen::Vector3d& axis)
+{
+  do
+    approach << normal(random, 1.0), normal(random, 1.0), normal(random, 1.0);
+  while (approach.squaredNorm() < 1e-6);
+  approach.normalize();
+
+  Eigen::Vector3d v;
+  do
+  {
+    v << normal(random, 1.0), normal(random, 1.0), normal(random, 1.0);
+    axis = v - v.dot(approach) * approach;
+  }
+  while (axis.squaredNorm() < 1e-6);
+  axis.normalize();
+}
+
+
+bool SceneGenerator::hasIKSolution(const Eigen::Vector3d& center, const Eigen::Vector3d& approach,
+  const Eigen::Vector3d& axis) const
+{
+  geometry_msgs::PoseStamped pose;
+  pose.header.frame_id = reaching_params_.planning_frame_;
+  std::vector<double> joint_positions(solver_.getNumJoints());
+  const std::vector<int>& axis_order = reaching_params_.axis_order_;
+  tf::pointEigenToMsg(center - reaching_params_.hand_offset_ * approach, pose.pose.position);
+
+  // the two hand orientations of GraspPoseKernel: the second one is rotated by 180deg about the approach vector
+  for (int k = 0; k < 2; k++)
+  {
+    const double sign = (k == 0) ? 1.0 : -1.0;
+    Eigen::Matrix3d R;
+    R.col(axis_order[0]) = -sign * approach;
+    R.col(axis_order[1]) = sign * axis;
+    R.col(axis_order[2]) = R.col(axis_order[0]).cross(R.col(axis_order[1]));
+    tf::quaternionEigenToMsg(Eigen::Quaterniond(R).normalized(), pose.pose.orientation);
+
+    if (solver_.solve(pose, NULL, 1, 0.0, &joint_positions[0]))
+      return true;
+  }
+
+  return false;
+}
+
+
+bool SceneGenerator::isInWorkspace(const Eigen::Vector3d& p) const
+{
+  const std::vector<double>& ws = reaching_params_.workspace_;
+  return p(0) >= ws[0] && p(0) <= ws[1] && p(1) >= ws[2] && p(1) <= ws[3] && p(2) >= ws[4] && p(2) <= ws[5];
+}
+
+
+Eigen::Vector3d SceneGenerator::sampleWorkspacePosition(std::mt19937& random) const
+{
+  const std::vector<double>& ws = reaching_params_.workspace_;
+  return Eigen::Vector3d(uniform(random, ws[0], ws[1]), uniform(random, ws[2], ws[3]), uniform(random, ws[4], ws[5]));
+}
+
+
+double SceneGenerator::uniform(std::mt19937& random, double min, double max)
+{
+  return min + (max - min) * drawUnit(random);
+}
+
+
+double SceneGenerator::normal(std::mt19937& random, double stddev)
+{
+  // 1 - u lies in (0, 1], so the logarithm is finite
+  const double u = 1.0 - drawUnit(random), v = drawUnit(random);
+  return stddev * sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
@@ -0,0 +1,27 @@
+#include <grasp_selection/scene_index.h>
+
+#include <algorithm>
+
+
+void SceneIndex::setPointCloud(const pcl::PointCloud<pcl::PointXYZ>& cloud)
+{
+  // calculate the grid cell of each point
+  std::vector<std::pair<int64_t, int> > keys(cloud.size());
+  for (int i = 0; i < cloud.size(); i++)
+  {
+    Eigen::Vector3i cell = calculateCell(cloud.points[i].getVector3fMap().cast<double>());
+    keys[i] = std::make_pair(calculateGridKey(cell(0), cell(1), cell(2)), i);
+  }
+
+  // store the points of each cell contiguously
+  std::sort(keys.begin(), keys.end());
+  points_.resize(3, keys.size());
+  cells_.clear();
+  for (int i = 0; i < keys.size(); i++)
+  {
+    points_.col(i) = cloud.points[keys[i].second].getVector3fMap().cast<double>();
+    if (i == 0 || keys[i].first != keys[i - 1].first)
+      cells_[keys[i].first] = std::make_pair(i, i);
+    cells_[keys[i].first].second = i + 1;
+  }
+}
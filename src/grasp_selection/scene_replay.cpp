@@ -0,0 +1,209 @@
+#include <grasp_selection/scene_replay.h>
+
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+
+#include <algorithm>
+
+
+SceneReplay::SceneReplay() : solver_(NULL), pipeline_(NULL)
+{
+  // the Baxter defaults from select_grasps.launch
+  const double workspace[6] = {0.6, 1.0, -0.26, 0.14, -0.23, 1.0};
+  params_.workspace_.assign(workspace, workspace + 6);
+  params_.min_aperture_ = 0.02;
+  params_.max_aperture_ = 0.07;
+  params_.num_additional_grasps_ = 0;
+  params_.axis_order_.resize(3);
+  params_.axis_order_[0] = 2;
+  params_.axis_order_[1] = 0;
+  params_.axis_order_[2] = 1;
+  params_.planning_frame_ = "/base";
+  params_.hand_offset_ = 0.095;
+  params_.arm_link_ = "right_gripper";
+  params_.move_group_ = "right_arm";
+  params_.max_colliding_points_ = 1;
+  params_.js_first_joint_index_ = 9;
+  params_.js_last_joint_index_ = 15;
+  params_.ik_first_joint_index_ = 8;
+  params_.ik_last_joint_index_ = 14;
+  params_.planning_lib_ = Reaching::IKFAST;
+  params_.pregrasp_offsets_.push_back(0.06);
+  params_.pregrasp_offsets_.push_back(0.12);
+  params_.max_joint_step_ = 0.5;
+  params_.ik_base_link_ = "right_arm_mount";
+
+  planner_params_.num_preplanned_ = 3;
+  planner_params_.resolution_ = 0.05;
+  planner_params_.velocity_scaling_ = 0.5;
+  planner_params_.link_radius_ = 0.06;
+  planner_params_.max_colliding_points_ = params_.max_colliding_points_;
+
+  num_selected_ = 50;
+  scoring_mode_ = Scoring::SCORING_MODE_WORKSPACE;
+  scene_cell_size_ = 0.03;
+}
+
+
+bool SceneReplay::load(const std::string& bag_filename, const urdf::Model& urdf, const std::string& grasps_topic,
+  const std::string& cloud_topic, const std::string& joint_states_topic)
+{
+  std::vector<std::string> topics;
+  topics.push_back(grasps_topic);
+  topics.push_back(cloud_topic);
+  topics.push_back(joint_states_topic);
+
+  rosbag::Bag bag;
+  bag.open(bag_filename, rosbag::bagmode::Read);
+  rosbag::View view(bag, rosbag::TopicQuery(topics));
+
+  scenes_.clear();
+  sensor_msgs::PointCloud2::ConstPtr cloud;
+  sensor_msgs::JointState::ConstPtr joint_state;
+  for (rosbag::View::iterator it = view.begin(); it != view.end(); it++)
+  {
+    if (it->getTopic() == cloud_topic)
+      cloud = it->instantiate<sensor_msgs::PointCloud2>();
+    else if (it->getTopic() == joint_states_topic)
+      joint_state = it->instantiate<sensor_msgs::JointState>();
+    else if (it->getTopic() == grasps_topic && cloud && joint_state)
+    {
+      Scene scene;
+      scene.grasps_ = it->instantiate<agile_grasp::Grasps>();
+      scene.cloud_ = cloud;
+      scene.joint_state_ = joint_state;
+      scenes_.push_back(scene);
+    }
+  }
+  bag.close();
+
+  if (scenes_.size() == 0)
+  {
+    ROS_ERROR("No grasps message with a preceding point cloud and joint state found in %s", bag_filename.c_str());
+    return false;
+  }
+
+  // the joint names are taken from the joint states, like in the selection node
+  const sensor_msgs::JointState& first_state = *scenes_[0].joint_state_;
+  if (first_state.name.size() <= params_.js_last_joint_index_)
+  {
+    ROS_ERROR("The joint states have %i joints, expected at least %i", (int) first_state.name.size(),
+      params_.js_last_joint_index_ + 1);
+    return false;
+  }
+  std::vector<std::string> joint_names(first_state.name.begin() + params_.js_first_joint_index_,
+    first_state.name.begin() + params_.js_last_joint_index_ + 1);
+  if (!create(urdf, joint_names))
+    return false;
+
+  for (int i = 0; i < scenes_.size(); i++)
+    scenes_[i].hand_pose_ = calculateHandPose(*scenes_[i].joint_state_);
+
+  return true;
+}
+
+
+bool SceneReplay::create(const urdf::Model& urdf, const std::vector<std::string>& joint_names)
+{
+  solver_ = new IKFastSolver(urdf, params_.planning_frame_, params_.ik_base_link_, params_.arm_link_, joint_names);
+  if (!solver_->isValid())
+  {
+    delete solver_;
+    solver_ = NULL;
+    return false;
+  }
+  delete pipeline_;
+  pipeline_ = new SelectionPipeline(params_, planner_params_, urdf, joint_names, num_selected_, scoring_mode_,
+    scene_cell_size_, solver_);
+  return true;
+}
+
+
+bool SceneReplay::create(const urdf::Model& urdf, const grasp_selection::ParametersRecord& parameters)
+{
+  if (parameters.planning_library != Reaching::IKFAST)
+  {
+    ROS_WARN("The node used planning library %i, the replay uses the in-process ikfast solver",
+      parameters.planning_library);
+  }
+
+  params_.workspace_ = parameters.workspace;
+  params_.min_aperture_ = parameters.min_aperture;
+  params_.max_aperture_ = parameters.max_aperture;
+  params_.num_additional_grasps_ = parameters.num_additional_grasps;
+  params_.axis_order_.assign(parameters.axis_order.begin(), parameters.axis_order.end());
+  params_.planning_frame_ = parameters.planning_frame;
+  params_.hand_offset_ = parameters.hand_offset;
+  params_.arm_link_ = parameters.arm_link;
+  params_.move_group_ = parameters.move_group;
+  params_.max_colliding_points_ = parameters.max_colliding_points;
+  params_.ik_first_joint_index_ = parameters.ik_first_joint_index;
+  params_.ik_last_joint_index_ = parameters.ik_last_joint_index;
+  params_.js_first_joint_index_ = parameters.js_first_joint_index;
+  params_.js_last_joint_index_ = parameters.js_last_joint_index;
+  params_.ik_base_link_ = parameters.ik_base_link;
+  params_.pregrasp_offsets_ = parameters.pregrasp_offsets;
+  params_.max_joint_step_ = parameters.max_joint_step;
+
+  planner_params_.num_preplanned_ = parameters.num_preplanned;
+  planner_params_.resolution_ = parameters.trajectory_resolution;
+  planner_params_.velocity_scaling_ = parameters.velocity_scaling;
+  planner_params_.link_radius_ = parameters.link_radius;
+  planner_params_.max_colliding_points_ = parameters.max_colliding_points;
+
+  num_selected_ = parameters.num_selected;
+  scoring_mode_ = parameters.scoring_mode;
+  scene_cell_size_ = parameters.scene_cell_size;
+  return create(urdf, parameters.joint_names);
+}
+
+
+bool SceneReplay::selectGrasps(int index, grasp_selection::GraspList& msg)
+{
+  const Scene& scene = scenes_[index];
+  pipeline_->setPointCloud(*scene.cloud_);
+  pipeline_->setJointState(*scene.joint_state_);
+  pipeline_->setGrasps(scene.grasps_);
+  return pipeline_->selectGrasps(scene.hand_pose_, msg);
+}
+
+
+uint64_t SceneReplay::calculateDigest(const grasp_selection::GraspList& msg)
+{
+  std::vector<double> values;
+  for (int i = 0; i < msg.grasps.size(); i++)
+  {
+    const grasp_selection::Grasp& grasp = msg.grasps[i];
+    values.push_back(grasp.grasp_id);
+    values.push_back(grasp.score);
+    values.insert(values.end(), grasp.joint_positions.begin(), grasp.joint_positions.end());
+    values.insert(values.end(), grasp.pregrasp_joint_positions.begin(), grasp.pregrasp_joint_positions.end());
+    for (int j = 0; j < grasp.trajectory.points.size(); j++)
+      values.insert(values.end(), grasp.trajectory.points[j].positions.begin(),
+        grasp.trajectory.points[j].positions.end());
+  }
+
+  uint64_t digest = 14695981039346656037ULL;
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(values.data());
+  for (size_t i = 0; i < values.size() * sizeof(double); i++)
+    digest = (digest ^ bytes[i]) * 1099511628211ULL;
+  return digest;
+}
+
+
+geometry_msgs::Pose SceneReplay::calculateHandPose(const sensor_msgs::JointState& joint_state) const
+{
+  const std::vector<std::string>& names = solver_->getJointNames();
+  std::vector<double> joint_positions(names.size(), 0.0);
+  for (int i = 0; i < names.size(); i++)
+  {
+    std::vector<std::string>::const_iterator it = std::find(joint_state.name.begin(), joint_state.name.end(),
+      names[i]);
+    if (it != joint_state.name.end() && it - joint_state.name.begin() < joint_state.position.size())
+      joint_positions[i] = joint_state.position[it - joint_state.name.begin()];
+  }
+
+  geometry_msgs::Pose pose;
+  tf::poseEigenToMsg(solver_->calculatePose(&joint_positions[0]), pose);
+  return pose;
+}
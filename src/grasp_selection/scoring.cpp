@@ -3,165 +3,213 @@
 
 Scoring::Scoring(const urdf::Model& urdf, const std::vector<std::string>& joint_names, double min_aperture, 
 	double max_aperture, int num_selected, int scoring_mode)
-	: min_aperture_(min_aperture), max_aperture_(max_aperture), num_selected_(num_selected)
+	: min_aperture_(min_aperture), max_aperture_(max_aperture), num_selected_(num_selected), 
+    scoring_mode_(scoring_mode)
 {
 	// get joint limits from URDF	
 	joint_limits_.resize(2, joint_names.size());
-	std::cout << "Joint Limits (given by URDF)\n";
+	ROS_INFO("Joint Limits (given by URDF)");
   for (int i = 0; i < joint_limits_.cols(); i++)
   {
     joint_limits_(0, i) = urdf.getJoint(joint_names[i])->limits->lower;
     joint_limits_(1, i) = urdf.getJoint(joint_names[i])->limits->upper;
-    std::cout << joint_names[i].c_str() << ": [" << joint_limits_(0, i) << ", " << joint_limits_(1, i) << "]\n";
+    ROS_INFO("%s: [%f, %f]", joint_names[i].c_str(), joint_limits_(0, i), joint_limits_(1, i));
   }
+  
+  // use fixed-size joint types for the Baxter arm, and dynamically sized ones for all other arms
+  if (joint_limits_.cols() == BAXTER_NUM_JOINTS)
+    joint_score_ = &Scoring::calculateJointScore<BAXTER_NUM_JOINTS>;
+  else
+    joint_score_ = &Scoring::calculateJointScore<Eigen::Dynamic>;
+}
+
+
+Scoring::Ranking Scoring::scoreGrasps(const CandidateStore& grasps, const geometry_msgs::Pose& current_pose, 
+  Arena& arena)
+{
+  PROFILE_SCOPE("Scoring::scoreGrasps");
+  Ranking ranking = {ArenaVector<int>(ArenaAllocator<int>(&arena)), 
+    ArenaVector<double>(ArenaAllocator<double>(&arena)), 0};
+  rankGrasps(grasps, arena, ranking);
+	return selectGrasps(grasps, ranking, current_pose, arena);
 }
 
 
-std::vector<GraspScored> Scoring::scoreGrasps(const std::vector<GraspScored>& grasps_in, const geometry_msgs::Pose& current_pose)
+void Scoring::rankGrasps(const CandidateStore& grasps, Arena& arena, Ranking& ranking)
 {
-	std::vector<GraspScored> grasps = grasps_in;
+  PROFILE_SCOPE("Scoring::rankGrasps");
+	ranking.num_distance_candidates_ = 0;
+  ArenaAllocator<int> int_allocator(&arena);
+  ArenaAllocator<double> double_allocator(&arena);
 	
 	// calculate joint limits score
+  ArenaVector<double> joint_scores(grasps.size(), 0.0, double_allocator);
 	for (int i = 0; i < grasps.size(); i++)
 	{
-		grasps[i].score_ = calculateJointScore(grasps[i].joint_positions_);
+		joint_scores[i] = calculateJointScore(grasps.getJointPositions(i));
 	}
 	
 	// sort grasps by joint limits score (ascending)
-  std::sort(grasps.begin(), grasps.end(), Scoring::compareJointScore);
+  sortByScore(joint_scores, ranking.indices_);
+  ranking.scores_.resize(ranking.indices_.size());
+  for (int i = 0; i < ranking.indices_.size(); i++)
+    ranking.scores_[i] = joint_scores[ranking.indices_[i]];
   
-  std::cout << "-- Grasps sorted by joint limits score --\n";
-  for (int i = 0; i < grasps.size(); i++)
-    std::cout << "Grasp: " << i << ", id: " << grasps[i].id_ << ", joint limits score: " << grasps[i].score_ << std::endl;
-  std::cout << "----------------------------------\n";
+  if (AsyncLogger::getInstance().isEnabled(AsyncLogger::SCORING, AsyncLogger::LEVEL_DEBUG))
+  {
+    ASYNC_LOG_DEBUG(AsyncLogger::SCORING, "-- Grasps sorted by joint limits score --");
+    for (int i = 0; i < ranking.indices_.size(); i++)
+      ASYNC_LOG_DEBUG(AsyncLogger::SCORING, "Grasp: %i, id: %i, joint limits score: %f", i, 
+        grasps.getId(ranking.indices_[i]), ranking.scores_[i]);
+  }
   
 	// check that there is a zero joint limits score
-  if (scoring_mode_ == SCORING_MODE_APERTURE && grasps[0].score_ == 0)
+  if (scoring_mode_ >= SCORING_MODE_APERTURE && ranking.scores_.size() > 0 && ranking.scores_[0] == 0)
 	{
-		// calculate hand aperture score
-		std::vector<std::vector<double> > width_scores = calculateApertureScore(grasps);
-		if (width_scores.size() > 1)
+		// calculate hand aperture score for the grasps with a zero joint limits score
+    int num_zero = countTies(ranking.scores_);
+		if (num_zero > 1)
 		{
+      ArenaVector<double> width_scores(num_zero, 0.0, double_allocator);
+      for (int i = 0; i < num_zero; i++)
+        width_scores[i] = calculateApertureScore(grasps.getWidth(ranking.indices_[i]));
+      
 			// sort grasps by aperture
-			std::sort(width_scores.begin(), width_scores.end(), Scoring::compareSecondElement);
+      ArenaVector<int> width_order(int_allocator);
+      sortByScore(width_scores, width_order);
 			
-			std::cout << "-- Grasps sorted by aperture score --\n";
-			for (int i = 0; i < width_scores.size(); i++)
+			if (AsyncLogger::getInstance().isEnabled(AsyncLogger::SCORING, AsyncLogger::LEVEL_DEBUG))
 			{
-				std::cout << "Grasp: " << grasps[width_scores[i][0]].id_ << ", aperture score: " << width_scores[i][1] << "\n";
-			}
-			std::cout << "----------------------------------\n";
-            			
-			// calculate distance to current hand pose
-			if (scoring_mode_ == SCORING_MODE_WORKSPACE)
-      {
-        std::vector<std::vector<double> > distances = calculateWorkspaceDistance(current_pose, grasps, width_scores);
-						
-        // select grasp based on distance to current hand pose
-        if (distances.size() > 1)
-        {
-          std::cout << "Using workspace distance to select grasps\n";
-          
-          // sort grasps by distance to current hand pose
-          std::sort(distances.begin(), distances.end(), Scoring::compareSecondElement);
-          
-          std::vector<GraspScored> grasps_out(std::min((int) distances.size(), num_selected_));
-          for (int i=0; i < grasps_out.size(); i++)
-          {
-            grasps_out[i] = grasps[distances[i][0]];
-            grasps_out[i].score_ = distances[i][1];
-          }
-          return grasps_out;
-        }
-			
-        // select grasp based on distance to aperture limits
-        std::cout << "Using aperture score to select grasps\n";        
-        std::vector<GraspScored> grasps_out(std::min((int) width_scores.size(), num_selected_));
-				for (int i=0; i < grasps_out.size(); i++)
+				ASYNC_LOG_DEBUG(AsyncLogger::SCORING, "-- Grasps sorted by aperture score --");
+				for (int i = 0; i < width_order.size(); i++)
 				{
-					grasps_out[i] = grasps[width_scores[i][0]];
-					grasps_out[i].score_ = width_scores[i][1];
+					ASYNC_LOG_DEBUG(AsyncLogger::SCORING, "Grasp: %i, aperture score: %f", 
+            grasps.getId(ranking.indices_[width_order[i]]), width_scores[width_order[i]]);
 				}
-				return grasps_out;
 			}
+      
+      // keep only the grasps with a zero joint limits score, ordered by their distance to aperture limits
+      ArenaVector<int> indices(num_zero, 0, int_allocator);
+      for (int i = 0; i < num_zero; i++)
+        indices[i] = ranking.indices_[width_order[i]];
+      ranking.indices_.assign(indices.begin(), indices.end());
+      ranking.scores_.resize(num_zero);
+      for (int i = 0; i < num_zero; i++)
+        ranking.scores_[i] = width_scores[width_order[i]];
+      
+      // the grasps with zero aperture scores are ranked by their distance to the current hand pose
+      if (scoring_mode_ == SCORING_MODE_WORKSPACE && ranking.scores_[0] == 0)
+      {
+        int num_ties = countTies(ranking.scores_);
+        if (num_ties > 1)
+          ranking.num_distance_candidates_ = num_ties;
+      }
 		}		
 	}
+}
+
+
+Scoring::Ranking Scoring::selectGrasps(const CandidateStore& grasps, const Ranking& ranking, 
+  const geometry_msgs::Pose& current_pose, Arena& arena)
+{
+  PROFILE_SCOPE("Scoring::selectGrasps");
+  ArenaAllocator<int> int_allocator(&arena);
+  ArenaAllocator<double> double_allocator(&arena);
+  Ranking selected = {ArenaVector<int>(int_allocator), ArenaVector<double>(double_allocator), 0};
   
-  std::cout << "Using joint limits score to select grasps\n";        
-  std::vector<GraspScored> grasps_out(std::min((int) grasps.size(), num_selected_));
-  for (int i=0; i < grasps_out.size(); i++)
+  // select grasp based on distance to current hand pose
+  if (ranking.num_distance_candidates_ > 0)
   {
-    grasps_out[i] = grasps[i];
+    ASYNC_LOG_INFO(AsyncLogger::SCORING, "Using workspace distance to select grasps");
+    ArenaVector<double> distances(double_allocator);
+    calculateWorkspaceDistance(current_pose, grasps, ranking, distances);
+    
+    // sort grasps by distance to current hand pose
+    ArenaVector<int> order(int_allocator);
+    sortByScore(distances, order);
+    
+    int num_out = std::min((int) order.size(), num_selected_);
+    selected.indices_.resize(num_out);
+    selected.scores_.resize(num_out);
+    for (int i=0; i < num_out; i++)
+    {
+      selected.indices_[i] = ranking.indices_[order[i]];
+      selected.scores_[i] = distances[order[i]];
+    }
+    return selected;
   }
+  
+  // select grasp based on the joint limits score or the distance to aperture limits
+  ASYNC_LOG_INFO(AsyncLogger::SCORING, "Using hand pose independent scores to select grasps");
+  int num_out = std::min((int) ranking.indices_.size(), num_selected_);
+  selected.indices_.assign(ranking.indices_.begin(), ranking.indices_.begin() + num_out);
+  selected.scores_.assign(ranking.scores_.begin(), ranking.scores_.begin() + num_out);
+  return selected;
+}
+
 
-  return grasps_out;
+double Scoring::calculateJointScore(const double* joint_positions) const
+{
+  return (this->*joint_score_)(joint_positions);
 }
 
 
-double Scoring::calculateJointScore(const std::vector<double>& joint_positions)
+template <int DOF>
+double Scoring::calculateJointScore(const double* joint_positions) const
 {
-	double score = 0.0;
-	for (int i = 0; i < joint_limits_.cols(); i++)
-	{
-		const double q = joint_positions[i];
-		double min = std::min(fabs(q - joint_limits_(0, i)), fabs(q - joint_limits_(1, i)));
-		score += std::max(0.0, (ARM_JOINT_LIMITS_DISTANCE - min)) * std::max(0.0, (ARM_JOINT_LIMITS_DISTANCE - min));
-	}
-	return score;
+	return calculateJointLimitsDistance<DOF>(joint_positions, joint_limits_.data(), joint_limits_.cols(), 
+		ARM_JOINT_LIMITS_DISTANCE);
 }
 
 
-std::vector<std::vector<double> > Scoring::calculateApertureScore(const std::vector<GraspScored>& grasps)
+double Scoring::calculateApertureScore(double width) const
 {
-	std::vector<std::vector<double> > scores;
-	for (int i = 0; i == 0 || (i < grasps.size() && grasps[i].score_ == grasps[i - 1].score_); i++)
-	{
-		std::vector<double> score(2);
-		score[0] = i;
-		double min = std::min(fabs(grasps[i].width_ - min_aperture_), fabs(grasps[i].width_ - max_aperture_));
-		score[1] = std::max(0.0, HAND_APERTURE_LIMITS_DISTANCE - min);
-		scores.push_back(score);
-	}	
-	return scores;
+  double min = std::min(fabs(width - min_aperture_), fabs(width - max_aperture_));
+  return std::max(0.0, HAND_APERTURE_LIMITS_DISTANCE - min);
 }
 
 
-std::vector<std::vector<double> > Scoring::calculateWorkspaceDistance(const geometry_msgs::Pose& current_pose, 
-	const std::vector<GraspScored>& grasps, const std::vector<std::vector<double> >& widths)
+double Scoring::calculateWorkspaceDistance(const Eigen::Vector3d& position, const geometry_msgs::Pose& current_pose) 
+  const
 {
-	std::vector<std::vector<double> > distances;
-  distances.resize(0);
-  
-  // check that there is a zero aperture score
-  if (widths[0][1] > 0)
-  {    
-    return distances;
-  }
+  Eigen::Vector3d x;
+  tf::pointMsgToEigen(current_pose.position, x);
+  return (position - x).squaredNorm();
+}
+
+
+void Scoring::calculateWorkspaceDistance(const geometry_msgs::Pose& current_pose, const CandidateStore& grasps, 
+  const Ranking& ranking, ArenaVector<double>& distances) const
+{
+  PROFILE_SCOPE("Scoring::calculateWorkspaceDistance");
+	distances.resize(ranking.num_distance_candidates_);
+  Eigen::Vector3d x;
+  tf::pointMsgToEigen(current_pose.position, x);
   
-	for (int i = 0; i == 0 || (i < widths.size() && widths[i][1] == widths[i - 1][1]); i++)
+	for (int i = 0; i < distances.size(); i++)
 	{
-		Eigen::Vector3d x, y;
-		tf::pointMsgToEigen(current_pose.position, x);
-		tf::pointMsgToEigen(grasps[widths[i][0]].pose_st_.pose.position, y);
-		std::vector<double> score(2);
-		score[0] = widths[i][0];
-		score[1] = (y - x).squaredNorm();
-		distances.push_back(score);
+		distances[i] = (grasps.getPosition(ranking.indices_[i]) - x).squaredNorm();
 	}
     
-  std::cout << "done w/ distance scores, created " << distances.size() << " scores\n";
-  
-	return distances;
+  ASYNC_LOG_DEBUG(AsyncLogger::SCORING, "done w/ distance scores, created %zu scores", distances.size());
 }
 
 
-bool Scoring::compareJointScore(const GraspScored& g1, const GraspScored& g2)
+void Scoring::sortByScore(const ArenaVector<double>& scores, ArenaVector<int>& order)
 {
-	return (g1.score_ < g2.score_);
+  PROFILE_SCOPE("Scoring::sortByScore");
+  order.resize(scores.size());
+  for (int i = 0; i < order.size(); i++)
+    order[i] = i;
+  
+  std::sort(order.begin(), order.end(), [&scores](int i, int j) { return scores[i] < scores[j]; });
 }
 
 
-bool Scoring::compareSecondElement(const std::vector<double>& v1, const std::vector<double>& v2)
+int Scoring::countTies(const ArenaVector<double>& scores)
 {
-  return (v1[1] < v2[1]);
+  int n = (scores.size() > 0) ? 1 : 0;
+  while (n < scores.size() && scores[n] == scores[n - 1])
+    n++;
+  return n;
 }
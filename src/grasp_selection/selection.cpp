@@ -2,10 +2,14 @@
 
 
 Selection::Selection(ros::NodeHandle& node, const std::string& grasps_topic, const std::string& cloud_topic,
-	const Reaching::Parameters& reaching_params, const urdf::Model& urdf, const std::string& joint_states_topic,
-	int num_selected, double marker_lifetime, int scoring_mode)
+	const Reaching::Parameters& reaching_params, const TrajectoryPlanner::Parameters& planner_params, 
+  const urdf::Model& urdf, const std::string& joint_states_topic, int num_selected, double marker_lifetime, 
+  int scoring_mode, double scene_cell_size, double stats_period, const std::string& trace_directory, 
+  bool perf_counters, const RequestLogWriter::Parameters& request_log_params)
 	: planning_frame_(reaching_params.planning_frame_), marker_lifetime_(marker_lifetime), has_grasps_(false), 
-    has_cloud_(false), cloud_(new PointCloud), hand_offset_(reaching_params.hand_offset_), scoring_mode_(scoring_mode)
+    has_cloud_(false), hand_offset_(reaching_params.hand_offset_), pipeline_(NULL), trace_(NULL), 
+    is_scene_changed_(false), trace_directory_(trace_directory), num_traces_(0), request_log_(NULL), 
+    is_scene_logged_(false)
 {
 	// create subscriber to ROS topic <grasps_topic> from antigrasp package
 	grasps_sub_ = node.subscribe(grasps_topic, 10, &Selection::graspsCallback, this);
@@ -17,8 +21,13 @@ Selection::Selection(ros::NodeHandle& node, const std::string& grasps_topic, con
   
   // create publisher for visualizing the selected grasps in Rviz
   visuals_pub_ = node.advertise<visualization_msgs::MarkerArray>("grasps_selected", 10);
-	
-	reaching_ = new Reaching(reaching_params, node);
+  
+  // create publishers and a timer for the latency statistics
+  stats_pub_ = node.advertise<grasp_selection::PipelineStatistics>("pipeline_stats", 10);
+  diagnostics_pub_ = node.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 10);
+  stats_timer_ = node.createTimer(ros::Duration(stats_period), &Selection::statsTimerCallback, this);
+  memory_pub_ = node.advertise<grasp_selection::MemoryStatistics>("memory_stats", 10);
+  perf_pub_ = node.advertise<grasp_selection::PerfStatistics>("perf_stats", 10);
   
   // wait for joint names to appear on ROS topic
   joint_states_start_index_ = reaching_params.js_first_joint_index_;
@@ -30,155 +39,447 @@ Selection::Selection(ros::NodeHandle& node, const std::string& grasps_topic, con
     ros::spinOnce();
     rate.sleep();
   }
-  std::cout << "Knows joint names:\n";
+  ROS_INFO("Knows joint names:");
   for (int i=0; i < joint_names_.size(); i++)
-    std::cout << " " << i << ". " << joint_names_[i] << std::endl;
-  std::cout << std::endl;
-    
-	scoring_ = new Scoring(urdf, joint_names_, reaching_params.min_aperture_, reaching_params.max_aperture_, 
-    num_selected, scoring_mode_);
+    ROS_INFO(" %i. %s", i, joint_names_[i].c_str());
+  
+  pipeline_ = new SelectionPipeline(reaching_params, planner_params, urdf, joint_names_, num_selected, scoring_mode, 
+    scene_cell_size, createIKSolver(reaching_params, urdf, joint_names_, node));
+  
+  // the events of the stages are recorded by the pipeline statistics
+  if (!trace_directory_.empty())
+  {
+    trace_ = new TraceRecorder;
+    pipeline_->getStats().setTraceRecorder(trace_);
+    ROS_INFO("Writing a Chrome trace of each request to %s", trace_directory_.c_str());
+  }
+  
+  // the stages run in the callbacks, i.e., on this thread
+  if (perf_counters && !pipeline_->getStats().enablePerfCounters())
+    ROS_WARN("Hardware performance counters are not available (see /proc/sys/kernel/perf_event_paranoid)");
+  
+  // the parameters are logged so that the requests can be replayed with the same grasp selection
+  if (!request_log_params.directory_.empty())
+  {
+    grasp_selection::ParametersRecord parameters;
+    createParametersMsg(reaching_params, planner_params, joint_names_, num_selected, scoring_mode, scene_cell_size, 
+      parameters);
+    request_log_ = new RequestLogWriter(request_log_params, parameters);
+  }
+}
+
+
+IKSolver* Selection::createIKSolver(const Reaching::Parameters& params, const urdf::Model& urdf, 
+  const std::vector<std::string>& joint_names, ros::NodeHandle& node)
+{
+  // ikfast and OpenRAVE solve for the joints of the chain, MoveIt returns them in the order of the joint states
+  const int num_joints = params.ik_last_joint_index_ - params.ik_first_joint_index_ + 1;
+  if (params.planning_lib_ == Reaching::OPEN_RAVE)
+    return new OpenRaveIKSolver(node, num_joints, urdf, params.ik_base_link_, params.arm_link_, joint_names);
+  if (params.planning_lib_ == Reaching::IKFAST)
+    return new IKFastSolver(urdf, params.planning_frame_, params.ik_base_link_, params.arm_link_, joint_names);
+  return new MoveItIKSolver(node, params.move_group_, params.arm_link_, params.ik_first_joint_index_, num_joints);
 }
 
 
 void Selection::runNode()
 {
-	ros::Rate rate(1);
-  std::cout << "Waiting for grasps topic input ...\n";
+  ASYNC_LOG_INFO(AsyncLogger::SELECTION, "Waiting for grasps topic input ...");
   
-  while (ros::ok())
-  {
-		ros::spinOnce();
-    rate.sleep();
-	}
+  // the callbacks run as soon as they arrive, one at a time on this thread (the pipeline is not thread-safe)
+  ros::spin();
 }
 
 
-void Selection::graspsCallback(const agile_grasp::Grasps& msg)
+void Selection::graspsCallback(const agile_grasp::Grasps::ConstPtr& msg)
 {
-	if (has_grasps_)
+  PROFILE_SCOPE("Selection::graspsCallback");
+  // a message with the same time stamp describes the same scene
+	if (has_grasps_ && msg->header.stamp == grasps_->header.stamp)
 		return;
 	
+  // keep a reference to the message instead of copying it; the pipeline gets it with the next request, together with
+  // the latest point cloud (or the cloud with the same time stamp, if that arrives later)
 	grasps_ = msg;	
 	has_grasps_ = true;
+  grasps_cloud_ = cloud_;
+  is_scene_changed_ = true;
   
-  std::cout << "Received " << msg.grasps.size() << " grasps\n";
+  ASYNC_LOG_INFO(AsyncLogger::SELECTION, "Received %zu grasps", msg->grasps.size());
 }
 
-void Selection::cloudCallback(const sensor_msgs::PointCloud2& msg)
+void Selection::cloudCallback(const sensor_msgs::PointCloud2::ConstPtr& msg)
 {
-	if (!has_cloud_)
+  PROFILE_SCOPE("Selection::cloudCallback");
+  // a streaming camera sends a new cloud for every frame, so a cloud only changes the scene if it is the cloud that 
+  // the grasps were detected in (same time stamp); the other clouds wait for the next grasps message
+  cloud_ = msg;
+  has_cloud_ = true;
+  if (!has_grasps_ || msg->header.stamp == grasps_->header.stamp)
   {
-    // convert ROS sensor message to PCL point cloud
-    pcl::fromROSMsg(msg, *cloud_);
-    std::cout << "Received point cloud for collision checking\n";
-
-    // downsample the point cloud
-    std::cout << "Voxelizing point cloud ... ";
-    pcl::VoxelGrid<pcl::PointXYZ> vox;
-    vox.setInputCloud(cloud_);
-    vox.setLeafSize(0.006f, 0.006f, 0.006f);
-    vox.filter(*cloud_);
-    std::cout << cloud_->size() << " voxels left\n";
-
-    has_cloud_ = true;
+    grasps_cloud_ = msg;
+    is_scene_changed_ = true;
   }
 }
 
 
-void Selection::jointStatesCallback(const sensor_msgs::JointState& msg)
+void Selection::jointStatesCallback(const sensor_msgs::JointState::ConstPtr& msg)
 {
+  PROFILE_SCOPE("Selection::jointStatesCallback");
   if (joint_names_[0].compare("") == 0)
   {
-    joint_names_.assign(&msg.name[joint_states_start_index_], &msg.name[joint_states_start_index_] + num_joints_);
+    joint_names_.assign(&msg->name[joint_states_start_index_], &msg->name[joint_states_start_index_] + num_joints_);
   }
+  
+  joint_state_ = msg;
+  if (pipeline_ != NULL)
+    pipeline_->setJointState(*msg);
 }
 
 
-grasp_selection::GraspList Selection::createGraspListMsg(const std::vector<GraspScored>& list)
+bool Selection::serviceCallback(grasp_selection::SelectGrasps::Request& request, 
+  grasp_selection::SelectGrasps::Response& response)
 {
-  grasp_selection::GraspList msg;
-  msg.grasps.resize(list.size());
+  PROFILE_SCOPE("Selection::serviceCallback");
+  TraceRecorder::Clock::time_point request_start = TraceRecorder::Clock::now();
+  const ros::Time request_stamp = ros::Time::now();
+  if (pipeline_ != NULL)
+    pipeline_->getStats().startRequest();
+  if (pipeline_ != NULL && is_scene_changed_)
+    updateScene();
+  bool is_selected = (pipeline_ != NULL && pipeline_->selectGrasps(request.hand_pose, response.grasps));
   
-  for (int i=0; i < list.size(); i++)
+  if (!is_selected)
   {
-    grasp_selection::Grasp grasp;
-    grasp.pose = list[i].pose_st_.pose;
-    grasp.approach = list[i].approach_;    
-    msg.grasps[i] = grasp;    
+    ASYNC_LOG_INFO(AsyncLogger::SELECTION, "Waiting for new grasps ...");
+  }
+  else
+  {
+    if (request.return_rejections)
+      createRejectionsMsg(pipeline_->getRejections(), response.rejections);
+    
+    // visualize grasps
+    {
+      StageTimer timer(&pipeline_->getStats(), PipelineStats::VISUALIZATION);
+      drawGrasps(response.grasps);
+    }
+    ASYNC_LOG_INFO(AsyncLogger::SELECTION, "Created response with %zu grasps", response.grasps.grasps.size());
   }
   
-  msg.header.frame_id = planning_frame_;
-  msg.header.stamp = ros::Time::now();
-  return msg;
+  // the hardware counts of the request cover the scene update, the selection and the visualization
+  if (pipeline_ != NULL && pipeline_->getStats().getPerfCounters() != NULL)
+  {
+    pipeline_->getStats().endRequest();
+    publishPerfStats();
+  }
+  
+  if (request_log_ != NULL && pipeline_ != NULL)
+  {
+    const int64_t latency = std::chrono::duration_cast<std::chrono::nanoseconds>(TraceRecorder::Clock::now() 
+      - request_start).count();
+    logRequest(request_stamp, latency, request, response, is_selected);
+  }
+  
+  if (pipeline_ != NULL)
+    publishMemoryStats();
+  
+  if (trace_ != NULL)
+    writeTrace(request_start);
+  
+  return is_selected;
 }
 
 
-bool Selection::serviceCallback(grasp_selection::SelectGrasps::Request& request, 
-  grasp_selection::SelectGrasps::Response& response)
+void Selection::updateScene()
 {
-  if (grasps_.grasps.size() == 0)
+  PROFILE_SCOPE("Selection::updateScene");
+  is_scene_changed_ = false;
+  is_scene_logged_ = false;
+  if (has_grasps_)
+    pipeline_->setGrasps(grasps_);
+  
+  // the cloud is only downsampled and indexed here, once for each scene that is requested
+  if (!grasps_cloud_ || grasps_cloud_ == scene_cloud_)
+    return;
+  if (has_grasps_ && grasps_cloud_->header.frame_id != grasps_->header.frame_id)
   {
-    ROS_ERROR("No grasps available!");
-    has_grasps_ = false;
-    std::cout << "Waiting for new grasps ...\n";
-    return false;
-  }
-         
-  // create feasible grasps
-  std::cout << "Finding reachable grasps ...\n";
-  std::vector<GraspScored> grasp_list = reaching_->selectFeasibleGrasps(grasps_);
-  if (grasp_list.size() == 0)
+    ROS_WARN_THROTTLE(10.0, "The point cloud is in frame %s, the grasps are in frame %s", 
+      grasps_cloud_->header.frame_id.c_str(), grasps_->header.frame_id.c_str());
+  }
+  scene_cloud_ = grasps_cloud_;
+  pipeline_->setPointCloud(*scene_cloud_);
+}
+
+
+void Selection::logRequest(const ros::Time& stamp, int64_t latency, 
+  const grasp_selection::SelectGrasps::Request& request, const grasp_selection::SelectGrasps::Response& response, 
+  bool success)
+{
+  PROFILE_SCOPE("Selection::logRequest");
+  if (!is_scene_logged_)
   {
-    ROS_ERROR("No reachable grasps found!");
-    has_grasps_ = false;
-    std::cout << "Waiting for new grasps ...\n";
-    return false;
-  }
-  			
-  // score those grasps
-  std::vector<GraspScored> scored_list;
-  if (scoring_mode_ == scoring_->SCORING_MODE_NONE)
+    request_log_->writeScene(grasps_ ? *grasps_ : agile_grasp::Grasps(), pipeline_->getPointCloud());
+    is_scene_logged_ = true;
+  }
+  
+  // the rejection counts are always logged, even if the client did not ask for them
+  grasp_selection::RejectionStatistics rejections;
+  createRejectionsMsg(pipeline_->getRejections(), rejections);
+  
+  request_log_->writeRequest(stamp, latency, request, joint_state_ ? *joint_state_ : sensor_msgs::JointState(), 
+    pipeline_->getReachableGrasps(), rejections, success, response.grasps);
+}
+
+
+void Selection::writeTrace(const TraceRecorder::Clock::time_point& request_start)
+{
+  PROFILE_SCOPE("Selection::writeTrace");
+  trace_->record("request", request_start, TraceRecorder::Clock::now(), num_traces_);
+  
+  // the trace also contains the point cloud processing that happened since the previous request
+  char filename[32];
+  snprintf(filename, sizeof(filename), "/request_%06i.json", num_traces_);
+  if (trace_->write(trace_directory_ + filename))
+    ROS_INFO("Wrote trace to %s%s", trace_directory_.c_str(), filename);
+  num_traces_++;
+}
+
+
+void Selection::publishMemoryStats()
+{
+  PROFILE_SCOPE("Selection::publishMemoryStats");
+  const MemoryUsage& request = pipeline_->getRequestMemory();
+  const MemoryUsage& cloud = pipeline_->getCloudMemory();
+  const SelectionPipeline::DataSizes sizes = pipeline_->getDataSizes();
+  
+  grasp_selection::MemoryStatistics msg;
+  msg.header.stamp = ros::Time::now();
+  msg.num_allocations = request.num_allocations_;
+  msg.num_bytes_allocated = request.num_bytes_;
+  msg.cloud_num_allocations = cloud.num_allocations_;
+  msg.cloud_num_bytes_allocated = cloud.num_bytes_;
+  msg.evaluation_num_allocations = pipeline_->getNumEvaluationAllocations();
+  msg.rss = request.rss_;
+  msg.peak_rss_increase = request.peak_rss_increase_;
+  msg.cloud_peak_rss_increase = cloud.peak_rss_increase_;
+  msg.num_cloud_points = sizes.num_cloud_points_;
+  msg.num_voxels = sizes.num_voxels_;
+  msg.cloud_bytes = sizes.cloud_bytes_;
+  msg.scene_index_bytes = sizes.scene_index_bytes_;
+  msg.num_grasps = sizes.num_grasps_;
+  msg.num_candidates = sizes.num_candidates_;
+  msg.num_reachable = sizes.num_reachable_;
+  msg.candidate_bytes = sizes.candidate_bytes_;
+  msg.arena_bytes = sizes.arena_bytes_;
+  memory_pub_.publish(msg);
+  
+  ASYNC_LOG_INFO(AsyncLogger::SELECTION, "Memory: %llu allocations (%.2f MB), peak RSS +%.2f MB; cloud preparation: "
+    "%llu allocations (%.2f MB), peak RSS +%.2f MB; %llu points, %llu voxels", 
+    (unsigned long long) request.num_allocations_, 1e-6 * request.num_bytes_, 1e-6 * request.peak_rss_increase_, 
+    (unsigned long long) cloud.num_allocations_, 1e-6 * cloud.num_bytes_, 1e-6 * cloud.peak_rss_increase_, 
+    (unsigned long long) sizes.num_cloud_points_, (unsigned long long) sizes.num_voxels_);
+}
+
+
+void Selection::publishPerfStats()
+{
+  PROFILE_SCOPE("Selection::publishPerfStats");
+  const PipelineStats& stats = pipeline_->getStats();
+  const PerfCounters::Values& total = stats.getRequestPerfTotal();
+  
+  grasp_selection::PerfStatistics msg;
+  msg.header.stamp = ros::Time::now();
+  msg.cycles = total.counts_[PerfCounters::CYCLES];
+  msg.instructions = total.counts_[PerfCounters::INSTRUCTIONS];
+  msg.cache_misses = total.counts_[PerfCounters::CACHE_MISSES];
+  msg.branch_misses = total.counts_[PerfCounters::BRANCH_MISSES];
+  msg.stages.resize(PipelineStats::NUM_STAGES);
+  msg.stage_cycles.resize(PipelineStats::NUM_STAGES);
+  msg.stage_instructions.resize(PipelineStats::NUM_STAGES);
+  msg.stage_cache_misses.resize(PipelineStats::NUM_STAGES);
+  msg.stage_branch_misses.resize(PipelineStats::NUM_STAGES);
+  for (int i = 0; i < PipelineStats::NUM_STAGES; i++)
   {
-    std::cout << "No scoring used, returning " << grasp_list.size() << " reachable grasps\n";
-    scored_list = grasp_list;    
+    const PipelineStats::Stage stage = static_cast<PipelineStats::Stage>(i);
+    const PerfCounters::Values& counts = stats.getRequestPerfCounts(stage);
+    msg.stages[i] = PipelineStats::getStageName(stage);
+    msg.stage_cycles[i] = counts.counts_[PerfCounters::CYCLES];
+    msg.stage_instructions[i] = counts.counts_[PerfCounters::INSTRUCTIONS];
+    msg.stage_cache_misses[i] = counts.counts_[PerfCounters::CACHE_MISSES];
+    msg.stage_branch_misses[i] = counts.counts_[PerfCounters::BRANCH_MISSES];
   }
-  else
+  perf_pub_.publish(msg);
+}
+
+
+void Selection::statsTimerCallback(const ros::TimerEvent& event)
+{
+  PROFILE_SCOPE("Selection::statsTimerCallback");
+  if (pipeline_ == NULL)
+    return;
+  
+  grasp_selection::PipelineStatistics stats_msg;
+  diagnostic_msgs::DiagnosticArray diagnostics_msg;
+  stats_msg.header.stamp = ros::Time::now();
+  diagnostics_msg.header.stamp = stats_msg.header.stamp;
+  stats_msg.stages.resize(PipelineStats::NUM_STAGES);
+  diagnostics_msg.status.resize(PipelineStats::NUM_STAGES);
+  
+  for (int i = 0; i < PipelineStats::NUM_STAGES; i++)
   {
-    std::cout << "Scoring %i reachable grasps " << grasp_list.size() << " ...\n";
-    scored_list = scoring_->scoreGrasps(grasp_list, request.hand_pose);
+    const PipelineStats::Stage stage = static_cast<PipelineStats::Stage>(i);
+    // the latencies of the last stats period; the cumulative histogram only gives the total count
+    const LatencyHistogram& histogram = pipeline_->getStats().getIntervalHistogram(stage);
+    grasp_selection::StageStatistics& stage_msg = stats_msg.stages[i];
+    stage_msg.stage = PipelineStats::getStageName(stage);
+    stage_msg.total_count = pipeline_->getStats().getHistogram(stage).getCount();
+    stage_msg.count = histogram.getCount();
+    stage_msg.mean = histogram.getMean();
+    stage_msg.p50 = histogram.calculatePercentile(50.0);
+    stage_msg.p95 = histogram.calculatePercentile(95.0);
+    stage_msg.p99 = histogram.calculatePercentile(99.0);
+    stage_msg.max = histogram.getMax();
+    const PerfCounters::Values& counts = pipeline_->getStats().getPerfCounts(stage);
+    stage_msg.cycles = counts.counts_[PerfCounters::CYCLES];
+    stage_msg.instructions = counts.counts_[PerfCounters::INSTRUCTIONS];
+    stage_msg.cache_misses = counts.counts_[PerfCounters::CACHE_MISSES];
+    stage_msg.branch_misses = counts.counts_[PerfCounters::BRANCH_MISSES];
+    
+    // the diagnostics show the latencies in milliseconds
+    diagnostic_msgs::DiagnosticStatus& status = diagnostics_msg.status[i];
+    status.level = diagnostic_msgs::DiagnosticStatus::OK;
+    status.name = std::string("grasp_selection: ") + stage_msg.stage;
+    status.message = (stage_msg.count > 0) ? "OK" : "No data";
+    const char* keys[] = {"count", "mean (ms)", "p50 (ms)", "p95 (ms)", "p99 (ms)", "max (ms)", "total count"};
+    const double values[] = {(double) stage_msg.count, 1e3 * stage_msg.mean, 1e3 * stage_msg.p50, 
+      1e3 * stage_msg.p95, 1e3 * stage_msg.p99, 1e3 * stage_msg.max, (double) stage_msg.total_count};
+    status.values.resize(7);
+    for (int j = 0; j < 7; j++)
+    {
+      status.values[j].key = keys[j];
+      status.values[j].value = boost::lexical_cast<std::string>(values[j]);
+    }
+    
+    // a low IPC with many cache misses per instruction means that the stage waits for memory
+    if (pipeline_->getStats().getPerfCounters() != NULL && stage_msg.cycles > 0 && stage_msg.instructions > 0)
+    {
+      status.values.resize(10);
+      status.values[7].key = "cycles per execution";
+      status.values[7].value = boost::lexical_cast<std::string>(stage_msg.cycles / std::max(stage_msg.total_count, 
+        (uint64_t) 1));
+      status.values[8].key = "instructions per cycle";
+      status.values[8].value = boost::lexical_cast<std::string>((double) stage_msg.instructions / stage_msg.cycles);
+      status.values[9].key = "cache misses per 1000 instructions";
+      status.values[9].value = boost::lexical_cast<std::string>(1e3 * stage_msg.cache_misses 
+        / stage_msg.instructions);
+    }
   }
   
-  // visualize grasps and create ROS message
-  drawGrasps(scored_list);
-  response.grasps = createGraspListMsg(scored_list);
-  std::cout << "Created response with " << (int) response.grasps.grasps.size() << " grasps\n";
   
-  // reset so that grasps msg and point cloud msg can be received again
-  has_grasps_ = false;
-  has_cloud_ = false;
+  // the rejection counts of the reachability test
+  const RejectionCounts& rejections = pipeline_->getStats().getRejections();
+  createRejectionsMsg(rejections, stats_msg.rejections);
+  diagnostic_msgs::DiagnosticStatus status;
+  status.level = diagnostic_msgs::DiagnosticStatus::OK;
+  status.name = "grasp_selection: rejections";
+  status.message = (rejections.getNumGrasps() > 0) ? "OK" : "No data";
+  status.values.resize(3 + 2 * RejectionCounts::NUM_CHECKS);
+  status.values[0].key = "grasps";
+  status.values[0].value = boost::lexical_cast<std::string>(rejections.getNumGrasps());
+  status.values[1].key = "candidates";
+  status.values[1].value = boost::lexical_cast<std::string>(rejections.getNumCandidates());
+  status.values[2].key = "reachable";
+  status.values[2].value = boost::lexical_cast<std::string>(rejections.getNumReachable());
+  for (int i = 0; i < RejectionCounts::NUM_CHECKS; i++)
+  {
+    const RejectionCounts::Check check = static_cast<RejectionCounts::Check>(i);
+    diagnostic_msgs::KeyValue& count = status.values[3 + 2 * i];
+    diagnostic_msgs::KeyValue& time = status.values[4 + 2 * i];
+    count.key = std::string("rejected: ") + RejectionCounts::getCheckName(check);
+    count.value = boost::lexical_cast<std::string>(rejections.getRejected(check));
+    time.key = std::string("rejected time (ms): ") + RejectionCounts::getCheckName(check);
+    time.value = boost::lexical_cast<std::string>(1e3 * rejections.getRejectedTime(check));
+  }
+  diagnostics_msg.status.push_back(status);
+  
+  stats_pub_.publish(stats_msg);
+  diagnostics_pub_.publish(diagnostics_msg);
   
-  return true;
+  // the timer runs on the same thread as the service, so no stage is recorded while the interval is reset
+  pipeline_->getStats().resetInterval();
+}
+
+
+void Selection::createRejectionsMsg(const RejectionCounts& rejections, grasp_selection::RejectionStatistics& msg)
+{
+  msg.num_grasps = rejections.getNumGrasps();
+  msg.num_candidates = rejections.getNumCandidates();
+  msg.num_reachable = rejections.getNumReachable();
+  msg.checks.resize(RejectionCounts::NUM_CHECKS);
+  msg.rejected.resize(RejectionCounts::NUM_CHECKS);
+  msg.rejected_time.resize(RejectionCounts::NUM_CHECKS);
+  for (int i = 0; i < RejectionCounts::NUM_CHECKS; i++)
+  {
+    const RejectionCounts::Check check = static_cast<RejectionCounts::Check>(i);
+    msg.checks[i] = RejectionCounts::getCheckName(check);
+    msg.rejected[i] = rejections.getRejected(check);
+    msg.rejected_time[i] = rejections.getRejectedTime(check);
+  }
+}
+
+
+void Selection::createParametersMsg(const Reaching::Parameters& reaching_params, 
+  const TrajectoryPlanner::Parameters& planner_params, const std::vector<std::string>& joint_names, int num_selected, 
+  int scoring_mode, double scene_cell_size, grasp_selection::ParametersRecord& msg)
+{
+  msg.joint_names = joint_names;
+  msg.planning_library = reaching_params.planning_lib_;
+  msg.workspace = reaching_params.workspace_;
+  msg.min_aperture = reaching_params.min_aperture_;
+  msg.max_aperture = reaching_params.max_aperture_;
+  msg.num_additional_grasps = reaching_params.num_additional_grasps_;
+  msg.axis_order.assign(reaching_params.axis_order_.begin(), reaching_params.axis_order_.end());
+  msg.planning_frame = reaching_params.planning_frame_;
+  msg.hand_offset = reaching_params.hand_offset_;
+  msg.arm_link = reaching_params.arm_link_;
+  msg.move_group = reaching_params.move_group_;
+  msg.max_colliding_points = reaching_params.max_colliding_points_;
+  msg.ik_first_joint_index = reaching_params.ik_first_joint_index_;
+  msg.ik_last_joint_index = reaching_params.ik_last_joint_index_;
+  msg.js_first_joint_index = reaching_params.js_first_joint_index_;
+  msg.js_last_joint_index = reaching_params.js_last_joint_index_;
+  msg.ik_base_link = reaching_params.ik_base_link_;
+  msg.pregrasp_offsets = reaching_params.pregrasp_offsets_;
+  msg.max_joint_step = reaching_params.max_joint_step_;
+  msg.num_preplanned = planner_params.num_preplanned_;
+  msg.trajectory_resolution = planner_params.resolution_;
+  msg.velocity_scaling = planner_params.velocity_scaling_;
+  msg.link_radius = planner_params.link_radius_;
+  msg.num_selected = num_selected;
+  msg.scoring_mode = scoring_mode;
+  msg.scene_cell_size = scene_cell_size;
 }
 
 
-void Selection::drawGrasps(const std::vector<GraspScored>& list)
+void Selection::drawGrasps(const grasp_selection::GraspList& grasps)
 {
+  PROFILE_SCOPE("Selection::drawGrasps");
   double cyan[3] = {0, 1, 1};
   visualization_msgs::MarkerArray marker_array;
-  marker_array.markers.resize(list.size());  
+  marker_array.markers.resize(grasps.grasps.size());  
   
-  for (int i=0; i < list.size(); i++)
+  for (int i=0; i < grasps.grasps.size(); i++)
   {
-    geometry_msgs::Point position = list[i].pose_st_.pose.position;
-    position.x += hand_offset_ * list[i].approach_.x;
-    position.y += hand_offset_ * list[i].approach_.y;
-    position.z += hand_offset_ * list[i].approach_.z;
-    marker_array.markers[i] = createApproachMarker(planning_frame_, position, list[i].approach_, i, cyan, 0.4, 0.008);
+    const grasp_selection::Grasp& grasp = grasps.grasps[i];
+    geometry_msgs::Point position;
+    position.x = grasp.pose.position.x + hand_offset_ * grasp.approach.x;
+    position.y = grasp.pose.position.y + hand_offset_ * grasp.approach.y;
+    position.z = grasp.pose.position.z + hand_offset_ * grasp.approach.z;
+    marker_array.markers[i] = createApproachMarker(planning_frame_, position, grasp.approach, i, cyan, 0.4, 0.008);
   }
   
   visuals_pub_.publish(marker_array);
-  std::cout << "Visualizing grasps ...\n";
-  ros::Duration(1.0).sleep();
+  ASYNC_LOG_INFO(AsyncLogger::SELECTION, "Visualizing grasps ...");
 }
 
 
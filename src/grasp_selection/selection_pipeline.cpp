@@ -0,0 +1,289 @@
+#include <grasp_selection/selection_pipeline.h>
+
+#include <algorithm>
+
+
+SelectionPipeline::SelectionPipeline(const Reaching::Parameters& reaching_params,
+  const TrajectoryPlanner::Parameters& planner_params, const urdf::Model& urdf,
+  const std::vector<std::string>& joint_names, int num_selected, int scoring_mode, double scene_cell_size,
+  IKSolver* ik_solver)
+  : cloud_(new PointCloud), scene_index_(scene_cell_size), is_scene_evaluated_(false), joint_names_(joint_names),
+    has_joint_positions_(false), joint_states_start_index_(reaching_params.js_first_joint_index_),
+    planning_frame_(reaching_params.planning_frame_), scoring_mode_(scoring_mode)
+{
+  cloud_memory_ = MemoryUsage();
+  request_memory_ = MemoryUsage();
+  num_cloud_points_ = 0;
+  num_evaluation_allocations_ = 0;
+  reaching_ = new Reaching(reaching_params, ik_solver);
+  reaching_->setSceneIndex(&scene_index_);
+  reaching_->setPipelineStats(&stats_);
+  reaching_->setRejectionCounts(&rejections_);
+  scoring_ = new Scoring(urdf, joint_names_, reaching_params.min_aperture_, reaching_params.max_aperture_,
+    num_selected, scoring_mode_);
+  planner_ = new TrajectoryPlanner(planner_params, urdf, planning_frame_, reaching_params.arm_link_, joint_names_);
+}
+
+
+void SelectionPipeline::setPointCloud(const sensor_msgs::PointCloud2& msg)
+{
+  PROFILE_SCOPE("SelectionPipeline::setPointCloud");
+  MemoryProbe memory_probe(cloud_memory_);
+  num_cloud_points_ = (uint64_t) msg.width * msg.height;
+  
+  // convert ROS sensor message to PCL point cloud
+  {
+    StageTimer timer(&stats_, PipelineStats::CLOUD_CONVERSION);
+    pcl::fromROSMsg(msg, *cloud_);
+  }
+  ASYNC_LOG_INFO(AsyncLogger::SELECTION, "Received point cloud for collision checking");
+
+  // downsample the point cloud
+  {
+    StageTimer timer(&stats_, PipelineStats::VOXELIZATION);
+    pcl::VoxelGrid<pcl::PointXYZ> vox;
+    vox.setInputCloud(cloud_);
+    vox.setLeafSize(0.006f, 0.006f, 0.006f);
+    vox.filter(*cloud_);
+  }
+  ASYNC_LOG_INFO(AsyncLogger::SELECTION, "Voxelized point cloud, %zu voxels left", cloud_->size());
+
+  // the collision checks only visit the points near the checked shapes
+  {
+    StageTimer timer(&stats_, PipelineStats::SCENE_INDEXING);
+    scene_index_.setPointCloud(*cloud_);
+  }
+
+  is_scene_evaluated_ = false;
+}
+
+
+SelectionPipeline::DataSizes SelectionPipeline::getDataSizes() const
+{
+  DataSizes sizes;
+  sizes.num_cloud_points_ = num_cloud_points_;
+  sizes.num_voxels_ = cloud_->size();
+  sizes.cloud_bytes_ = cloud_->points.capacity() * sizeof(pcl::PointXYZ);
+  sizes.scene_index_bytes_ = scene_index_.getMemorySize();
+  sizes.num_grasps_ = grasps_ ? grasps_->grasps.size() : 0;
+  sizes.num_candidates_ = rejections_.getNumCandidates();
+  sizes.num_reachable_ = feasible_grasps_.size();
+  sizes.candidate_bytes_ = feasible_grasps_.getMemorySize();
+  sizes.arena_bytes_ = arena_.getStatistics().num_bytes_;
+  return sizes;
+}
+
+
+void SelectionPipeline::setGrasps(const agile_grasp::Grasps::ConstPtr& msg)
+{
+  grasps_ = msg;
+  is_scene_evaluated_ = false;
+}
+
+
+void SelectionPipeline::setJointState(const sensor_msgs::JointState& msg)
+{
+  PROFILE_SCOPE("SelectionPipeline::setJointState");
+  // the start of the preplanned trajectories, in the order of the joint names like the IK solutions
+  const int num_joints = joint_names_.size();
+  if (msg.position.size() >= joint_states_start_index_ + num_joints)
+  {
+    joint_positions_.assign(&msg.position[joint_states_start_index_],
+      &msg.position[joint_states_start_index_] + num_joints);
+    for (int i = 0; i < num_joints; i++)
+    {
+      std::vector<std::string>::const_iterator it = std::find(msg.name.begin(), msg.name.end(), joint_names_[i]);
+      if (it != msg.name.end() && it - msg.name.begin() < msg.position.size())
+        joint_positions_[i] = msg.position[it - msg.name.begin()];
+    }
+    has_joint_positions_ = true;
+  }
+
+  reaching_->getIKSolver().setJointState(msg);
+}
+
+
+bool SelectionPipeline::selectGrasps(const geometry_msgs::Pose& hand_pose, grasp_selection::GraspList& msg)
+{
+  PROFILE_SCOPE("SelectionPipeline::selectGrasps");
+  MemoryProbe memory_probe(request_memory_);
+  
+  // all temporary data of the previous request is released at once
+  arena_.reset();
+  
+  // the heap allocations of the evaluation, apart from those of the IK backend, which the arena cannot serve
+  const uint64_t num_allocations = AllocationCounter::getNumAllocations() - stats_.getNumIKAllocations();
+
+  if (!hasGrasps())
+  {
+    ROS_ERROR("No grasps available!");
+    return false;
+  }
+
+  // reachability and the hand pose independent scores only change with the scene, so they are only calculated once
+  // for each new grasps or point cloud message
+  if (!is_scene_evaluated_)
+  {
+    ASYNC_LOG_INFO(AsyncLogger::SELECTION, "Finding reachable grasps ...");
+    rejections_.reset();
+    reaching_->selectFeasibleGrasps(*grasps_, feasible_grasps_, arena_);
+    stats_.getRejections().add(rejections_);
+    if (scoring_mode_ != scoring_->SCORING_MODE_NONE)
+    {
+      ASYNC_LOG_INFO(AsyncLogger::SELECTION, "Ranking %i reachable grasps ...", feasible_grasps_.size());
+      StageTimer timer(&stats_, PipelineStats::SCORING);
+      scoring_->rankGrasps(feasible_grasps_, arena_, ranking_);
+    }
+    is_scene_evaluated_ = true;
+  }
+  else
+  {
+    ASYNC_LOG_INFO(AsyncLogger::SELECTION, "Scene has not changed, reusing %i reachable grasps", 
+      feasible_grasps_.size());
+  }
+
+  if (feasible_grasps_.size() == 0)
+  {
+    num_evaluation_allocations_ = AllocationCounter::getNumAllocations() - stats_.getNumIKAllocations() 
+      - num_allocations;
+    ROS_ERROR("No reachable grasps found! Rejected of %i grasps: %i (workspace), %i (aperture); rejected of %i "
+      "candidates: %i (IK), %i (collision), %i (approach)", (int) rejections_.getNumGrasps(), 
+      (int) rejections_.getRejected(RejectionCounts::WORKSPACE), 
+      (int) rejections_.getRejected(RejectionCounts::APERTURE), (int) rejections_.getNumCandidates(), 
+      (int) rejections_.getRejected(RejectionCounts::INVERSE_KINEMATICS), 
+      (int) rejections_.getRejected(RejectionCounts::COLLISION), 
+      (int) rejections_.getRejected(RejectionCounts::APPROACH));
+    return false;
+  }
+
+  // score those grasps
+  Scoring::Ranking selected = {ArenaVector<int>(ArenaAllocator<int>(&arena_)),
+    ArenaVector<double>(ArenaAllocator<double>(&arena_)), 0};
+  if (scoring_mode_ == scoring_->SCORING_MODE_NONE)
+  {
+    ASYNC_LOG_INFO(AsyncLogger::SELECTION, "No scoring used, returning %i reachable grasps", feasible_grasps_.size());
+    selected.indices_.resize(feasible_grasps_.size());
+    selected.scores_.assign(feasible_grasps_.size(), 0.0);
+    for (int i = 0; i < selected.indices_.size(); i++)
+      selected.indices_[i] = i;
+  }
+  else
+  {
+    ASYNC_LOG_INFO(AsyncLogger::SELECTION, "Scoring %i reachable grasps ...", feasible_grasps_.size());
+    StageTimer timer(&stats_, PipelineStats::SCORING);
+    selected = scoring_->selectGrasps(feasible_grasps_, ranking_, hand_pose, arena_);
+  }
+  num_evaluation_allocations_ = AllocationCounter::getNumAllocations() - stats_.getNumIKAllocations() 
+    - num_allocations;
+
+  // create ROS message
+  {
+    StageTimer timer(&stats_, PipelineStats::RESPONSE);
+    createGraspListMsg(feasible_grasps_, selected, hand_pose, msg);
+  }
+  {
+    StageTimer timer(&stats_, PipelineStats::TRAJECTORY_PLANNING);
+    preplanTrajectories(feasible_grasps_, selected, msg);
+  }
+
+  const Arena::Statistics& arena_stats = arena_.getStatistics();
+  ASYNC_LOG_INFO(AsyncLogger::SELECTION, "Request arena: %zu allocations, %zu bytes, %zu blocks allocated from the "
+    "heap", arena_stats.num_allocations_, arena_stats.num_bytes_, arena_stats.num_heap_allocations_);
+
+  return true;
+}
+
+
+void SelectionPipeline::createGraspListMsg(const CandidateStore& grasps, const Scoring::Ranking& selected,
+  const geometry_msgs::Pose& hand_pose, grasp_selection::GraspList& msg)
+{
+  PROFILE_SCOPE("SelectionPipeline::createGraspListMsg");
+  msg.grasps.resize(selected.indices_.size());
+
+  for (int i=0; i < selected.indices_.size(); i++)
+  {
+    const int idx = selected.indices_[i];
+    grasp_selection::Grasp& grasp = msg.grasps[i];
+    tf::pointEigenToMsg(grasps.getPosition(idx), grasp.pose.position);
+    tf::quaternionEigenToMsg(Eigen::Quaterniond(grasps.getOrientation(idx)), grasp.pose.orientation);
+    tf::vectorEigenToMsg(grasps.getApproach(idx), grasp.approach);
+    grasp.grasp_id = grasps.getId(idx);
+
+    // the IK solution lets clients move to the grasp in joint space without solving IK again
+    const double* joint_positions = grasps.getJointPositions(idx);
+    grasp.joint_names = joint_names_;
+    grasp.joint_positions.assign(joint_positions, joint_positions + grasps.getNumJoints());
+
+    // the IK solutions for the pre-grasp poses along the approach
+    const double* pregrasp_joint_positions = grasps.getPregraspJointPositions(idx);
+    grasp.pregrasp_offsets = reaching_->getPregraspOffsets();
+    grasp.pregrasp_joint_positions.assign(pregrasp_joint_positions,
+      pregrasp_joint_positions + grasps.getNumPregrasps() * grasps.getNumJoints());
+
+    // the score used for the selection, and the scores of the individual scoring functions
+    grasp.score = selected.scores_[i];
+    grasp.joint_limits_score = scoring_->calculateJointScore(joint_positions);
+    grasp.aperture_score = scoring_->calculateApertureScore(grasps.getWidth(idx));
+    grasp.workspace_distance = scoring_->calculateWorkspaceDistance(grasps.getPosition(idx), hand_pose);
+    grasp.trajectory = trajectory_msgs::JointTrajectory();
+  }
+
+  msg.header.frame_id = planning_frame_;
+  msg.header.stamp = ros::Time::now();
+}
+
+
+void SelectionPipeline::preplanTrajectories(const CandidateStore& grasps, const Scoring::Ranking& selected,
+  grasp_selection::GraspList& msg)
+{
+  PROFILE_SCOPE("SelectionPipeline::preplanTrajectories");
+  const int num_preplanned = std::min(planner_->getParameters().num_preplanned_, (int) selected.indices_.size());
+  if (num_preplanned <= 0)
+    return;
+
+  if (!has_joint_positions_)
+  {
+    ROS_WARN("No joint positions available, no trajectories planned");
+    return;
+  }
+
+  // the waypoints go from the outermost pre-grasp pose to the grasp pose, and are copied before the parallel section
+  // because the arena is not thread-safe
+  const int n = grasps.getNumJoints();
+  const int num_waypoints = grasps.getNumPregrasps() + 1;
+  double* waypoints = arena_.allocateArray<double>(num_preplanned * num_waypoints * n);
+  for (int i = 0; i < num_preplanned; i++)
+  {
+    const int idx = selected.indices_[i];
+    const double* pregrasp_joint_positions = grasps.getPregraspJointPositions(idx);
+    double* grasp_waypoints = waypoints + i * num_waypoints * n;
+    for (int j = 0; j < num_waypoints - 1; j++)
+    {
+      const double* source = pregrasp_joint_positions + (num_waypoints - 2 - j) * n;
+      std::copy(source, source + n, grasp_waypoints + j * n);
+    }
+    const double* joint_positions = grasps.getJointPositions(idx);
+    std::copy(joint_positions, joint_positions + n, grasp_waypoints + (num_waypoints - 1) * n);
+  }
+
+  int num_feasible = 0;
+
+#pragma omp parallel for schedule(dynamic) reduction(+: num_feasible)
+  for (int i = 0; i < num_preplanned; i++)
+  {
+    TraceScope scope(stats_.getTraceRecorder(), "trajectory", msg.grasps[i].grasp_id);
+    PROFILE_SCOPE("SelectionPipeline::preplanTrajectories/trajectory");
+    trajectory_msgs::JointTrajectory& trajectory = msg.grasps[i].trajectory;
+    if (planner_->planTrajectory(&joint_positions_[0], waypoints + i * num_waypoints * n, num_waypoints, scene_index_,
+      trajectory))
+    {
+      trajectory.header.frame_id = planning_frame_;
+      num_feasible++;
+    }
+    else
+      trajectory = trajectory_msgs::JointTrajectory();
+  }
+
+  ASYNC_LOG_INFO(AsyncLogger::SELECTION, "Planned %i collision-free trajectories for the top %i grasps", 
+    num_feasible, num_preplanned);
+}
@@ -0,0 +1,94 @@
+#include <grasp_selection/trace_recorder.h>
+
+#include <ros/console.h>
+
+#include <cstdio>
+
+
+std::atomic<uint64_t> TraceRecorder::next_id_(1);
+
+
+TraceRecorder::TraceRecorder(int capacity) : id_(next_id_++), capacity_(capacity), origin_(Clock::now())
+{ }
+
+
+TraceRecorder::~TraceRecorder()
+{
+  for (int i = 0; i < buffers_.size(); i++)
+    delete buffers_[i];
+}
+
+
+bool TraceRecorder::write(const std::string& filename)
+{
+  FILE* file = fopen(filename.c_str(), "w");
+  if (file == NULL)
+  {
+    ROS_ERROR("Could not open trace file %s", filename.c_str());
+    return false;
+  }
+
+  // one complete event ("X") per recorded event, with timestamps in microseconds
+  fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+  bool is_first = true;
+  size_t num_dropped = 0;
+  for (int i = 0; i < buffers_.size(); i++)
+  {
+    const ThreadBuffer* buffer = buffers_[i];
+    fprintf(file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %i, "
+      "\"args\": {\"name\": \"thread %i\"}}", is_first ? "" : ",\n", buffer->index_, buffer->index_);
+    is_first = false;
+
+    for (int j = 0; j < buffer->events_.size(); j++)
+    {
+      const Event& event = buffer->events_[j];
+      fprintf(file, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %i, \"ts\": %.3f, \"dur\": %.3f",
+        event.name_, buffer->index_, 1e-3 * event.start_, 1e-3 * event.duration_);
+      if (event.id_ >= 0)
+        fprintf(file, ", \"args\": {\"id\": %i}", event.id_);
+      fprintf(file, "}");
+    }
+    num_dropped += buffer->num_dropped_;
+  }
+  fprintf(file, "\n]}\n");
+
+  bool is_written = (ferror(file) == 0);
+  fclose(file);
+
+  if (num_dropped > 0)
+    ROS_WARN("%zu trace events did not fit into the trace buffers and were dropped", num_dropped);
+
+  clear();
+  return is_written;
+}
+
+
+void TraceRecorder::clear()
+{
+  for (int i = 0; i < buffers_.size(); i++)
+  {
+    buffers_[i]->events_.clear();
+    buffers_[i]->num_dropped_ = 0;
+  }
+}
+
+
+TraceRecorder::ThreadBuffer* TraceRecorder::findThreadBuffer()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  std::thread::id thread = std::this_thread::get_id();
+  for (int i = 0; i < buffers_.size(); i++)
+  {
+    if (buffers_[i]->thread_ == thread)
+      return buffers_[i];
+  }
+
+  ThreadBuffer* buffer = new ThreadBuffer;
+  buffer->thread_ = thread;
+  buffer->index_ = buffers_.size();
+  buffer->events_.reserve(capacity_);
+  buffer->num_dropped_ = 0;
+  buffers_.push_back(buffer);
+  return buffer;
+}
@@ -0,0 +1,110 @@
+#include <grasp_selection/trajectory_planner.h>
+
+#include <algorithm>
+#include <cmath>
+
+
+TrajectoryPlanner::TrajectoryPlanner(const Parameters& params, const urdf::Model& urdf, const std::string& base_link,
+  const std::string& tip_link, const std::vector<std::string>& joint_names)
+  : params_(params), kinematics_(urdf, base_link, tip_link, joint_names), joint_names_(joint_names)
+{ }
+
+
+bool TrajectoryPlanner::planTrajectory(const double* start, const double* waypoints, int num_waypoints,
+  const SceneIndex& index, trajectory_msgs::JointTrajectory& trajectory) const
+{
+  const int n = joint_names_.size();
+  trajectory.joint_names = joint_names_;
+  trajectory.points.resize(1);
+  trajectory.points[0].positions.assign(start, start + n);
+  trajectory.points[0].velocities.assign(n, 0.0);
+  trajectory.points[0].time_from_start = ros::Duration(0.0);
+
+  // transit segment; the start is the current arm configuration and is not checked
+  if (!kinematics_.isValid() || !appendSegment(start, waypoints, &index, trajectory))
+    return false;
+
+  // approach segments; the reachability test only checks the robot hand, so the arm links are checked here
+  for (int i = 1; i < num_waypoints; i++)
+    if (!appendSegment(waypoints + (i - 1) * n, waypoints + i * n, &index, trajectory))
+      return false;
+
+  return true;
+}
+
+
+bool TrajectoryPlanner::appendSegment(const double* from, const double* to, const SceneIndex* index,
+  trajectory_msgs::JointTrajectory& trajectory) const
+{
+  const int n = joint_names_.size();
+  const std::vector<double>& velocity_limits = kinematics_.getVelocityLimits();
+  Eigen::Map<const Eigen::VectorXd> q0(from, n);
+  Eigen::Map<const Eigen::VectorXd> q1(to, n);
+  Eigen::VectorXd delta = q1 - q0;
+
+  // the peak velocity of the minimum jerk profile is 1.875 times the average velocity
+  double duration = 0.0;
+  for (int j = 0; j < n; j++)
+    duration = std::max(duration, 1.875 * fabs(delta(j)) / (params_.velocity_scaling_ * velocity_limits[j]));
+  if (duration == 0.0)
+    return true;
+
+  int num_samples = std::max(1, (int) ceil(delta.cwiseAbs().maxCoeff() / params_.resolution_));
+  double start_time = trajectory.points.back().time_from_start.toSec();
+  Eigen::VectorXd q(n);
+  for (int k = 1; k <= num_samples; k++)
+  {
+    // minimum jerk time scaling: s(t) = 10t^3 - 15t^4 + 6t^5
+    double t = (double) k / num_samples;
+    double s = t * t * t * (10.0 - 15.0 * t + 6.0 * t * t);
+    double ds = 30.0 * t * t * (1.0 - t) * (1.0 - t) / duration;
+    q = q0 + s * delta;
+
+    // every sample is checked, including the waypoint at the end of the segment
+    if (index != NULL && !isCollisionFree(q.data(), *index))
+      return false;
+
+    trajectory_msgs::JointTrajectoryPoint point;
+    point.positions.assign(q.data(), q.data() + n);
+    point.velocities.resize(n);
+    Eigen::Map<Eigen::VectorXd>(&point.velocities[0], n) = ds * delta;
+    point.time_from_start = ros::Duration(start_time + t * duration);
+    trajectory.points.push_back(point);
+  }
+
+  return true;
+}
+
+
+bool TrajectoryPlanner::isCollisionFree(const double* joint_positions, const SceneIndex& index) const
+{
+  std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > origins(kinematics_.getNumFrames());
+  kinematics_.calculateFrameOrigins(joint_positions, &origins[0]);
+
+  // approximate each link by a capsule between consecutive frame origins
+  const double r = params_.link_radius_;
+  int num_colliding = 0;
+  for (int i = 0; i + 1 < origins.size(); i++)
+  {
+    const Eigen::Vector3d& a = origins[i];
+    Eigen::Vector3d ab = origins[i + 1] - a;
+    double length2 = ab.squaredNorm();
+    if (length2 == 0.0)
+      continue;
+
+    Eigen::Vector3d min = a.cwiseMin(origins[i + 1]) - Eigen::Vector3d::Constant(r);
+    Eigen::Vector3d max = a.cwiseMax(origins[i + 1]) + Eigen::Vector3d::Constant(r);
+    bool is_free = index.visitPoints(min, max, [&](const Eigen::Vector3d& p)
+    {
+      double t = std::min(1.0, std::max(0.0, (p - a).dot(ab) / length2));
+      if ((a + t * ab - p).squaredNorm() <= r * r)
+        num_colliding++;
+      return num_colliding <= params_.max_colliding_points_;
+    });
+
+    if (!is_free)
+      return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,293 @@
+#include <ros/ros.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <moveit_msgs/GetPositionIK.h>
+
+#include <grasp_selection/ik_trace.h>
+
+#include <grasp_selection/SolveIK.h>
+
+
+// Stand-in for the MoveIt /compute_ik and the OpenRAVE /ikfast_solver services: answers each IK request with the
+// response recorded for the closest pose in an IK trace (see the ik_trace_file parameter of the selection node), after
+// a delay drawn from a configurable latency distribution. This allows the selection node to be load-tested without
+// MoveIt, OpenRAVE or the robot.
+
+
+/** IKReplay class
+ *
+ * \brief Serves IK requests from an IK trace
+ *
+*/
+class IKReplay
+{
+  public:
+
+    /** The distributions of the injected latency. */
+    enum LatencyModel
+    {
+      LATENCY_NONE, ///< answer immediately
+      LATENCY_RECORDED, ///< the latency recorded for the matching request
+      LATENCY_CONSTANT, ///< always the mean
+      LATENCY_UNIFORM, ///< uniform in [min, max]
+      LATENCY_NORMAL, ///< normal with the mean and standard deviation, clamped to [min, max]
+      LATENCY_LOGNORMAL ///< log-normal with the mean and standard deviation (of the latency), clamped to [min, max]
+    };
+
+    /**
+     * \brief Constructor.
+     * \param trace the IK trace
+     * \param max_distance the maximum distance between a requested and a recorded pose
+     * \param latency_model the distribution of the injected latency
+     * \param mean the mean latency (seconds)
+     * \param stddev the standard deviation of the latency (seconds)
+     * \param min the minimum latency (seconds)
+     * \param max the maximum latency (seconds)
+     * \param seed the seed of the random number generator
+     * \param joint_names the names of all joints in the robot state returned to MoveIt requests
+     * \param first_joint_index the index of the first arm joint in that robot state
+     * \param chain_order the index in the recorded solutions of each joint of the ikfast chain (empty if the trace is
+     * in the order of the chain)
+    */
+    IKReplay(const IKTrace& trace, double max_distance, LatencyModel latency_model, double mean, double stddev,
+      double min, double max, int seed, const std::vector<std::string>& joint_names, int first_joint_index,
+      const std::vector<int>& chain_order)
+      : trace_(trace), max_distance_(max_distance), latency_model_(latency_model), mean_(mean), min_(min),
+      max_(max), random_(seed), joint_names_(joint_names), first_joint_index_(first_joint_index),
+      chain_order_(chain_order), num_requests_(0), num_matched_(0)
+    {
+      // the robot state holds the arm joints of the trace at first_joint_index, and has a name for each position
+      joint_names_.resize(std::max((int) joint_names.size(), first_joint_index + trace.getNumJoints()));
+
+      if (mean > 0.0 && stddev > 0.0)
+      {
+        normal_ = std::normal_distribution<double>(mean, stddev);
+
+        // the parameters of the underlying normal distribution that give the requested mean and deviation
+        const double variance = log(1.0 + (stddev * stddev) / (mean * mean));
+        lognormal_ = std::lognormal_distribution<double>(log(mean) - 0.5 * variance, sqrt(variance));
+      }
+    }
+
+    bool computeIK(moveit_msgs::GetPositionIK::Request& req, moveit_msgs::GetPositionIK::Response& res)
+    {
+      const IKTraceRecord* record = lookUp(req.ik_request.pose_stamped.pose);
+
+      sensor_msgs::JointState& solution = res.solution.joint_state;
+      solution.name = joint_names_;
+      solution.position.assign(joint_names_.size(), 0.0);
+      if (record == NULL || !record->success_)
+      {
+        res.error_code.val = res.error_code.NO_IK_SOLUTION;
+        return true;
+      }
+
+      std::copy(record->joint_positions_.begin(), record->joint_positions_.end(),
+        solution.position.begin() + first_joint_index_);
+      res.error_code.val = res.error_code.SUCCESS;
+      return true;
+    }
+
+    bool solveIK(grasp_selection::SolveIK::Request& req, grasp_selection::SolveIK::Response& res)
+    {
+      const IKTraceRecord* record = lookUp(req.target_pose);
+      res.success = (record != NULL && record->success_);
+      if (!res.success)
+        res.solution.clear();
+      else if (chain_order_.empty())
+        res.solution = record->joint_positions_;
+      else
+      {
+        // the trace is in the order of the joint states, the service answers in the order of the ikfast chain
+        res.solution.resize(chain_order_.size());
+        for (int i = 0; i < chain_order_.size(); i++)
+          res.solution[i] = record->joint_positions_[chain_order_[i]];
+      }
+      return true;
+    }
+
+    void printStatistics() const
+    {
+      ROS_INFO("Answered %llu IK requests, %llu of them from a recorded pose", (unsigned long long) num_requests_,
+        (unsigned long long) num_matched_);
+    }
+
+
+  private:
+
+    /**
+     * \brief Find the recorded request for a pose, and wait for the injected latency.
+     * \param pose the requested pose
+     * \return the recorded request, or NULL if no recorded pose is close enough
+    */
+    const IKTraceRecord* lookUp(const geometry_msgs::Pose& pose)
+    {
+      double distance;
+      const int index = trace_.findNearest(pose, max_distance_, distance);
+      const IKTraceRecord* record = (index >= 0) ? &trace_.getRecord(index) : NULL;
+
+      double latency = 0.0;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        num_requests_++;
+        if (record != NULL)
+          num_matched_++;
+        latency = sampleLatency(record);
+      }
+
+      if (latency > 0.0)
+        ros::Duration(latency).sleep();
+      return record;
+    }
+
+    /**
+     * \brief Draw a latency from the latency distribution (the caller holds the lock).
+     * \param record the recorded request (NULL if there is none)
+     * \return the latency (seconds)
+    */
+    double sampleLatency(const IKTraceRecord* record)
+    {
+      switch (latency_model_)
+      {
+        case LATENCY_RECORDED:
+          return (record != NULL) ? record->latency_ * 1e-9 : mean_;
+        case LATENCY_CONSTANT:
+          return mean_;
+        case LATENCY_UNIFORM:
+          return std::uniform_real_distribution<double>(min_, max_)(random_);
+        case LATENCY_NORMAL:
+          return std::min(std::max(normal_(random_), min_), max_);
+        case LATENCY_LOGNORMAL:
+          return std::min(std::max(lognormal_(random_), min_), max_);
+        default:
+          return 0.0;
+      }
+    }
+
+    const IKTrace& trace_; ///< the IK trace
+    double max_distance_; ///< the maximum distance between a requested and a recorded pose
+    LatencyModel latency_model_; ///< the distribution of the injected latency
+    double mean_; ///< the mean latency
+    double min_; ///< the minimum latency
+    double max_; ///< the maximum latency
+    std::mt19937 random_; ///< the random number generator of the latencies
+    std::normal_distribution<double> normal_; ///< the normal latency distribution
+    std::lognormal_distribution<double> lognormal_; ///< the log-normal latency distribution
+    std::vector<std::string> joint_names_; ///< the names of all joints in the robot state (one for each position)
+    int first_joint_index_; ///< the index of the first arm joint in that robot state
+    std::vector<int> chain_order_; ///< the index in the recorded solutions of each joint of the ikfast chain
+    std::mutex mutex_; ///< protects the random number generator and the counters
+    uint64_t num_requests_; ///< the number of answered requests
+    uint64_t num_matched_; ///< the number of requests answered from a recorded pose
+};
+
+
+/** Parse the name of a latency model. */
+bool parseLatencyModel(const std::string& name, IKReplay::LatencyModel& model)
+{
+  static const char* names[] = {"none", "recorded", "constant", "uniform", "normal", "lognormal"};
+  for (int i = 0; i <= IKReplay::LATENCY_LOGNORMAL; i++)
+  {
+    if (name == names[i])
+    {
+      model = static_cast<IKReplay::LatencyModel>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+
+int main(int argc, char** argv)
+{
+  // initialize ROS
+  ros::init(argc, argv, "ik_replay");
+  ros::NodeHandle node("~");
+
+  std::string trace_filename;
+  if (!node.getParam("trace_file", trace_filename))
+  {
+    ROS_ERROR("The trace_file parameter is not set");
+    return -1;
+  }
+
+  double max_distance, cell_size, orientation_weight;
+  node.param("max_pose_distance", max_distance, 0.02);
+  node.param("cell_size", cell_size, 0.02);
+  node.param("orientation_weight", orientation_weight, 0.1);
+
+  std::string latency_name;
+  double latency_mean, latency_stddev, latency_min, latency_max;
+  int seed, num_threads;
+  node.param("latency_model", latency_name, std::string("recorded"));
+  node.param("latency_mean", latency_mean, 0.01);
+  node.param("latency_stddev", latency_stddev, 0.005);
+  node.param("latency_min", latency_min, 0.0);
+  node.param("latency_max", latency_max, 1.0);
+  node.param("seed", seed, 1);
+  node.param("num_threads", num_threads, 4);
+
+  std::vector<std::string> joint_names;
+  int first_joint_index;
+  node.getParam("joint_names", joint_names);
+  node.param("first_joint_index", first_joint_index, 0);
+
+  // the selection node records the arm joints in the order of the joint states (the order of joint_names), while
+  // /ikfast_solver answers in the order of the ikfast chain
+  std::vector<std::string> ikfast_joint_names;
+  std::vector<int> chain_order;
+  node.getParam("ikfast_joint_names", ikfast_joint_names);
+  for (int i = 0; i < ikfast_joint_names.size(); i++)
+  {
+    std::vector<std::string>::const_iterator it = std::find(joint_names.begin(), joint_names.end(),
+      ikfast_joint_names[i]);
+    if (it == joint_names.end() || it - joint_names.begin() < first_joint_index)
+    {
+      ROS_ERROR("The ikfast joint %s is not an arm joint in joint_names", ikfast_joint_names[i].c_str());
+      return -1;
+    }
+    chain_order.push_back(it - joint_names.begin() - first_joint_index);
+  }
+
+  IKReplay::LatencyModel latency_model;
+  if (!parseLatencyModel(latency_name, latency_model))
+  {
+    ROS_ERROR("Unknown latency model %s", latency_name.c_str());
+    return -1;
+  }
+  if ((latency_model == IKReplay::LATENCY_NORMAL || latency_model == IKReplay::LATENCY_LOGNORMAL)
+    && (latency_mean <= 0.0 || latency_stddev <= 0.0))
+  {
+    ROS_ERROR("The %s latency model needs a positive mean and standard deviation", latency_name.c_str());
+    return -1;
+  }
+
+  IKTrace trace(cell_size, orientation_weight);
+  if (!trace.read(trace_filename))
+    return -1;
+
+  IKReplay replay(trace, max_distance, latency_model, latency_mean, latency_stddev, latency_min, latency_max, seed,
+    joint_names, first_joint_index, chain_order);
+
+  // the services are advertised in the global namespace, where the selection node looks for them
+  ros::NodeHandle global_node;
+  ros::ServiceServer moveit_service = global_node.advertiseService("/compute_ik", &IKReplay::computeIK, &replay);
+  ros::ServiceServer openrave_service = global_node.advertiseService("/ikfast_solver", &IKReplay::solveIK, &replay);
+  ROS_INFO("Serving /compute_ik and /ikfast_solver from %s with %s latency", trace_filename.c_str(),
+    latency_name.c_str());
+
+  // several threads answer the requests, so that the injected latencies of concurrent clients overlap
+  ros::AsyncSpinner spinner(num_threads);
+  spinner.start();
+  ros::waitForShutdown();
+
+  replay.printStatistics();
+  return 0;
+}
@@ -3,9 +3,12 @@
 
 #include <vector>
 
+#include <grasp_selection/async_logger.h>
 #include <grasp_selection/reaching.h>
+#include <grasp_selection/request_log.h>
 #include <grasp_selection/scoring.h>
 #include <grasp_selection/selection.h>
+#include <grasp_selection/trajectory_planner.h>
 
 
 int main(int argc, char** argv)
@@ -31,7 +34,10 @@ int main(int argc, char** argv)
   node.getParam("IK_first_joint_index", params.ik_first_joint_index_);
   node.getParam("IK_last_joint_index", params.ik_last_joint_index_);
   node.getParam("planning_library", params.planning_lib_);
-  node.getParam("prints", params.is_printing_);
+  node.getParam("pregrasp_offsets", params.pregrasp_offsets_);
+  node.param("max_joint_step", params.max_joint_step_, 0.5);
+  node.param("ik_base_link", params.ik_base_link_, std::string("right_arm_mount"));
+  node.param("ik_trace_file", params.ik_trace_file_, std::string(""));
   
   // read ROS launch file parameters for scoring class
   std::string urdf_filename;  
@@ -39,6 +45,16 @@ int main(int argc, char** argv)
   std::vector<double> initial_pose;
   node.getParam("urdf", urdf_filename);  
   node.getParam("num_selected", num_selected); 
+  
+  // read ROS launch file parameters for trajectory planner class
+  TrajectoryPlanner::Parameters planner_params;
+  double scene_cell_size;
+  node.param("num_preplanned", planner_params.num_preplanned_, 3);
+  node.param("trajectory_resolution", planner_params.resolution_, 0.05);
+  node.param("velocity_scaling", planner_params.velocity_scaling_, 0.5);
+  node.param("link_radius", planner_params.link_radius_, 0.06);
+  node.param("scene_cell_size", scene_cell_size, 0.03);
+  planner_params.max_colliding_points_ = params.max_colliding_points_;
     
   // read ROS launch file parameters for selection class
   std::string grasps_topic;
@@ -53,6 +69,37 @@ int main(int argc, char** argv)
   node.getParam("joint_states_topic", joint_states_topic);
   node.getParam("marker_lifetime", marker_lifetime);
   node.getParam("scoring_mode", scoring_mode);
+  double stats_period;
+  node.param("stats_period", stats_period, 10.0);
+  std::string trace_directory;
+  node.param("trace_directory", trace_directory, std::string(""));
+  bool perf_counters;
+  node.param("perf_counters", perf_counters, false);
+  RequestLogWriter::Parameters request_log_params;
+  double request_log_file_size;
+  node.param("request_log_directory", request_log_params.directory_, std::string(""));
+  node.param("request_log_file_size", request_log_file_size, 64.0);
+  node.param("request_log_num_files", request_log_params.num_files_, 16);
+  request_log_params.file_size_ = (uint64_t) (request_log_file_size * 1e6);
+  
+  // set the log levels of the categories (prints is a shorthand for logging each candidate of the reachability test)
+  AsyncLogger& logger = AsyncLogger::getInstance();
+  bool prints = false;
+  node.getParam("prints", prints);
+  if (prints)
+    logger.setLevel(AsyncLogger::REACHING, AsyncLogger::LEVEL_DEBUG);
+  for (int i = 0; i < AsyncLogger::NUM_CATEGORIES; i++)
+  {
+    AsyncLogger::Category category = static_cast<AsyncLogger::Category>(i);
+    std::string name;
+    if (!node.getParam(std::string("log_levels/") + AsyncLogger::getCategoryName(category), name))
+      continue;
+    AsyncLogger::Level level;
+    if (AsyncLogger::parseLevel(name, level))
+      logger.setLevel(category, level);
+    else
+      ROS_WARN("Unknown log level %s for %s", name.c_str(), AsyncLogger::getCategoryName(category));
+  }
     
   // get robot joints information from URDF file
   urdf::Model urdf;
@@ -64,8 +111,8 @@ int main(int argc, char** argv)
   ROS_INFO("Successfully parsed urdf file");
   
   // create selection object and select grasps
-  Selection selection(node, grasps_topic, cloud_topic, params, urdf, joint_states_topic, num_selected, marker_lifetime, 
-    scoring_mode);
+  Selection selection(node, grasps_topic, cloud_topic, params, planner_params, urdf, joint_states_topic, num_selected, 
+    marker_lifetime, scoring_mode, scene_cell_size, stats_period, trace_directory, perf_counters, request_log_params);
   selection.runNode();
   	
 	return 0;